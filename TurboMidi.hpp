@@ -10,22 +10,130 @@
 #ifndef TURBOMIDI_HPP
 #define TURBOMIDI_HPP
 
-#include <cstdint>
+// Footprint-optimized build without the C++ standard library: fixed arrays,
+// static frames and function-pointer callbacks, no heap. Default on AVR,
+// whose toolchain has no <vector>, <functional> or <array>.
+#ifndef TURBOMIDI_MINIMAL
+#if defined(__AVR__)
+#define TURBOMIDI_MINIMAL 1
+#else
+#define TURBOMIDI_MINIMAL 0
+#endif
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#if !TURBOMIDI_MINIMAL
 #include <vector>
 #include <functional>
-#include <chrono>
 #include <algorithm>
 #include <array>
+#endif
+
+// std::atomic is not available on AVR; single-byte indices are used there instead.
+// TURBOMIDI_MINIMAL leaves it on elsewhere, so SpscRing stays safe across threads;
+// a host build without the C++ headers (-nostdinc++) needs TURBOMIDI_HAS_ATOMIC=0
+#ifndef TURBOMIDI_HAS_ATOMIC
+#if defined(__AVR__)
+#define TURBOMIDI_HAS_ATOMIC 0
+#else
+#define TURBOMIDI_HAS_ATOMIC 1
+#endif
+#endif
+
+#if TURBOMIDI_HAS_ATOMIC
+#include <atomic>
+#elif defined(__AVR__)
+#include <avr/interrupt.h>
+#endif
+
+// Receive buffers are scanned for status bytes with SSE2/NEON where available,
+// otherwise a machine word at a time; 0 forces the plain byte loop
+#ifndef TURBOMIDI_ENABLE_SIMD
+#define TURBOMIDI_ENABLE_SIMD 1
+#endif
+
+#if TURBOMIDI_ENABLE_SIMD && defined(__SSE2__)
+#include <emmintrin.h>
+#elif TURBOMIDI_ENABLE_SIMD && defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 namespace TurboMIDI {
 
+namespace detail {
+
+#if TURBOMIDI_MINIMAL
+// The subset of std::array the library uses
+template <typename T, size_t N>
+struct FixedArray {
+    T elements[N];
+    
+    static constexpr size_t size() { return N; }
+    T* data() { return elements; }
+    constexpr const T* data() const { return elements; }
+    T& operator[](size_t index) { return elements[index]; }
+    constexpr const T& operator[](size_t index) const { return elements[index]; }
+    const T* begin() const { return elements; }
+    const T* end() const { return elements + N; }
+};
+#endif
+
+template <typename T>
+constexpr T minOf(T a, T b) { return b < a ? b : a; }
+
+} // namespace detail
+
+#if TURBOMIDI_MINIMAL
+template <typename T, size_t N> using Array = detail::FixedArray<T, N>;
+
+// Plain function pointers: free functions and capture-less lambdas
+template <typename Signature> using Callback = Signature*;
+#else
+template <typename T, size_t N> using Array = std::array<T, N>;
+template <typename Signature> using Callback = std::function<Signature>;
+#endif
+
 // Constants
 constexpr uint8_t SYSEX_START = 0xF0;
 constexpr uint8_t SYSEX_END = 0xF7;
 constexpr uint8_t ACTIVE_SENSING = 0xFE;
+constexpr uint8_t REALTIME_FIRST = 0xF8;
+
+// Maximum length of a received TurboMIDI frame (SPEED_TEST is the longest at 16 bytes).
+// SysEx frames longer than this are not TurboMIDI commands and are discarded.
+#ifndef TURBOMIDI_MAX_FRAME_LENGTH
+#define TURBOMIDI_MAX_FRAME_LENGTH 32
+#endif
+
+// Realtime bytes sendRealtime() can hold while a speed test owns the wire
+#ifndef TURBOMIDI_REALTIME_LANE_SIZE
+#define TURBOMIDI_REALTIME_LANE_SIZE 4
+#endif
+
+// Used to keep producer and consumer state of SpscRing on separate cache lines
+#ifndef TURBOMIDI_CACHE_LINE_SIZE
+#define TURBOMIDI_CACHE_LINE_SIZE 64
+#endif
+
+// Link statistics (bytes, frames, negotiations); compiled out unless enabled
+#ifndef TURBOMIDI_ENABLE_STATS
+#define TURBOMIDI_ENABLE_STATS 0
+#endif
+
+// Trace recording hooks (attachTraceRecorder); compiled out by TURBOMIDI_MINIMAL unless enabled
+#ifndef TURBOMIDI_ENABLE_TRACE
+#define TURBOMIDI_ENABLE_TRACE (!TURBOMIDI_MINIMAL)
+#endif
+
+// Extended link test (enableLinkTest); compiled out by TURBOMIDI_MINIMAL unless enabled
+#ifndef TURBOMIDI_ENABLE_LINK_TEST
+#define TURBOMIDI_ENABLE_LINK_TEST (!TURBOMIDI_MINIMAL)
+#endif
 
 // Elektron manufacturer ID
-constexpr std::array<uint8_t, 5> ELEKTRON_ID = {0x00, 0x20, 0x3C, 0x00, 0x00};
+constexpr Array<uint8_t, 5> ELEKTRON_ID = {0x00, 0x20, 0x3C, 0x00, 0x00};
 
 // Command IDs
 enum class CommandID : uint8_t {
@@ -37,7 +145,11 @@ enum class CommandID : uint8_t {
     SPEED_RESULT  = 0x15,
     SPEED_TEST2   = 0x16,
     SPEED_RESULT2 = 0x17,
-    SPEED_PUSH    = 0x20
+    SPEED_PUSH    = 0x20,
+    
+    // Vendor extension, only sent to peers that advertise LINK_TEST_CAPABILITY
+    LINK_TEST     = 0x30,
+    LINK_REPORT   = 0x31
 };
 
 // Speed multipliers
@@ -62,6 +174,83 @@ enum class DeviceRole {
     ANY
 };
 
+// Outcome of an asynchronous master negotiation
+enum class NegotiationStatus : uint8_t {
+    IDLE,
+    IN_PROGRESS,
+    SUCCEEDED,
+    FAILED
+};
+
+// Time the master spent in each step of the last negotiation (microseconds,
+// summed over the steps of a best-speed search)
+struct NegotiationTiming {
+    uint32_t answer = 0;       // SPEED_REQ until SPEED_ANSWER
+    uint32_t ack = 0;          // SPEED_NEG until SPEED_ACK
+    uint32_t breathing = 0;    // Breathing bytes until the switch to the test speed
+    uint32_t result = 0;       // SPEED_TEST until the SPEED_RESULT header
+    uint32_t result2 = 0;      // SPEED_TEST2 until SPEED_RESULT2
+#if TURBOMIDI_ENABLE_LINK_TEST
+    uint32_t linkTest = 0;     // LINK_TEST until the end of LINK_REPORT
+#endif
+    uint32_t resync = 0;       // Waiting for the peer to fall back to 1x
+    uint32_t total = 0;
+};
+
+// Why a received SysEx frame was dropped (see LinkStats)
+enum class FrameRejectReason : uint8_t {
+    TOO_SHORT,         // Shorter than a command header
+    FOREIGN,           // Not an Elektron frame
+    OVERSIZED,         // Longer than TURBOMIDI_MAX_FRAME_LENGTH
+    TRUNCATED,         // Command too short for its payload
+    BAD_TEST_PATTERN,  // Speed test or result with a corrupted pattern
+    UNEXPECTED,        // Valid command not expected in this role or state
+    UNKNOWN_COMMAND,
+    COUNT
+};
+
+#if TURBOMIDI_ENABLE_STATS
+// Counters kept by TurboMIDI when TURBOMIDI_ENABLE_STATS is set
+struct LinkStats {
+    static constexpr size_t SPEED_COUNT = 11;
+    static constexpr size_t RTT_BUCKETS = 8;
+    
+    uint32_t bytesIn = 0;
+    uint32_t bytesOut = 0;             // Sent by the protocol layer
+    uint32_t framesParsed = 0;         // Complete SysEx frames, including rejected ones
+    uint32_t framesRejected[static_cast<size_t>(FrameRejectReason::COUNT)] = {};
+    
+    // Indexed by speedIndex(target speed)
+    uint32_t negotiationAttempts[SPEED_COUNT] = {};
+    uint32_t negotiationSuccesses[SPEED_COUNT] = {};
+    uint32_t negotiationFailures[SPEED_COUNT] = {};
+    
+    uint32_t activeSenseTimeouts = 0;  // Fallbacks to 1x after 300 ms of silence
+    
+    // SPEED_REQ to SPEED_ANSWER round trip: bucket 0 is < 1 ms, bucket i covers
+    // [2^(i-1), 2^i) ms and the last bucket everything from 64 ms up
+    uint32_t negotiationRtt[RTT_BUCKETS] = {};
+    
+    static size_t speedIndex(SpeedMultiplier speed) {
+        size_t index = static_cast<size_t>(speed) - 1;
+        return index < SPEED_COUNT ? index : 0;
+    }
+    
+    static size_t rttBucket(uint32_t ms) {
+        size_t bucket = 0;
+        while (ms > 0 && bucket < RTT_BUCKETS - 1) {
+            ms >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+    
+    uint32_t rejected(FrameRejectReason reason) const {
+        return framesRejected[static_cast<size_t>(reason)];
+    }
+};
+#endif
+
 // Platform abstraction layer
 class IPlatform {
 public:
@@ -70,19 +259,127 @@ public:
     // Send raw MIDI data
     virtual void sendMidiData(const uint8_t* data, size_t length) = 0;
     
+    // Bytes sendMidiData() takes right now without blocking; SysEx dumps are
+    // handed over in pieces that fit. The default reports no limit
+    virtual size_t txSpace() { return static_cast<size_t>(-1); }
+    
+    // Send a realtime byte ahead of data this platform still has queued, at
+    // the next byte boundary. The default appends it like sendMidiData()
+    virtual void sendRealtimeByte(uint8_t byte) { sendMidiData(&byte, 1); }
+    
+    // True if sendRealtimeByte() overtakes queued data
+    virtual bool hasRealtimePriority() const { return false; }
+    
     // Receive MIDI data (non-blocking, returns number of bytes read)
     virtual size_t receiveMidiData(uint8_t* buffer, size_t maxLength) = 0;
     
+    // Optional zero-copy receive: contiguous readable region of the driver's own
+    // RX buffer, released with consumeMidiData(). Returning 0 falls back to receiveMidiData().
+    virtual size_t peekMidiData(const uint8_t*& data) {
+        data = nullptr;
+        return 0;
+    }
+    virtual void consumeMidiData(size_t count) { (void)count; }
+    
     // Get current time in milliseconds
     virtual uint32_t getMillis() = 0;
     
+    // Get current time in microseconds; override for sub-millisecond TX scheduling
+    virtual uint32_t getMicros() { return getMillis() * 1000u; }
+    
     // Set UART/MIDI baud rate
     virtual void setBaudRate(uint32_t baudRate) = 0;
     
     // Platform-specific delay
     virtual void delayMs(uint32_t ms) = 0;
+    
+    // Sub-millisecond delay used while waiting for negotiation responses
+    virtual void delayMicros(uint32_t micros) { delayMs((micros + 999) / 1000); }
+};
+
+// Per-speed metadata: where the speed lives in the SPEED_ANSWER masks,
+// its exact baud rate and the multiplier as a fraction
+struct SpeedDescriptor {
+    static constexpr uint8_t NO_MASK = 0xFF;  // 1x is implied and has no mask bit
+    
+    uint8_t maskIndex;     // 0 = mask1/cert1, 1 = mask2/cert2
+    uint8_t bit;
+    uint32_t baudRate;
+    uint8_t numerator;     // Multiplier = numerator / denominator
+    uint8_t denominator;
+};
+
+constexpr uint32_t MIDI_BAUD_RATE = 31250;
+
+// Indexed by the SpeedMultiplier value; entry 0 (invalid) falls back to 1x
+constexpr SpeedDescriptor SPEED_TABLE[] = {
+    {SpeedDescriptor::NO_MASK, 0, MIDI_BAUD_RATE, 1, 1},
+    {SpeedDescriptor::NO_MASK, 0, 31250, 1, 1},     // 1x
+    {0, 1 << 0, 62500, 2, 1},                       // 2x
+    {0, 1 << 1, 103125, 33, 10},                    // 3.3x
+    {0, 1 << 2, 125000, 4, 1},                      // 4x
+    {0, 1 << 3, 156250, 5, 1},                      // 5x
+    {0, 1 << 4, 206250, 33, 5},                     // 6.6x
+    {0, 1 << 5, 250000, 8, 1},                      // 8x
+    {0, 1 << 6, 312500, 10, 1},                     // 10x
+    {1, 1 << 0, 415625, 133, 10},                   // 13.3x
+    {1, 1 << 1, 500000, 16, 1},                     // 16x
+    {1, 1 << 2, 625000, 20, 1}                      // 20x
 };
 
+constexpr size_t SPEED_TABLE_SIZE = sizeof(SPEED_TABLE) / sizeof(SPEED_TABLE[0]);
+
+constexpr const SpeedDescriptor& speedDescriptor(SpeedMultiplier speed) {
+    return SPEED_TABLE[static_cast<size_t>(speed) < SPEED_TABLE_SIZE ? static_cast<size_t>(speed) : 0];
+}
+
+constexpr uint32_t speedBaudRate(SpeedMultiplier speed) {
+    return speedDescriptor(speed).baudRate;
+}
+
+// Multiplier rounded to the nearest integer (3.3x -> 3, 6.6x -> 7)
+constexpr uint32_t speedMultiplierRounded(SpeedMultiplier speed) {
+    return (speedDescriptor(speed).numerator + speedDescriptor(speed).denominator / 2u) /
+           speedDescriptor(speed).denominator;
+}
+
+// One byte (start + 8 data + stop bits) at 1x
+constexpr uint32_t MIDI_BYTE_MICROS = 10000000u / MIDI_BAUD_RATE;
+
+// Time on the wire for `bytes` bytes, rounded up. A byte takes
+// MIDI_BYTE_MICROS * denominator / numerator; whole multiples of the
+// numerator are split off first so no intermediate overflows before the
+// result itself does
+constexpr uint32_t wireTimeMicros(SpeedMultiplier speed, uint32_t bytes) {
+    return bytes / speedDescriptor(speed).numerator * (MIDI_BYTE_MICROS * speedDescriptor(speed).denominator) +
+           (bytes % speedDescriptor(speed).numerator * (MIDI_BYTE_MICROS * speedDescriptor(speed).denominator) +
+            speedDescriptor(speed).numerator - 1) / speedDescriptor(speed).numerator;
+}
+
+static_assert(SPEED_TABLE_SIZE == static_cast<size_t>(SpeedMultiplier::SPEED_20X) + 1,
+              "SPEED_TABLE needs one entry per SpeedMultiplier");
+static_assert(speedBaudRate(SpeedMultiplier::SPEED_13_3X) ==
+              MIDI_BAUD_RATE * 133 / 10, "Baud rates must match the multipliers");
+static_assert(MIDI_BYTE_MICROS * MIDI_BAUD_RATE == 10000000u, "wireTimeMicros needs an exact 1x byte time");
+static_assert(wireTimeMicros(SpeedMultiplier::SPEED_13_3X, 133) == 3200, "13.3x: 133 bytes in 3.2ms");
+static_assert(wireTimeMicros(SpeedMultiplier::SPEED_20X, 65535) == 65535u * 16u, "Long writes must not overflow");
+
+/**
+ * UART divisor for a baud rate at a given peripheral clock, rounded to the
+ * nearest integer. oversampling is 16 for most UARTs (8 for AVR U2X); the
+ * AVR UBRR register takes the divisor minus one.
+ */
+constexpr uint32_t uartDivisor(uint32_t clockHz, uint32_t baudRate, uint32_t oversampling = 16) {
+    return (clockHz + oversampling * baudRate / 2) / (oversampling * baudRate);
+}
+
+// Baud rate error of uartDivisor() in percent (positive = faster than requested)
+constexpr double uartBaudErrorPercent(uint32_t clockHz, uint32_t baudRate, uint32_t oversampling = 16) {
+    return uartDivisor(clockHz, baudRate, oversampling) == 0 ? -100.0 :
+           (static_cast<double>(clockHz) / (oversampling * uartDivisor(clockHz, baudRate, oversampling)) -
+            baudRate) * 100.0 / baudRate;
+}
+
 // Speed configuration
 struct SpeedConfig {
     uint8_t mask1 = 0;
@@ -91,429 +388,2737 @@ struct SpeedConfig {
     uint8_t cert2 = 0;
     
     void addSpeed(SpeedMultiplier speed, bool certified = false) {
-        switch (speed) {
-            case SpeedMultiplier::SPEED_2X:    mask1 |= (1 << 0); if (certified) cert1 |= (1 << 0); break;
-            case SpeedMultiplier::SPEED_3_3X:  mask1 |= (1 << 1); if (certified) cert1 |= (1 << 1); break;
-            case SpeedMultiplier::SPEED_4X:    mask1 |= (1 << 2); if (certified) cert1 |= (1 << 2); break;
-            case SpeedMultiplier::SPEED_5X:    mask1 |= (1 << 3); if (certified) cert1 |= (1 << 3); break;
-            case SpeedMultiplier::SPEED_6_6X:  mask1 |= (1 << 4); if (certified) cert1 |= (1 << 4); break;
-            case SpeedMultiplier::SPEED_8X:    mask1 |= (1 << 5); if (certified) cert1 |= (1 << 5); break;
-            case SpeedMultiplier::SPEED_10X:   mask1 |= (1 << 6); if (certified) cert1 |= (1 << 6); break;
-            case SpeedMultiplier::SPEED_13_3X: mask2 |= (1 << 0); if (certified) cert2 |= (1 << 0); break;
-            case SpeedMultiplier::SPEED_16X:   mask2 |= (1 << 1); if (certified) cert2 |= (1 << 1); break;
-            case SpeedMultiplier::SPEED_20X:   mask2 |= (1 << 2); if (certified) cert2 |= (1 << 2); break;
-            default: break;
-        }
+        const SpeedDescriptor& descriptor = speedDescriptor(speed);
+        if (descriptor.maskIndex == SpeedDescriptor::NO_MASK) return;
+        (descriptor.maskIndex ? mask2 : mask1) |= descriptor.bit;
+        if (certified) (descriptor.maskIndex ? cert2 : cert1) |= descriptor.bit;
     }
     
     bool hasSpeed(SpeedMultiplier speed) const {
-        switch (speed) {
-            case SpeedMultiplier::SPEED_2X:    return mask1 & (1 << 0);
-            case SpeedMultiplier::SPEED_3_3X:  return mask1 & (1 << 1);
-            case SpeedMultiplier::SPEED_4X:    return mask1 & (1 << 2);
-            case SpeedMultiplier::SPEED_5X:    return mask1 & (1 << 3);
-            case SpeedMultiplier::SPEED_6_6X:  return mask1 & (1 << 4);
-            case SpeedMultiplier::SPEED_8X:    return mask1 & (1 << 5);
-            case SpeedMultiplier::SPEED_10X:   return mask1 & (1 << 6);
-            case SpeedMultiplier::SPEED_13_3X: return mask2 & (1 << 0);
-            case SpeedMultiplier::SPEED_16X:   return mask2 & (1 << 1);
-            case SpeedMultiplier::SPEED_20X:   return mask2 & (1 << 2);
-            default: return false;
-        }
+        const SpeedDescriptor& descriptor = speedDescriptor(speed);
+        return ((descriptor.maskIndex ? mask2 : mask1) & descriptor.bit) != 0;
     }
     
     bool isCertified(SpeedMultiplier speed) const {
-        switch (speed) {
-            case SpeedMultiplier::SPEED_2X:    return cert1 & (1 << 0);
-            case SpeedMultiplier::SPEED_3_3X:  return cert1 & (1 << 1);
-            case SpeedMultiplier::SPEED_4X:    return cert1 & (1 << 2);
-            case SpeedMultiplier::SPEED_5X:    return cert1 & (1 << 3);
-            case SpeedMultiplier::SPEED_6_6X:  return cert1 & (1 << 4);
-            case SpeedMultiplier::SPEED_8X:    return cert1 & (1 << 5);
-            case SpeedMultiplier::SPEED_10X:   return cert1 & (1 << 6);
-            case SpeedMultiplier::SPEED_13_3X: return cert2 & (1 << 0);
-            case SpeedMultiplier::SPEED_16X:   return cert2 & (1 << 1);
-            case SpeedMultiplier::SPEED_20X:   return cert2 & (1 << 2);
-            default: return false;
+        const SpeedDescriptor& descriptor = speedDescriptor(speed);
+        return ((descriptor.maskIndex ? cert2 : cert1) & descriptor.bit) != 0;
+    }
+};
+
+namespace detail {
+
+// Index of the first status byte (bit 7 set) in data, or length if there is none
+inline size_t findStatusByte(const uint8_t* data, size_t length) {
+    size_t i = 0;
+#if TURBOMIDI_ENABLE_SIMD && defined(__SSE2__)
+    for (; i + 16 <= length; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        int mask = _mm_movemask_epi8(block);
+        if (mask != 0) {
+            while (!(mask & 1)) {
+                mask >>= 1;
+                ++i;
+            }
+            return i;
+        }
+    }
+#elif TURBOMIDI_ENABLE_SIMD && defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 16 <= length; i += 16) {
+        if (vmaxvq_u8(vld1q_u8(data + i)) & 0x80) break;
+    }
+#elif TURBOMIDI_ENABLE_SIMD
+    // SWAR: test the high bit of every byte in a word; pointless on 8/16-bit MCUs
+    if (sizeof(size_t) >= 4) {
+        const size_t highBits = static_cast<size_t>(~size_t(0)) / 0xFF * 0x80;
+        for (; i + sizeof(size_t) <= length; i += sizeof(size_t)) {
+            size_t word;
+            memcpy(&word, data + i, sizeof(word));
+            if (word & highBits) break;
+        }
+    }
+#endif
+    while (i < length && !(data[i] & 0x80)) ++i;
+    return i;
+}
+
+} // namespace detail
+
+/**
+ * Fixed-capacity SysEx frame assembler
+ *
+ * Collects bytes between SYSEX_START and SYSEX_END into a statically sized
+ * buffer. Bytes outside a frame are ignored, realtime bytes interleaved in a
+ * frame are skipped, and any other status byte aborts the frame. Frames that
+ * do not fit are dropped and reported as overflow. Never allocates.
+ *
+ * The last complete frame stays available until the next SYSEX_START.
+ */
+template <size_t MaxLength>
+class SysExAssembler {
+    static_assert(MaxLength >= 2, "SysExAssembler needs room for SYSEX_START and SYSEX_END");
+    
+public:
+    enum class Result : uint8_t {
+        NONE,       // Byte consumed (or ignored), no frame completed
+        COMPLETE,   // A full frame is available through data()/size()
+        OVERFLOWED  // Frame exceeded MaxLength and is being discarded
+    };
+    
+    Result push(uint8_t byte) {
+        // Realtime messages may appear anywhere, even inside SysEx
+        if (byte >= REALTIME_FIRST) return Result::NONE;
+        
+        if (byte == SYSEX_START) {
+            buffer_[0] = byte;
+            length_ = 1;
+            complete_ = false;
+            state_ = State::RECEIVING;
+            return Result::NONE;
+        }
+        
+        switch (state_) {
+            case State::IDLE:
+                return Result::NONE;
+                
+            case State::DISCARDING:
+                // Wait for the oversized frame to be terminated by any status byte
+                if (byte & 0x80) state_ = State::IDLE;
+                return Result::NONE;
+                
+            case State::RECEIVING:
+                break;
+        }
+        
+        if (byte == SYSEX_END) {
+            buffer_[length_++] = byte;
+            complete_ = true;
+            state_ = State::IDLE;
+            return Result::COMPLETE;
+        }
+        
+        if (byte & 0x80) {
+            // Any other status byte terminates the frame without completing it
+            length_ = 0;
+            state_ = State::IDLE;
+            return Result::NONE;
+        }
+        
+        // Always keep one slot free for SYSEX_END
+        if (length_ >= MaxLength - 1) {
+            length_ = 0;
+            state_ = State::DISCARDING;
+            ++overflowCount_;
+            return Result::OVERFLOWED;
+        }
+        
+        buffer_[length_++] = byte;
+        return Result::NONE;
+    }
+    
+    /**
+     * Push a run of data bytes (all below 0x80) at once, as found by
+     * detail::findStatusByte(). Same result as pushing them one by one.
+     */
+    Result pushData(const uint8_t* data, size_t length) {
+        if (state_ != State::RECEIVING || length == 0) return Result::NONE;
+        
+        // Always keep one slot free for SYSEX_END
+        size_t room = MaxLength - 1 - length_;
+        if (length > room) {
+            length_ = 0;
+            state_ = State::DISCARDING;
+            ++overflowCount_;
+            return Result::OVERFLOWED;
         }
+        memcpy(buffer_ + length_, data, length);
+        length_ += length;
+        return Result::NONE;
+    }
+    
+    void reset() {
+        length_ = 0;
+        complete_ = false;
+        state_ = State::IDLE;
     }
+    
+    // Last complete frame, including SYSEX_START and SYSEX_END
+    bool hasFrame() const { return complete_; }
+    const uint8_t* data() const { return buffer_; }
+    size_t size() const { return complete_ ? length_ : 0; }
+    
+    bool inFrame() const { return state_ == State::RECEIVING; }
+    // Bytes of the frame still being received, readable through data()
+    size_t receivedLength() const { return inFrame() ? length_ : 0; }
+    uint32_t overflowCount() const { return overflowCount_; }
+    static constexpr size_t capacity() { return MaxLength; }
+    
+private:
+    enum class State : uint8_t {
+        IDLE,
+        RECEIVING,
+        DISCARDING
+    };
+    
+    uint8_t buffer_[MaxLength];
+    size_t length_ = 0;
+    uint32_t overflowCount_ = 0;
+    State state_ = State::IDLE;
+    bool complete_ = false;
 };
 
-// Command builders
-class CommandBuilder {
+namespace detail {
+
+#if TURBOMIDI_HAS_ATOMIC
+typedef size_t RingIndex;
+
+class RingCounter {
 public:
-    static std::vector<uint8_t> buildSpeedReq() {
-        return buildCommand(CommandID::SPEED_REQ);
+    RingIndex loadRelaxed() const { return value_.load(std::memory_order_relaxed); }
+    RingIndex loadAcquire() const { return value_.load(std::memory_order_acquire); }
+    void storeRelaxed(RingIndex value) { value_.store(value, std::memory_order_relaxed); }
+    void storeRelease(RingIndex value) { value_.store(value, std::memory_order_release); }
+    
+private:
+    std::atomic<RingIndex> value_{0};
+};
+#else
+// Single-byte loads and stores cannot tear on 8-bit MCUs
+typedef uint8_t RingIndex;
+
+class RingCounter {
+public:
+    RingIndex loadRelaxed() const { return value_; }
+    RingIndex loadAcquire() const { return value_; }
+    void storeRelaxed(RingIndex value) { value_ = value; }
+    void storeRelease(RingIndex value) { value_ = value; }
+    
+private:
+    volatile RingIndex value_ = 0;
+};
+#endif
+
+// Event count written by the producer only, wider than RingIndex so it does not wrap
+class RingTally {
+public:
+#if TURBOMIDI_HAS_ATOMIC
+    uint32_t load() const { return value_.load(std::memory_order_relaxed); }
+    void add(uint32_t count) { value_.store(value_.load(std::memory_order_relaxed) + count, std::memory_order_relaxed); }
+    
+private:
+    std::atomic<uint32_t> value_{0};
+#else
+    uint32_t load() const {
+#if defined(__AVR__)
+        // Four byte loads: keep the producer ISR out until all are read
+        uint8_t sreg = SREG;
+        cli();
+        uint32_t value = value_;
+        SREG = sreg;
+        return value;
+#else
+        return value_;  // One aligned word load on 32-bit targets
+#endif
     }
+    void add(uint32_t count) { value_ = value_ + count; }
     
-    static std::vector<uint8_t> buildSpeedAnswer(const SpeedConfig& config) {
-        return buildCommand(CommandID::SPEED_ANSWER, 
-            {config.mask1, config.mask2, config.cert1, config.cert2});
+private:
+    volatile uint32_t value_ = 0;
+#endif
+};
+
+} // namespace detail
+
+/**
+ * Lock-free single-producer/single-consumer byte ring
+ *
+ * The producer (UART ISR or a host reader thread) calls push()/write(); the
+ * consumer (TurboMIDI::handleIncomingData) drains it with peek()/consume() or
+ * read(). Indices are free-running counters, so the full capacity is usable.
+ * Bytes that do not fit are dropped and counted. Use SpscRing<N> to get a
+ * ring with its own storage.
+ */
+class SpscByteRing {
+public:
+    // Producer side
+    bool push(uint8_t byte) {
+        detail::RingIndex head = head_.loadRelaxed();
+        detail::RingIndex used = static_cast<detail::RingIndex>(head - tail_.loadAcquire());
+        if (used >= capacity_) {
+            droppedBytes_.add(1);
+            return false;
+        }
+        storage_[head & mask_] = byte;
+        head_.storeRelease(static_cast<detail::RingIndex>(head + 1));
+        updateHighWaterMark(static_cast<size_t>(used) + 1);
+        return true;
     }
     
-    static std::vector<uint8_t> buildSpeedNeg(SpeedMultiplier testSpeed, SpeedMultiplier targetSpeed) {
-        return buildCommand(CommandID::SPEED_NEG, 
-            {static_cast<uint8_t>(testSpeed), static_cast<uint8_t>(targetSpeed)});
+    size_t write(const uint8_t* data, size_t length) {
+        detail::RingIndex head = head_.loadRelaxed();
+        size_t used = static_cast<detail::RingIndex>(head - tail_.loadAcquire());
+        size_t count = detail::minOf(length, capacity_ - used);
+        
+        // Copy in at most two contiguous runs
+        size_t offset = head & mask_;
+        size_t first = detail::minOf(count, capacity_ - offset);
+        memcpy(storage_ + offset, data, first);
+        memcpy(storage_, data + first, count - first);
+        
+        head_.storeRelease(static_cast<detail::RingIndex>(head + count));
+        updateHighWaterMark(used + count);
+        if (count < length) {
+            droppedBytes_.add(static_cast<uint32_t>(length - count));
+        }
+        return count;
     }
     
-    static std::vector<uint8_t> buildSpeedAck() {
-        return buildCommand(CommandID::SPEED_ACK);
+    // Consumer side: contiguous readable region starting at the read position
+    size_t peek(const uint8_t*& data) const {
+        detail::RingIndex tail = tail_.loadRelaxed();
+        size_t used = static_cast<detail::RingIndex>(head_.loadAcquire() - tail);
+        size_t offset = tail & mask_;
+        data = storage_ + offset;
+        return detail::minOf(used, capacity_ - offset);
     }
     
-    static std::vector<uint8_t> buildSpeedTest() {
-        return buildCommand(CommandID::SPEED_TEST, 
-            {0x55, 0x55, 0x55, 0x55, 0x00, 0x00, 0x00, 0x00});
+    void consume(size_t count) {
+        tail_.storeRelease(static_cast<detail::RingIndex>(tail_.loadRelaxed() + count));
     }
     
-    static std::vector<uint8_t> buildSpeedResult() {
-        return buildCommand(CommandID::SPEED_RESULT, 
-            {0x55, 0x55, 0x55, 0x55, 0x00, 0x00, 0x00, 0x00});
+    size_t read(uint8_t* out, size_t maxLength) {
+        size_t total = 0;
+        const uint8_t* region;
+        size_t length;
+        while (total < maxLength && (length = peek(region)) > 0) {
+            length = detail::minOf(length, maxLength - total);
+            memcpy(out + total, region, length);
+            consume(length);
+            total += length;
+        }
+        return total;
     }
     
-    static std::vector<uint8_t> buildSpeedTest2() {
-        return buildCommand(CommandID::SPEED_TEST2);
+    size_t size() const {
+        return static_cast<detail::RingIndex>(head_.loadAcquire() - tail_.loadAcquire());
     }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return capacity_; }
     
-    static std::vector<uint8_t> buildSpeedResult2() {
-        return buildCommand(CommandID::SPEED_RESULT2);
+    // Highest fill level seen by the producer, and bytes lost to a full ring
+    size_t highWaterMark() const { return highWaterMark_.loadRelaxed(); }
+    size_t droppedBytes() const { return droppedBytes_.load(); }
+    void resetHighWaterMark() { highWaterMark_.storeRelaxed(static_cast<detail::RingIndex>(size())); }
+    
+protected:
+    SpscByteRing(uint8_t* storage, size_t capacity)
+        : storage_(storage), capacity_(capacity), mask_(capacity - 1) {}
+    
+    // Non-copyable: the producer may hold a pointer to this ring
+    SpscByteRing(const SpscByteRing&) = delete;
+    SpscByteRing& operator=(const SpscByteRing&) = delete;
+    
+private:
+    alignas(TURBOMIDI_CACHE_LINE_SIZE) detail::RingCounter head_;  // Written by producer
+    detail::RingCounter highWaterMark_;
+    detail::RingTally droppedBytes_;
+    alignas(TURBOMIDI_CACHE_LINE_SIZE) detail::RingCounter tail_;  // Written by consumer
+    alignas(TURBOMIDI_CACHE_LINE_SIZE) uint8_t* const storage_;
+    const size_t capacity_;
+    const size_t mask_;
+    
+    void updateHighWaterMark(size_t used) {
+        if (used > highWaterMark_.loadRelaxed()) {
+            highWaterMark_.storeRelaxed(static_cast<detail::RingIndex>(used));
+        }
     }
+};
+
+template <size_t Capacity>
+class SpscRing : public SpscByteRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+    static_assert(Capacity <= (static_cast<detail::RingIndex>(~detail::RingIndex(0)) / 2) + 1,
+                  "SpscRing capacity too large for the index type of this platform");
     
-    static std::vector<uint8_t> buildSpeedPush(SpeedMultiplier speed) {
-        return buildCommand(CommandID::SPEED_PUSH, {static_cast<uint8_t>(speed)});
+public:
+    SpscRing() : SpscByteRing(storage_, Capacity) {}
+    
+private:
+    uint8_t storage_[Capacity];
+};
+
+enum class TraceRecordType : uint8_t {
+    RX,     // Bytes handed to the parser by handleIncomingData()
+    TX,     // Protocol frames and active sensing sent by the engine
+    TX_DATA,  // Application bytes the engine sent: SysEx dumps, scheduled messages
+    BAUD,   // setBaudRate() argument, 4 bytes little endian
+    STATE,  // Negotiation phase, negotiation status, current speed
+    CALL    // Application call driving the engine: TraceCall, then its arguments
+};
+
+enum class TraceCall : uint8_t {
+    NEGOTIATE,       // Target speed, timeout (ms, 16 bits little endian)
+    NEGOTIATE_BEST,  // Unused byte, timeout
+    PUSH_SPEED,      // Speed
+    CANCEL
+};
+
+#if TURBOMIDI_ENABLE_TRACE
+/**
+ * Compact timestamped record of everything a link saw and did
+ *
+ * Attached with TurboMIDI::attachTraceRecorder(). Each record is a header
+ * (type, getMicros() since the previous record as a 7-bit varint, payload
+ * length) followed by up to 255 payload bytes; longer chunks are split. The
+ * first record carries the absolute time, and the header is 3 bytes while
+ * records come less than 128us apart, 4 bytes up to 16ms. Records go into a
+ * preallocated SpscByteRing whole, or are dropped and counted when they do
+ * not fit, so another thread or the main loop can drain the ring to a file
+ * or port at its own pace. TurboMidiTrace.hpp replays traces on the host.
+ */
+class TraceRecorder {
+public:
+    static constexpr size_t MAX_HEADER_LENGTH = 7;
+    static constexpr size_t MAX_PAYLOAD = 255;
+    
+    explicit TraceRecorder(SpscByteRing& ring) : ring_(ring) {}
+    
+    void record(TraceRecordType type, uint32_t micros, const uint8_t* data, size_t length) {
+        do {
+            size_t count = detail::minOf(length, MAX_PAYLOAD);
+            uint8_t header[MAX_HEADER_LENGTH];
+            size_t headerLength = 0;
+            header[headerLength++] = static_cast<uint8_t>(type);
+            // Deltas from the last record written, so a dropped one costs no time
+            for (uint32_t delta = micros - lastMicros_; ; delta >>= 7) {
+                if (delta < 0x80) {
+                    header[headerLength++] = static_cast<uint8_t>(delta);
+                    break;
+                }
+                header[headerLength++] = static_cast<uint8_t>(delta | 0x80);
+            }
+            header[headerLength++] = static_cast<uint8_t>(count);
+            
+            if (ring_.capacity() - ring_.size() < headerLength + count) {
+                dropped_.storeRelaxed(static_cast<detail::RingIndex>(dropped_.loadRelaxed() + 1));
+            } else {
+                ring_.write(header, headerLength);
+                ring_.write(data, count);
+                lastMicros_ = micros;
+            }
+            data += count;
+            length -= count;
+        } while (length > 0);
+    }
+    
+    SpscByteRing& ring() { return ring_; }
+    
+    // Records lost because the ring was full
+    size_t droppedRecords() const { return dropped_.loadRelaxed(); }
+    
+private:
+    SpscByteRing& ring_;
+    detail::RingCounter dropped_;
+    uint32_t lastMicros_ = 0;
+};
+#endif
+
+// Channel or system common message decoded from the MIDI stream
+struct MidiMessage {
+    uint8_t status = 0;
+    uint8_t data1 = 0;
+    uint8_t data2 = 0;
+    uint8_t length = 0;  // Total bytes including status (1-3)
+    
+    uint8_t type() const { return status < 0xF0 ? (status & 0xF0) : status; }
+    uint8_t channel() const { return status & 0x0F; }
+};
+
+/**
+ * Incremental MIDI stream parser
+ *
+ * Decodes channel and system common messages (with running status) and
+ * reports realtime bytes wherever they appear, including inside SysEx.
+ * SysEx data bytes are skipped; frames are collected by SysExAssembler.
+ */
+class MidiParser {
+public:
+    enum class Event : uint8_t {
+        NONE,      // Byte consumed, nothing to report
+        MESSAGE,   // A complete message is available through message()
+        REALTIME   // The byte itself is a realtime message
+    };
+    
+    Event parse(uint8_t byte) {
+        if (byte >= REALTIME_FIRST) {
+            // Realtime bytes never disturb running status or SysEx
+            return byte == 0xF9 || byte == 0xFD ? Event::NONE : Event::REALTIME;
+        }
+        
+        if (byte & 0x80) {
+            inSysEx_ = byte == SYSEX_START;
+            dataCount_ = 0;
+            
+            if (byte >= 0xF0) {
+                // System common messages cancel running status
+                runningStatus_ = 0;
+                expected_ = systemCommonLength(byte);
+                if (byte == 0xF6) {
+                    // Tune request has no data bytes
+                    message_.status = byte;
+                    message_.length = 1;
+                    return Event::MESSAGE;
+                }
+                if (expected_ > 0) pendingStatus_ = byte;
+                return Event::NONE;
+            }
+            
+            runningStatus_ = byte;
+            pendingStatus_ = byte;
+            expected_ = channelDataLength(byte);
+            return Event::NONE;
+        }
+        
+        // Data byte
+        if (inSysEx_ || expected_ == 0) return Event::NONE;
+        
+        if (dataCount_ == 0) {
+            data1_ = byte;
+            dataCount_ = 1;
+            if (expected_ == 1) return complete(byte, 0);
+            return Event::NONE;
+        }
+        
+        return complete(data1_, byte);
+    }
+    
+    const MidiMessage& message() const { return message_; }
+    
+    bool inSysEx() const { return inSysEx_; }
+    
+    // False while data bytes are ignored (inside SysEx or without a status), so runs can be skipped
+    bool expectsData() const { return !inSysEx_ && expected_ != 0; }
+    
+    void reset() {
+        runningStatus_ = 0;
+        pendingStatus_ = 0;
+        expected_ = 0;
+        dataCount_ = 0;
+        inSysEx_ = false;
     }
     
 private:
-    static std::vector<uint8_t> buildCommand(CommandID cmd, const std::vector<uint8_t>& payload = {}) {
-        std::vector<uint8_t> message;
-        message.push_back(SYSEX_START);
-        message.insert(message.end(), ELEKTRON_ID.begin(), ELEKTRON_ID.end());
-        message.push_back(static_cast<uint8_t>(cmd));
-        message.insert(message.end(), payload.begin(), payload.end());
-        message.push_back(SYSEX_END);
-        return message;
+    MidiMessage message_;
+    uint8_t runningStatus_ = 0;
+    uint8_t pendingStatus_ = 0;
+    uint8_t expected_ = 0;
+    uint8_t dataCount_ = 0;
+    uint8_t data1_ = 0;
+    bool inSysEx_ = false;
+    
+    Event complete(uint8_t data1, uint8_t data2) {
+        message_.status = pendingStatus_;
+        message_.data1 = data1;
+        message_.data2 = data2;
+        message_.length = static_cast<uint8_t>(expected_ + 1);
+        dataCount_ = 0;
+        
+        if (runningStatus_ == 0) {
+            // System common message done; further data bytes are ignored
+            expected_ = 0;
+        }
+        return Event::MESSAGE;
+    }
+    
+    static uint8_t channelDataLength(uint8_t status) {
+        switch (status & 0xF0) {
+            case 0xC0:
+            case 0xD0:
+                return 1;
+            default:
+                return 2;
+        }
+    }
+    
+    static uint8_t systemCommonLength(uint8_t status) {
+        switch (status) {
+            case 0xF1: return 1;  // MTC quarter frame
+            case 0xF2: return 2;  // Song position pointer
+            case 0xF3: return 1;  // Song select
+            default:   return 0;
+        }
     }
 };
 
-// Main TurboMIDI class
-class TurboMIDI {
+// Frame layout: SYSEX_START, 5-byte Elektron ID, command ID, payload, SYSEX_END
+constexpr size_t COMMAND_HEADER_LENGTH = 7;
+constexpr size_t commandFrameLength(size_t payloadLength) {
+    return COMMAND_HEADER_LENGTH + payloadLength + 1;
+}
+
+constexpr size_t SPEED_ANSWER_LENGTH = commandFrameLength(4);
+constexpr size_t SPEED_ANSWER_EXT_LENGTH = commandFrameLength(5);  // With a capability byte
+constexpr size_t SPEED_NEG_LENGTH = commandFrameLength(2);
+constexpr size_t SPEED_PUSH_LENGTH = commandFrameLength(1);
+constexpr size_t MAX_COMMAND_LENGTH = commandFrameLength(8);  // SPEED_TEST/SPEED_RESULT
+
+// Fixed protocol frames, built at compile time
+constexpr Array<uint8_t, commandFrameLength(0)> SPEED_REQ_FRAME = {{
+    SYSEX_START, 0x00, 0x20, 0x3C, 0x00, 0x00, static_cast<uint8_t>(CommandID::SPEED_REQ), SYSEX_END
+}};
+constexpr Array<uint8_t, commandFrameLength(0)> SPEED_ACK_FRAME = {{
+    SYSEX_START, 0x00, 0x20, 0x3C, 0x00, 0x00, static_cast<uint8_t>(CommandID::SPEED_ACK), SYSEX_END
+}};
+constexpr Array<uint8_t, commandFrameLength(8)> SPEED_TEST_FRAME = {{
+    SYSEX_START, 0x00, 0x20, 0x3C, 0x00, 0x00, static_cast<uint8_t>(CommandID::SPEED_TEST),
+    0x55, 0x55, 0x55, 0x55, 0x00, 0x00, 0x00, 0x00, SYSEX_END
+}};
+constexpr Array<uint8_t, commandFrameLength(8)> SPEED_RESULT_FRAME = {{
+    SYSEX_START, 0x00, 0x20, 0x3C, 0x00, 0x00, static_cast<uint8_t>(CommandID::SPEED_RESULT),
+    0x55, 0x55, 0x55, 0x55, 0x00, 0x00, 0x00, 0x00, SYSEX_END
+}};
+constexpr Array<uint8_t, commandFrameLength(0)> SPEED_TEST2_FRAME = {{
+    SYSEX_START, 0x00, 0x20, 0x3C, 0x00, 0x00, static_cast<uint8_t>(CommandID::SPEED_TEST2), SYSEX_END
+}};
+constexpr Array<uint8_t, commandFrameLength(0)> SPEED_RESULT2_FRAME = {{
+    SYSEX_START, 0x00, 0x20, 0x3C, 0x00, 0x00, static_cast<uint8_t>(CommandID::SPEED_RESULT2), SYSEX_END
+}};
+
+// Capability bits of the optional fifth SPEED_ANSWER payload byte
+constexpr uint8_t LINK_TEST_CAPABILITY = 0x01;  // Answers LINK_TEST (see TurboMIDI::enableLinkTest)
+
+// LINK_TEST: payload length (3 x 7 bits) and PRBS seed (2 x 7 bits), then the payload and SYSEX_END
+constexpr size_t LINK_TEST_HEADER_LENGTH = COMMAND_HEADER_LENGTH + 5;
+// LINK_REPORT: damaged, flipped-bit and lost counts (3 x 7 bits each), then the payload and SYSEX_END
+constexpr size_t LINK_REPORT_HEADER_LENGTH = COMMAND_HEADER_LENGTH + 9;
+
+#if TURBOMIDI_ENABLE_LINK_TEST
+static_assert(TURBOMIDI_MAX_FRAME_LENGTH > LINK_REPORT_HEADER_LENGTH,
+              "TURBOMIDI_MAX_FRAME_LENGTH must fit the LINK_REPORT header");
+
+// PRBS-15 (x^15 + x^14 + 1) sequence of the extended link test, 7 bits per byte
+class PrbsGenerator {
 public:
-    TurboMIDI(IPlatform* platform, DeviceRole role = DeviceRole::ANY) 
-        : platform_(platform), role_(role), currentSpeed_(SpeedMultiplier::SPEED_1X),
-          lastActiveSenseTime_(0), lastMessageTime_(0), testState_(TestState::IDLE),
-          pendingTestSpeed_(SpeedMultiplier::SPEED_1X), 
-          pendingTargetSpeed_(SpeedMultiplier::SPEED_1X) {
-        // Initialize with only 1x speed supported by default
-        localConfig_.addSpeed(SpeedMultiplier::SPEED_1X, true);
+    explicit PrbsGenerator(uint16_t seed = 1) { reset(seed); }
+    
+    void reset(uint16_t seed) {
+        state_ = static_cast<uint16_t>(seed & 0x7FFF);
+        if (state_ == 0) state_ = 1;  // The all-zero state never leaves zero
+    }
+    
+    uint8_t next() {
+        uint8_t byte = 0;
+        for (int bit = 0; bit < 7; ++bit) {
+            uint16_t feedback = ((state_ >> 14) ^ (state_ >> 13)) & 1;
+            state_ = static_cast<uint16_t>(((state_ << 1) | feedback) & 0x7FFF);
+            byte = static_cast<uint8_t>((byte << 1) | feedback);
+        }
+        return byte;
+    }
+    
+private:
+    uint16_t state_;
+};
+
+// One direction of an extended link test, as counted by the receiver
+struct LinkTestCounts {
+    uint32_t bytes = 0;        // Payload bytes expected
+    uint32_t byteErrors = 0;   // Bytes not received intact: damaged, lost or surplus
+    uint32_t bitErrors = 0;    // Flipped bits in the damaged bytes
+    uint32_t lostBytes = 0;    // Missing from the stream, included in byteErrors
+};
+
+/**
+ * Streaming check of a received PRBS payload
+ *
+ * Compares every byte with the expected sequence as it arrives, so a
+ * payload of any length passes through the small frame assembler. A byte
+ * that matches the one after the expected byte counts as one lost byte
+ * and resynchronizes the check; a dropped byte does not turn the rest of
+ * the payload into errors.
+ */
+class LinkTestChecker {
+public:
+    void begin(uint32_t length, uint16_t seed) {
+        prbs_.reset(seed);
+        counts_ = LinkTestCounts();
+        counts_.bytes = length;
+        checked_ = 0;
+        expected_ = prbs_.next();
+        following_ = prbs_.next();
+        active_ = true;
+    }
+    
+    bool active() const { return active_; }
+    
+    // Still inside the announced payload, where the sender puts data bytes only
+    bool expectsPayload() const { return active_ && checked_ < counts_.bytes; }
+    
+    void check(const uint8_t* data, size_t length) {
+        for (size_t i = 0; i < length; ++i) checkByte(data[i]);
+    }
+    
+    // End of the frame: bytes that never arrived count as lost
+    const LinkTestCounts& finish() {
+        if (active_ && checked_ < counts_.bytes) {
+            uint32_t missing = counts_.bytes - checked_;
+            counts_.lostBytes += missing;
+            counts_.byteErrors += missing;
+        }
+        active_ = false;
+        return counts_;
+    }
+    
+    void abort() { active_ = false; }
+    
+private:
+    PrbsGenerator prbs_;
+    LinkTestCounts counts_;
+    uint32_t checked_ = 0;   // Payload positions consumed
+    uint8_t expected_ = 0;
+    uint8_t following_ = 0;
+    bool active_ = false;
+    
+    void checkByte(uint8_t byte) {
+        if (checked_ >= counts_.bytes) {
+            ++counts_.byteErrors;  // Surplus
+            return;
+        }
+        if (byte == expected_) {
+            advance(1);
+            return;
+        }
+        ++counts_.byteErrors;
+        if (byte == following_ && checked_ + 1 < counts_.bytes) {
+            ++counts_.lostBytes;
+            advance(2);
+            return;
+        }
+        for (uint8_t flips = static_cast<uint8_t>(byte ^ expected_); flips; flips &= static_cast<uint8_t>(flips - 1)) {
+            ++counts_.bitErrors;
+        }
+        advance(1);
+    }
+    
+    void advance(uint32_t positions) {
+        checked_ += positions;
+        while (positions-- > 0) {
+            expected_ = following_;
+            following_ = prbs_.next();
+        }
+    }
+};
+#endif
+
+// Command builders
+class CommandBuilder {
+public:
+    // Allocation-free encoders: write the frame into `out` and return its length.
+    // `out` must hold at least the matching *_LENGTH bytes (MAX_COMMAND_LENGTH fits all).
+    // A non-zero `capabilities` byte is appended for peers that understand it (SPEED_ANSWER_EXT_LENGTH)
+    static size_t encodeSpeedAnswer(uint8_t* out, const SpeedConfig& config, uint8_t capabilities = 0) {
+        const uint8_t payload[] = {config.mask1, config.mask2, config.cert1, config.cert2, capabilities};
+        return encodeCommand(out, CommandID::SPEED_ANSWER, payload, capabilities ? 5 : 4);
+    }
+    
+    static size_t encodeSpeedNeg(uint8_t* out, SpeedMultiplier testSpeed, SpeedMultiplier targetSpeed) {
+        const uint8_t payload[] = {static_cast<uint8_t>(testSpeed), static_cast<uint8_t>(targetSpeed)};
+        return encodeCommand(out, CommandID::SPEED_NEG, payload, sizeof(payload));
+    }
+    
+    static size_t encodeSpeedPush(uint8_t* out, SpeedMultiplier speed) {
+        const uint8_t payload[] = {static_cast<uint8_t>(speed)};
+        return encodeCommand(out, CommandID::SPEED_PUSH, payload, sizeof(payload));
+    }
+    
+#if TURBOMIDI_ENABLE_LINK_TEST
+    // Link test headers: the PRBS payload and SYSEX_END are sent after them
+    static size_t encodeLinkTestHeader(uint8_t* out, uint32_t payloadBytes, uint16_t seed) {
+        uint8_t fields[5];
+        putField(fields, payloadBytes, 3);
+        putField(fields + 3, seed, 2);
+        return encodeHeader(out, CommandID::LINK_TEST, fields, sizeof(fields));
+    }
+    
+    static size_t encodeLinkReportHeader(uint8_t* out, const LinkTestCounts& counts) {
+        uint8_t fields[9];
+        putField(fields, counts.byteErrors, 3);
+        putField(fields + 3, counts.bitErrors, 3);
+        putField(fields + 6, counts.lostBytes, 3);
+        return encodeHeader(out, CommandID::LINK_REPORT, fields, sizeof(fields));
+    }
+    
+    // Little-endian groups of 7 bits, saturating
+    static void putField(uint8_t* out, uint32_t value, size_t groups) {
+        const uint32_t max = (1u << (7 * groups)) - 1;
+        if (value > max) value = max;
+        for (size_t i = 0; i < groups; ++i) out[i] = static_cast<uint8_t>((value >> (7 * i)) & 0x7F);
+    }
+    
+    static uint32_t readField(const uint8_t* field, size_t groups) {
+        uint32_t value = 0;
+        for (size_t i = 0; i < groups; ++i) value |= static_cast<uint32_t>(field[i] & 0x7F) << (7 * i);
+        return value;
+    }
+#endif
+    
+    static size_t encodeCommand(uint8_t* out, CommandID cmd, const uint8_t* payload, size_t payloadLength) {
+        size_t length = encodeHeader(out, cmd, payload, payloadLength);
+        out[length++] = SYSEX_END;
+        return length;
+    }
+    
+    // Frame without its SYSEX_END, for commands that stream more data after it
+    static size_t encodeHeader(uint8_t* out, CommandID cmd, const uint8_t* payload, size_t payloadLength) {
+        size_t length = 0;
+        out[length++] = SYSEX_START;
+        for (uint8_t idByte : ELEKTRON_ID) {
+            out[length++] = idByte;
+        }
+        out[length++] = static_cast<uint8_t>(cmd);
+        for (size_t i = 0; i < payloadLength; ++i) {
+            out[length++] = payload[i];
+        }
+        return length;
+    }
+    
+#if !TURBOMIDI_MINIMAL
+    // Convenience builders returning a vector (allocate; not used on the hot path)
+    static std::vector<uint8_t> buildSpeedReq() {
+        return toVector(SPEED_REQ_FRAME);
+    }
+    
+    static std::vector<uint8_t> buildSpeedAnswer(const SpeedConfig& config) {
+        uint8_t frame[SPEED_ANSWER_LENGTH];
+        return std::vector<uint8_t>(frame, frame + encodeSpeedAnswer(frame, config));
+    }
+    
+    static std::vector<uint8_t> buildSpeedNeg(SpeedMultiplier testSpeed, SpeedMultiplier targetSpeed) {
+        uint8_t frame[SPEED_NEG_LENGTH];
+        return std::vector<uint8_t>(frame, frame + encodeSpeedNeg(frame, testSpeed, targetSpeed));
+    }
+    
+    static std::vector<uint8_t> buildSpeedAck() {
+        return toVector(SPEED_ACK_FRAME);
+    }
+    
+    static std::vector<uint8_t> buildSpeedTest() {
+        return toVector(SPEED_TEST_FRAME);
+    }
+    
+    static std::vector<uint8_t> buildSpeedResult() {
+        return toVector(SPEED_RESULT_FRAME);
+    }
+    
+    static std::vector<uint8_t> buildSpeedTest2() {
+        return toVector(SPEED_TEST2_FRAME);
+    }
+    
+    static std::vector<uint8_t> buildSpeedResult2() {
+        return toVector(SPEED_RESULT2_FRAME);
+    }
+    
+    static std::vector<uint8_t> buildSpeedPush(SpeedMultiplier speed) {
+        uint8_t frame[SPEED_PUSH_LENGTH];
+        return std::vector<uint8_t>(frame, frame + encodeSpeedPush(frame, speed));
+    }
+    
+private:
+    template <size_t N>
+    static std::vector<uint8_t> toVector(const std::array<uint8_t, N>& frame) {
+        return std::vector<uint8_t>(frame.begin(), frame.end());
+    }
+#endif
+};
+
+// Number of peers remembered by PeerCache
+#ifndef TURBOMIDI_PEER_CACHE_SIZE
+#define TURBOMIDI_PEER_CACHE_SIZE 4
+#endif
+
+// Persistence hook for PeerCache (EEPROM/flash on microcontrollers, a file on hosts)
+class IPeerCacheStore {
+public:
+    virtual ~IPeerCacheStore() = default;
+    
+    // Fill `data` with previously saved bytes; return false if nothing is saved
+    virtual bool load(uint8_t* data, size_t length) = 0;
+    
+    // Persist `length` bytes
+    virtual void save(const uint8_t* data, size_t length) = 0;
+};
+
+/**
+ * Last successful negotiation per peer, keyed on the peer's SPEED_ANSWER
+ *
+ * Attached to a master with TurboMIDI::attachPeerCache(). Best-speed
+ * negotiations then try the cached speed right after the SPEED_ANSWER and
+ * skip the search when it still works. Least recently used entries are
+ * replaced when the cache is full.
+ */
+class PeerCache {
+public:
+    struct Entry {
+        SpeedConfig peer;
+        SpeedMultiplier speed = SpeedMultiplier::SPEED_1X;
+        bool tested = false;   // Speed was verified with a speed test (not certified by the peer)
+        uint8_t age = 0;       // 0 = most recently used
+        bool valid = false;
+    };
+    
+    static constexpr size_t CAPACITY = TURBOMIDI_PEER_CACHE_SIZE;
+    static constexpr size_t ENTRY_BYTES = 6;
+    static constexpr size_t STORAGE_BYTES = 3 + CAPACITY * ENTRY_BYTES;
+    
+    const Entry* lookup(const SpeedConfig& peer) {
+        Entry* entry = find(peer);
+        if (entry) touch(*entry);
+        return entry;
+    }
+    
+    void store(const SpeedConfig& peer, SpeedMultiplier speed, bool tested) {
+        Entry* entry = find(peer);
+        if (entry && entry->speed == speed && entry->tested == tested) {
+            touch(*entry);
+            return;
+        }
+        if (!entry) entry = &entries_[oldest()];
+        entry->peer = peer;
+        entry->speed = speed;
+        entry->tested = tested;
+        entry->valid = true;
+        touch(*entry);
+        persist();
+    }
+    
+    void remove(const SpeedConfig& peer) {
+        Entry* entry = find(peer);
+        if (!entry) return;
+        entry->valid = false;
+        persist();
+    }
+    
+    void clear() {
+        for (Entry& entry : entries_) entry.valid = false;
+        persist();
+    }
+    
+    size_t size() const {
+        size_t count = 0;
+        for (const Entry& entry : entries_) count += entry.valid ? 1 : 0;
+        return count;
+    }
+    
+    // Attach a persistence hook and load the saved entries from it
+    void setStore(IPeerCacheStore* store) {
+        store_ = store;
+        uint8_t data[STORAGE_BYTES];
+        if (store_ && store_->load(data, sizeof(data))) deserialize(data);
+    }
+    
+    // Fixed-size image: magic, version, entry count, then peer masks, speed and flags
+    void serialize(uint8_t* out) const {
+        out[0] = STORAGE_MAGIC;
+        out[1] = STORAGE_VERSION;
+        out[2] = static_cast<uint8_t>(CAPACITY);
+        for (size_t i = 0; i < CAPACITY; ++i) {
+            const Entry& entry = entries_[i];
+            uint8_t* slot = out + 3 + i * ENTRY_BYTES;
+            slot[0] = entry.peer.mask1;
+            slot[1] = entry.peer.mask2;
+            slot[2] = entry.peer.cert1;
+            slot[3] = entry.peer.cert2;
+            slot[4] = static_cast<uint8_t>(entry.speed);
+            slot[5] = static_cast<uint8_t>((entry.valid ? 0x01 : 0) | (entry.tested ? 0x02 : 0) | (entry.age << 2));
+        }
+    }
+    
+    bool deserialize(const uint8_t* data) {
+        if (data[0] != STORAGE_MAGIC || data[1] != STORAGE_VERSION || data[2] != CAPACITY) return false;
+        for (size_t i = 0; i < CAPACITY; ++i) {
+            const uint8_t* slot = data + 3 + i * ENTRY_BYTES;
+            Entry& entry = entries_[i];
+            entry.peer.mask1 = slot[0];
+            entry.peer.mask2 = slot[1];
+            entry.peer.cert1 = slot[2];
+            entry.peer.cert2 = slot[3];
+            entry.speed = static_cast<SpeedMultiplier>(slot[4]);
+            entry.valid = (slot[5] & 0x01) != 0 && slot[4] >= 2 && slot[4] <= 11;
+            entry.tested = (slot[5] & 0x02) != 0;
+            entry.age = static_cast<uint8_t>(slot[5] >> 2);
+        }
+        return true;
+    }
+    
+private:
+    static constexpr uint8_t STORAGE_MAGIC = 0x54;  // 'T'
+    static constexpr uint8_t STORAGE_VERSION = 1;
+    
+    Entry entries_[CAPACITY];
+    IPeerCacheStore* store_ = nullptr;
+    
+    static bool samePeer(const SpeedConfig& a, const SpeedConfig& b) {
+        return a.mask1 == b.mask1 && a.mask2 == b.mask2 && a.cert1 == b.cert1 && a.cert2 == b.cert2;
+    }
+    
+    Entry* find(const SpeedConfig& peer) {
+        for (Entry& entry : entries_) {
+            if (entry.valid && samePeer(entry.peer, peer)) return &entry;
+        }
+        return nullptr;
+    }
+    
+    void touch(Entry& used) {
+        for (Entry& entry : entries_) {
+            if (&entry != &used && entry.age < 63) ++entry.age;
+        }
+        used.age = 0;
+    }
+    
+    size_t oldest() const {
+        size_t index = 0;
+        for (size_t i = 0; i < CAPACITY; ++i) {
+            if (!entries_[i].valid) return i;
+            if (entries_[i].age > entries_[index].age) index = i;
+        }
+        return index;
+    }
+    
+    void persist() {
+        if (!store_) return;
+        uint8_t data[STORAGE_BYTES];
+        serialize(data);
+        store_->save(data, sizeof(data));
+    }
+};
+
+// Tuning of the adaptive speed controller (see TurboMIDI::enableAdaptiveSpeed)
+struct AdaptiveSpeedConfig {
+    uint16_t errorThreshold = 4;       // Link errors within errorWindowMs that trigger a step down
+    uint32_t errorWindowMs = 1000;
+    uint32_t probeIntervalMs = 10000;  // Error-free time at a speed before probing the next higher one
+    uint32_t recoveryDelayMs = 400;    // Wait after a link timeout so the peer is back at 1x as well
+};
+
+// Chunking and pacing of TurboMIDI::beginSysExSend
+struct SysExSendConfig {
+    uint16_t chunkSize = 256;       // Bytes handed to the platform per write
+    uint32_t chunkGapMicros = 0;    // Pause between chunks, for peers that process dumps slowly
+    uint16_t maxQueuedBytes = 0;    // Dump bytes allowed ahead on the line, for platforms without realtime priority; 0 = no limit
+};
+
+#if TURBOMIDI_ENABLE_LINK_TEST
+// Extended link test run with every speed test (see TurboMIDI::enableLinkTest)
+struct LinkTestConfig {
+    uint32_t payloadBytes = 1024;  // PRBS bytes each way, capped to 150 ms on the wire at the test speed
+    uint32_t maxByteErrors = 0;    // Damaged or lost bytes, both directions together, that still pass
+    uint16_t seed = 1;             // PRBS start state (14 bits)
+};
+
+// Outcome of the last extended link test (see TurboMIDI::getLinkQuality)
+struct LinkQuality {
+    SpeedMultiplier speed = SpeedMultiplier::SPEED_1X;  // Test speed
+    bool completed = false;        // LINK_REPORT arrived; false after a timeout
+    bool passed = false;
+    LinkTestCounts sent;           // Master to slave, as the slave counted it
+    LinkTestCounts received;       // Slave to master
+    uint32_t exchangeMicros = 0;   // LINK_TEST header out until the end of LINK_REPORT
+    
+    uint32_t bytes() const { return sent.bytes + received.bytes; }
+    uint32_t byteErrors() const { return sent.byteErrors + received.byteErrors; }
+    uint32_t bitErrors() const { return sent.bitErrors + received.bitErrors; }
+    
+    uint32_t intactBytes() const {
+        return intact(sent) + intact(received);
+    }
+    
+    double byteErrorRate() const {
+        return bytes() ? static_cast<double>(byteErrors()) / bytes() : 0.0;
+    }
+    
+    // Flipped bits per bit of the payload bytes that arrived (lost bytes only count in byteErrorRate)
+    double bitErrorRate() const {
+        uint32_t arrived = bytes() - sent.lostBytes - received.lostBytes;
+        return arrived ? static_cast<double>(bitErrors()) / (8.0 * arrived) : 0.0;
+    }
+    
+    // Intact payload bytes, both directions, per second of the exchange
+    uint32_t throughputBytesPerSecond() const {
+        return exchangeMicros ? static_cast<uint32_t>(intactBytes() * 1000000.0 / exchangeMicros) : 0;
+    }
+    
+private:
+    static uint32_t intact(const LinkTestCounts& counts) {
+        return counts.byteErrors < counts.bytes ? counts.bytes - counts.byteErrors : 0;
+    }
+};
+#endif
+
+/**
+ * Priority queue of timestamped MIDI messages for TurboMIDI::scheduleMessage
+ *
+ * A binary heap ordered by due time (wrap-safe over ~35 minutes of
+ * microseconds); messages with the same due time keep their insertion
+ * order. Holds channel, system common and realtime messages of up to three
+ * bytes. Not thread-safe: use it from the thread that calls
+ * handleIncomingData(). Use TxScheduler<N> to get a queue with its own
+ * storage.
+ */
+class ScheduledTxQueue {
+public:
+    static constexpr size_t MAX_MESSAGE_LENGTH = 3;
+    
+    struct Entry {
+        uint32_t dueMicros;
+        uint16_t sequence;
+        uint8_t length;
+        uint8_t data[MAX_MESSAGE_LENGTH];
+    };
+    
+    // False if the message is too long or the queue is full (counted as dropped)
+    bool push(uint32_t dueMicros, const uint8_t* data, size_t length) {
+        if (length == 0 || length > MAX_MESSAGE_LENGTH || size_ >= capacity_) {
+            ++droppedMessages_;
+            return false;
+        }
+        
+        Entry entry;
+        entry.dueMicros = dueMicros;
+        entry.sequence = nextSequence_++;
+        entry.length = static_cast<uint8_t>(length);
+        memcpy(entry.data, data, length);
+        
+        // Sift up
+        size_t index = size_++;
+        while (index > 0) {
+            size_t parent = (index - 1) / 2;
+            if (!earlier(entry, storage_[parent])) break;
+            storage_[index] = storage_[parent];
+            index = parent;
+        }
+        storage_[index] = entry;
+        return true;
+    }
+    
+    // Earliest message, nullptr if empty
+    const Entry* top() const { return size_ > 0 ? &storage_[0] : nullptr; }
+    
+    void pop() {
+        if (size_ == 0) return;
+        Entry last = storage_[--size_];
+        
+        // Sift the last entry down from the root
+        size_t index = 0;
+        while (true) {
+            size_t child = 2 * index + 1;
+            if (child >= size_) break;
+            if (child + 1 < size_ && earlier(storage_[child + 1], storage_[child])) ++child;
+            if (!earlier(storage_[child], last)) break;
+            storage_[index] = storage_[child];
+            index = child;
+        }
+        if (size_ > 0) storage_[index] = last;
+    }
+    
+    void clear() { size_ = 0; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return capacity_; }
+    uint32_t droppedMessages() const { return droppedMessages_; }
+    
+protected:
+    ScheduledTxQueue(Entry* storage, size_t capacity) : storage_(storage), capacity_(capacity) {}
+    
+    ScheduledTxQueue(const ScheduledTxQueue&) = delete;
+    ScheduledTxQueue& operator=(const ScheduledTxQueue&) = delete;
+    
+private:
+    Entry* const storage_;
+    const size_t capacity_;
+    size_t size_ = 0;
+    uint16_t nextSequence_ = 0;
+    uint32_t droppedMessages_ = 0;
+    
+    static bool earlier(const Entry& a, const Entry& b) {
+        int32_t due = static_cast<int32_t>(a.dueMicros - b.dueMicros);
+        if (due != 0) return due < 0;
+        return static_cast<int16_t>(a.sequence - b.sequence) < 0;
+    }
+};
+
+template <size_t Capacity>
+class TxScheduler : public ScheduledTxQueue {
+    static_assert(Capacity > 0 && Capacity <= 0x4000, "Insertion order is tracked with a 16-bit sequence");
+    
+public:
+    TxScheduler() : ScheduledTxQueue(storage_, Capacity) {}
+    
+private:
+    Entry storage_[Capacity];
+};
+
+// Role policies for BasicTurboMIDI
+
+// Role chosen at run time (used by TurboMIDI)
+class RuntimeRole {
+public:
+    explicit RuntimeRole(DeviceRole role) : role_(role) {}
+    DeviceRole role() const { return role_; }
+    
+private:
+    DeviceRole role_;
+};
+
+// Role fixed at compile time; code for the other role is dropped by the optimizer
+template <DeviceRole Role>
+class FixedRole {
+public:
+    explicit FixedRole(DeviceRole) {}
+    static constexpr DeviceRole role() { return Role; }
+};
+
+// Callback policies for BasicTurboMIDI. Each provides the protected notify*
+// hooks the protocol calls; they are public bases, so their members are part
+// of the BasicTurboMIDI interface.
+
+// Callback members (used by TurboMIDI): std::function, or plain function
+// pointers with TURBOMIDI_MINIMAL
+class FunctionCallbacks {
+public:
+    // Callbacks for slave mode
+    Callback<void(SpeedMultiplier)> onSpeedChanged;
+    Callback<void()> onSpeedRequest;
+    
+    // Callbacks for application traffic received alongside the protocol
+    Callback<void(const MidiMessage&)> onMidiMessage;
+    Callback<void(uint8_t)> onRealtime;  // Clock, start/stop etc. (not active sensing)
+    
+    // Streaming SysEx: chunks point into the receive buffer and are only valid during the call
+    Callback<void()> onSysExBegin;
+    Callback<void(const uint8_t*, size_t)> onSysExChunk;
+    Callback<void(bool)> onSysExEnd;     // true if terminated by SYSEX_END, false if aborted
+    
+    // Callback for master mode: negotiation finished (success, resulting speed)
+    Callback<void(bool, SpeedMultiplier)> onNegotiationComplete;
+    
+protected:
+    void notifySpeedChanged(SpeedMultiplier speed) { if (onSpeedChanged) onSpeedChanged(speed); }
+    void notifySpeedRequest() { if (onSpeedRequest) onSpeedRequest(); }
+    void notifyMidiMessage(const MidiMessage& message) { if (onMidiMessage) onMidiMessage(message); }
+    void notifyRealtime(uint8_t byte) { if (onRealtime) onRealtime(byte); }
+    void notifySysExBegin() { if (onSysExBegin) onSysExBegin(); }
+    void notifySysExChunk(const uint8_t* data, size_t length) { if (onSysExChunk) onSysExChunk(data, length); }
+    void notifySysExEnd(bool complete) { if (onSysExEnd) onSysExEnd(complete); }
+    void notifyNegotiationComplete(bool success, SpeedMultiplier speed) {
+        if (onNegotiationComplete) onNegotiationComplete(success, speed);
+    }
+};
+
+// Plain function pointers sharing one context pointer; no <functional> machinery
+class PointerCallbacks {
+public:
+    void* callbackContext = nullptr;
+    void (*onSpeedChanged)(void* context, SpeedMultiplier speed) = nullptr;
+    void (*onSpeedRequest)(void* context) = nullptr;
+    void (*onMidiMessage)(void* context, const MidiMessage& message) = nullptr;
+    void (*onRealtime)(void* context, uint8_t byte) = nullptr;
+    void (*onSysExBegin)(void* context) = nullptr;
+    void (*onSysExChunk)(void* context, const uint8_t* data, size_t length) = nullptr;
+    void (*onSysExEnd)(void* context, bool complete) = nullptr;
+    void (*onNegotiationComplete)(void* context, bool success, SpeedMultiplier speed) = nullptr;
+    
+protected:
+    void notifySpeedChanged(SpeedMultiplier speed) { if (onSpeedChanged) onSpeedChanged(callbackContext, speed); }
+    void notifySpeedRequest() { if (onSpeedRequest) onSpeedRequest(callbackContext); }
+    void notifyMidiMessage(const MidiMessage& message) {
+        if (onMidiMessage) onMidiMessage(callbackContext, message);
+    }
+    void notifyRealtime(uint8_t byte) { if (onRealtime) onRealtime(callbackContext, byte); }
+    void notifySysExBegin() { if (onSysExBegin) onSysExBegin(callbackContext); }
+    void notifySysExChunk(const uint8_t* data, size_t length) {
+        if (onSysExChunk) onSysExChunk(callbackContext, data, length);
+    }
+    void notifySysExEnd(bool complete) { if (onSysExEnd) onSysExEnd(callbackContext, complete); }
+    void notifyNegotiationComplete(bool success, SpeedMultiplier speed) {
+        if (onNegotiationComplete) onNegotiationComplete(callbackContext, success, speed);
+    }
+};
+
+// Base for StaticCallbacks handlers: derive and hide the functions you need
+struct NoCallbacks {
+    static void onSpeedChanged(SpeedMultiplier) {}
+    static void onSpeedRequest() {}
+    static void onMidiMessage(const MidiMessage&) {}
+    static void onRealtime(uint8_t) {}
+    static void onSysExBegin() {}
+    static void onSysExChunk(const uint8_t*, size_t) {}
+    static void onSysExEnd(bool) {}
+    static void onNegotiationComplete(bool, SpeedMultiplier) {}
+};
+
+// Static calls into Handler, resolved and inlined at compile time
+template <typename Handler>
+class StaticCallbacks {
+protected:
+    void notifySpeedChanged(SpeedMultiplier speed) { Handler::onSpeedChanged(speed); }
+    void notifySpeedRequest() { Handler::onSpeedRequest(); }
+    void notifyMidiMessage(const MidiMessage& message) { Handler::onMidiMessage(message); }
+    void notifyRealtime(uint8_t byte) { Handler::onRealtime(byte); }
+    void notifySysExBegin() { Handler::onSysExBegin(); }
+    void notifySysExChunk(const uint8_t* data, size_t length) { Handler::onSysExChunk(data, length); }
+    void notifySysExEnd(bool complete) { Handler::onSysExEnd(complete); }
+    void notifyNegotiationComplete(bool success, SpeedMultiplier speed) {
+        Handler::onNegotiationComplete(success, speed);
+    }
+};
+
+/**
+ * TurboMIDI protocol engine
+ *
+ * RolePolicy is RuntimeRole or FixedRole<role>; Callbacks is
+ * FunctionCallbacks, PointerCallbacks or StaticCallbacks<Handler>.
+ * TurboMIDI is the runtime-role, std::function flavour.
+ */
+template <typename RolePolicy, typename Callbacks>
+class BasicTurboMIDI : public Callbacks {
+public:
+    BasicTurboMIDI(IPlatform* platform, DeviceRole role = DeviceRole::ANY) 
+        : platform_(platform), role_(role), currentSpeed_(SpeedMultiplier::SPEED_1X),
+          lastActiveSenseTime_(0), lastMessageTime_(0), testState_(TestState::IDLE),
+          pendingTestSpeed_(SpeedMultiplier::SPEED_1X), 
+          pendingTargetSpeed_(SpeedMultiplier::SPEED_1X) {
+        // Initialize with only 1x speed supported by default
+        localConfig_.addSpeed(SpeedMultiplier::SPEED_1X, true);
+    }
+    
+    // Configure supported speeds
+    void setSupportedSpeed(SpeedMultiplier speed, bool certified = false) {
+        localConfig_.addSpeed(speed, certified);
+    }
+    
+    const SpeedConfig& getSupportedSpeeds() const { return localConfig_; }
+    
+    /**
+     * Master: pause between the breathing bytes and the switch to the test
+     * speed (default 10ms). It must cover the slave's baud rate switch, so
+     * peers that re-clock their UART in place can use less.
+     */
+    void setBreathingTime(uint32_t ms) { breathingTimeMs_ = ms; }
+    
+#if TURBOMIDI_ENABLE_LINK_TEST
+    /**
+     * Extended link test (vendor extension), enabled on both sides. A slave
+     * advertises it in SPEED_ANSWER and answers LINK_TEST; a master then
+     * follows every passed SPEED_TEST with config.payloadBytes of PRBS data
+     * each way at the test speed, and only moves on to the target speed
+     * when at most config.maxByteErrors bytes arrived damaged or lost.
+     * Peers that do not advertise it get the plain speed test.
+     */
+    void enableLinkTest(const LinkTestConfig& config = LinkTestConfig()) {
+        linkTest_.enabled = true;
+        linkTest_.config = config;
+    }
+    
+    void disableLinkTest() { linkTest_.enabled = false; }
+    
+    // Master: error counts and throughput of the last extended link test
+    const LinkQuality& getLinkQuality() const { return linkTest_.quality; }
+#endif
+    
+    // Master functions
+    
+    /**
+     * Negotiate a speed change, blocking until it succeeds or fails.
+     * Equivalent to beginNegotiation() followed by polling handleIncomingData().
+     */
+    bool negotiateSpeed(SpeedMultiplier targetSpeed, uint32_t timeoutMs = 30) {
+        if (!beginNegotiation(targetSpeed, timeoutMs)) return false;
+        return waitForNegotiation();
+    }
+    
+    /**
+     * Negotiate the fastest speed both sides support, blocking until done.
+     * Equivalent to beginBestNegotiation() followed by polling handleIncomingData().
+     * @return true if the link now runs faster than 1x
+     */
+    bool negotiateBestSpeed(uint32_t timeoutMs = 30) {
+        if (!beginBestNegotiation(timeoutMs)) return false;
+        return waitForNegotiation();
+    }
+    
+    /**
+     * Start a negotiation for the fastest mutually supported speed.
+     * A single SPEED_REQ/SPEED_ANSWER exchange yields the peer's speeds. The
+     * highest speed certified by the peer is selected without a test, then
+     * the faster uncertified speeds are binary-searched with speed tests.
+     * @return false if this device is a slave or a negotiation is already running
+     */
+    bool beginBestNegotiation(uint32_t timeoutMs = 30) {
+        traceCall(TraceCall::NEGOTIATE_BEST, 0, timeoutMs);
+        return startNegotiation(SpeedMultiplier::SPEED_1X, timeoutMs, true);
+    }
+    
+    /**
+     * Start a speed negotiation and return immediately.
+     * Progress is driven by handleIncomingData(); the outcome is reported through
+     * getNegotiationStatus() and onNegotiationComplete.
+     * @return false if this device is a slave, a negotiation is already running
+     *         or a SysEx dump is being sent
+     */
+    bool beginNegotiation(SpeedMultiplier targetSpeed, uint32_t timeoutMs = 30) {
+        traceCall(TraceCall::NEGOTIATE, static_cast<uint8_t>(targetSpeed), timeoutMs);
+        return startNegotiation(targetSpeed, timeoutMs, false);
+    }
+    
+    // Abort a running negotiation; reverts to 1x if the speed test had started
+    void cancelNegotiation() {
+        traceCall(TraceCall::CANCEL);
+        if (negotiationStatus_ != NegotiationStatus::IN_PROGRESS) return;
+        bool testing = negotiation_.phase == NegotiationPhase::WAIT_RESULT ||
+                       negotiation_.phase == NegotiationPhase::WAIT_RESULT2 ||
+                       negotiation_.phase == NegotiationPhase::WAIT_LINK_REPORT;
+        finishNegotiation(false, testing);
+    }
+    
+    NegotiationStatus getNegotiationStatus() const { return negotiationStatus_; }
+    
+    // Per-phase timing of the running or last negotiation
+    const NegotiationTiming& getNegotiationTiming() const { return timing_; }
+    
+    /**
+     * Master: keep the link at the highest speed it can sustain, up to maxSpeed.
+     * Link errors step the speed down one multiplier at a time, a timeout
+     * renegotiates one step below the speed that failed instead of staying
+     * at 1x, and after probeIntervalMs without errors the next higher speed
+     * is tried. Driven by handleIncomingData().
+     * @return false if this device is a slave
+     */
+    bool enableAdaptiveSpeed(SpeedMultiplier maxSpeed, const AdaptiveSpeedConfig& config = AdaptiveSpeedConfig()) {
+        if (!actsAsMaster()) return false;
+        adaptive_ = Adaptive();
+        adaptive_.enabled = true;
+        adaptive_.config = config;
+        adaptive_.maxSpeed = maxSpeed;
+        adaptive_.sustained = currentSpeed_;
+        adaptive_.quietSince = nowMs();
+        adaptive_.windowStart = adaptive_.quietSince;
+        return true;
+    }
+    
+    void disableAdaptiveSpeed() { adaptive_.enabled = false; }
+    
+    /**
+     * Remember successful negotiations per peer; pass nullptr to detach.
+     * Best-speed negotiations try the cached speed first.
+     */
+    void attachPeerCache(PeerCache* cache) { peerCache_ = cache; }
+    
+#if TURBOMIDI_ENABLE_TRACE
+    // Record received and sent bytes, baud changes, negotiation state and
+    // application calls; pass nullptr to detach
+    void attachTraceRecorder(TraceRecorder* recorder) { traceRecorder_ = recorder; }
+#endif
+    bool isAdaptiveSpeedEnabled() const { return adaptive_.enabled; }
+    
+    // Report a receive error the platform detected (UART framing, parity, overrun)
+    void reportLinkError() {
+        if (!adaptive_.enabled || currentSpeed_ == SpeedMultiplier::SPEED_1X) return;
+        
+        uint32_t now = nowMs();
+        adaptive_.quietSince = now;
+        if (now - adaptive_.windowStart >= adaptive_.config.errorWindowMs) {
+            adaptive_.windowStart = now;
+            adaptive_.errors = 0;
+        }
+        if (++adaptive_.errors >= adaptive_.config.errorThreshold &&
+            negotiationStatus_ != NegotiationStatus::IN_PROGRESS && !isSysExSending()) {
+            stepDown(now);
+        }
+    }
+    
+    void pushSpeed(SpeedMultiplier speed) {
+        traceCall(TraceCall::PUSH_SPEED, static_cast<uint8_t>(speed));
+        sendSpeedPush(speed);
+    }
+    
+    // Slave functions
+    void handleIncomingData() {
+        // One clock read serves the whole poll; nested polls read their own
+        uint32_t now = platform_->getMillis();
+        pollMillis_ = now;
+        ++pollDepth_;
+        
+        if (receiveRing_) {
+            // Drain everything the producer has queued, in place
+            const uint8_t* region;
+            size_t length;
+            while ((length = receiveRing_->peek(region)) > 0) {
+                processIncomingBytes(region, length);
+                receiveRing_->consume(length);
+            }
+        } else {
+            const uint8_t* region;
+            size_t length = platform_->peekMidiData(region);
+            if (length > 0) {
+                // Parse in place in the driver's buffer
+                do {
+                    processIncomingBytes(region, length);
+                    platform_->consumeMidiData(length);
+                } while ((length = platform_->peekMidiData(region)) > 0);
+            } else {
+                uint8_t buffer[256];
+                size_t bytesRead = platform_->receiveMidiData(buffer, sizeof(buffer));
+                processIncomingBytes(buffer, bytesRead);
+            }
+        }
+        
+        // Advance a running negotiation, then run whatever timers are due
+        now = pollMillis_;
+        pollNegotiation(now);
+#if TURBOMIDI_ENABLE_LINK_TEST
+        pollLinkTestSend();
+#endif
+        checkTimeouts(now);
+        if (actsAsMaster() && adaptive_.enabled) pollAdaptive(now);
+        serviceTx();
+        --pollDepth_;
+    }
+    
+    /**
+     * getMillis() time by which handleIncomingData() must run again for
+     * active sensing, link and negotiation timeouts, adaptive speed and
+     * paced transmission; received data may need attention sooner. Lets the
+     * caller sleep until then.
+     * @return false if nothing is pending, i.e. only incoming data matters
+     */
+    bool nextDeadlineMs(uint32_t& deadline) {
+        uint32_t now = nowMs();
+        bool found = false;
+        activeSenseDue_.fold(found, deadline, now);
+        linkTimeoutDue_.fold(found, deadline, now);
+        negotiationDue_.fold(found, deadline, now);
+#if TURBOMIDI_ENABLE_LINK_TEST
+        if (linkTest_.sending) {
+            deadline = now;  // Next payload chunk
+            return true;
+        }
+#endif
+        
+        if (actsAsMaster() && adaptive_.enabled &&
+            negotiationStatus_ != NegotiationStatus::IN_PROGRESS && !isSysExSending()) {
+            Deadline adaptive;
+            if (adaptive_.recovering) {
+                adaptive.arm(adaptive_.recoverAt);
+            } else if (currentSpeed_ == adaptive_.sustained &&
+                       static_cast<uint8_t>(currentSpeed_) < static_cast<uint8_t>(adaptive_.maxSpeed)) {
+                adaptive.armAfter(adaptive_.quietSince, adaptive_.config.probeIntervalMs, now);
+            }
+            adaptive.fold(found, deadline, now);
+        }
+        
+        // Paced chunks and scheduled messages run on the microsecond clock
+        const ScheduledTxQueue::Entry* entry = txScheduler_ ? txScheduler_->top() : nullptr;
+        if (!txHeld() && (isSysExSending() || entry)) {
+            uint32_t micros = platform_->getMicros();
+            Deadline tx;
+            if (isSysExSending()) {
+                tx.arm(now + microsToMillis(sysExSend_.nextChunkAt - micros));
+                tx.fold(found, deadline, now);
+            }
+            if (entry) {
+                tx.arm(now + microsToMillis(releaseMicros(*entry, micros) - micros));
+                tx.fold(found, deadline, now);
+            }
+        }
+        return found;
+    }
+    
+    /**
+     * Receive from a ring filled by a UART ISR or reader thread instead of
+     * IPlatform::receiveMidiData(). Pass nullptr to go back to polling.
+     */
+    void attachReceiveRing(SpscByteRing* ring) { receiveRing_ = ring; }
+    
+    /**
+     * Send timestamped messages from a TxScheduler. Pass nullptr to detach;
+     * queued messages stay in the scheduler.
+     */
+    void attachTxScheduler(ScheduledTxQueue* scheduler) {
+        txScheduler_ = scheduler;
+        txBusyUntil_ = platform_->getMicros();
+    }
+    
+    /**
+     * Queue a message (1-3 bytes) to be on the wire at a given time.
+     * dueMicros (IPlatform::getMicros() time) is when the last byte has been
+     * sent. Transmission starts earlier by the message's byte time at the
+     * current speed plus the bytes this link still has in flight, so the
+     * timing holds after a speed change. Late messages are sent at once.
+     * Nothing is released while a speed test is running.
+     * @return false without an attached scheduler, or if it is full
+     */
+    bool scheduleMessage(uint32_t dueMicros, const uint8_t* data, size_t length) {
+        if (!txScheduler_) return false;
+        if (!txScheduler_->push(dueMicros, data, length)) return false;
+        serviceTxScheduler();
+        return true;
+    }
+    
+    bool scheduleMessage(uint32_t dueMicros, const MidiMessage& message) {
+        const uint8_t bytes[3] = {message.status, message.data1, message.data2};
+        return scheduleMessage(dueMicros, bytes, message.length);
+    }
+    
+    /**
+     * Release every scheduled message that is due. Also called by
+     * handleIncomingData(); call it in a tight loop (see nextTxReleaseMicros())
+     * for the lowest jitter.
+     */
+    void serviceTxScheduler() {
+        if (!txScheduler_ || txHeld()) return;
+        
+        const ScheduledTxQueue::Entry* entry;
+        while ((entry = txScheduler_->top()) != nullptr) {
+            // Only realtime bytes may appear inside the SysEx being sent
+            if (isSysExSending() && entry->data[0] < REALTIME_FIRST) break;
+            uint32_t now = platform_->getMicros();
+            if (static_cast<int32_t>(releaseMicros(*entry, now) - now) > 0) break;
+            if (entry->data[0] >= REALTIME_FIRST) {
+                transmitRealtime(TraceRecordType::TX_DATA, entry->data[0]);
+            } else {
+                sendData(entry->data, entry->length);
+            }
+            txScheduler_->pop();
+        }
+    }
+    
+    /**
+     * When the next scheduled message will be released
+     * @return false if nothing is scheduled
+     */
+    bool nextTxReleaseMicros(uint32_t& releaseAt) {
+        const ScheduledTxQueue::Entry* entry = txScheduler_ ? txScheduler_->top() : nullptr;
+        if (!entry) return false;
+        releaseAt = releaseMicros(*entry, platform_->getMicros());
+        return true;
+    }
+    
+    // Time one byte takes on the wire at the current speed, rounded up
+    uint32_t getByteTimeMicros() const { return wireTimeMicros(currentSpeed_, 1); }
+    
+    /**
+     * Start sending a complete SysEx message (SYSEX_START ... SYSEX_END)
+     * straight from `data`, config.chunkSize bytes at a time with
+     * config.chunkGapMicros between chunks. A chunk is handed to the
+     * platform in pieces no larger than IPlatform::txSpace(), so a small
+     * TX queue never blocks the caller. `data` must stay valid until
+     * isSysExSending() returns false. Driven by handleIncomingData() and
+     * serviceTx(). Realtime bytes from sendRealtime(), the TX scheduler and
+     * active sensing go out between dump bytes, ahead of the queued dump on
+     * platforms with realtime priority; other scheduled messages wait for
+     * the end of the dump. Elsewhere, with config.maxQueuedBytes set, no more
+     * than that many dump bytes wait on the line, so realtime bytes wait at
+     * most that long; each poll then tops the line up only to the limit, so
+     * the dump runs at the link speed only if polls come at least every
+     * maxQueuedBytes byte times (256us for 16 bytes at 20x). Negotiations
+     * are refused meanwhile; answers a slave has to send still abort the
+     * dump at the receiver.
+     * @return false if a dump or a negotiation is in progress, or data is not a SysEx message
+     */
+    bool beginSysExSend(const uint8_t* data, size_t length, const SysExSendConfig& config = SysExSendConfig()) {
+        if (isSysExSending() || negotiationStatus_ == NegotiationStatus::IN_PROGRESS) return false;
+        if (length < 2 || data[0] != SYSEX_START || data[length - 1] != SYSEX_END) return false;
+        
+        sysExSend_ = SysExSend();
+        sysExSend_.data = data;
+        sysExSend_.length = length;
+        sysExSend_.config = config;
+        if (sysExSend_.config.chunkSize == 0) sysExSend_.config.chunkSize = 1;
+        sysExSend_.nextChunkAt = platform_->getMicros();
+        // Untracked sends since the last dump have long reached the wire
+        if (!txScheduler_) txBusyUntil_ = sysExSend_.nextChunkAt;
+        pollSysExSend();
+        return true;
+    }
+    
+    bool isSysExSending() const { return sysExSend_.data != nullptr; }
+    size_t sysExBytesRemaining() const { return sysExSend_.length - sysExSend_.sent; }
+    
+    // Stop a running dump; a partly sent message is terminated with SYSEX_END
+    void cancelSysExSend() {
+        if (!isSysExSending()) return;
+        if (sysExSend_.sent > 0) {
+            uint8_t end = SYSEX_END;
+            sendData(&end, 1);
+        }
+        sysExSend_ = SysExSend();
+    }
+    
+    /**
+     * Send a realtime byte (clock, start, stop, ...) on the priority lane
+     * It goes out at once through IPlatform::sendRealtimeByte(), between
+     * the bytes of a running SysEx dump. On platforms with realtime
+     * priority it overtakes the bulk data they have queued; elsewhere it
+     * waits behind it, at most SysExSendConfig::maxQueuedBytes if that is
+     * set. While a speed test owns the wire it is held and sent right after.
+     * @return false if byte is not a realtime byte or the held lane is full
+     */
+    bool sendRealtime(uint8_t byte) {
+        if (byte < REALTIME_FIRST) return false;
+        if (txHeld() || realtimeLaneCount_ > 0) {
+            if (realtimeLaneCount_ >= TURBOMIDI_REALTIME_LANE_SIZE) return false;
+            realtimeLane_[realtimeLaneCount_++] = byte;
+            flushRealtimeLane();
+            return true;
+        }
+        transmitRealtime(TraceRecordType::TX_DATA, byte);
+        return true;
+    }
+    
+    // Advance held realtime bytes, scheduled messages and a running SysEx
+    // dump, in that order of priority; also done by handleIncomingData()
+    void serviceTx() {
+        flushRealtimeLane();
+        serviceTxScheduler();
+        pollSysExSend();
+    }
+    
+    // Common functions
+    void sendActiveSense() {
+        if (currentSpeed_ != SpeedMultiplier::SPEED_1X) {
+            transmitRealtime(TraceRecordType::TX, ACTIVE_SENSING);
+            lastActiveSenseTime_ = nowMs();
+            activeSenseDue_.arm(lastActiveSenseTime_ + ACTIVE_SENSE_INTERVAL_MS + 1);
+        }
+    }
+    
+    SpeedMultiplier getCurrentSpeed() const { return currentSpeed_; }
+    
+#if TURBOMIDI_ENABLE_STATS
+    const LinkStats& getStats() const { return stats_; }
+    void resetStats() { stats_ = LinkStats(); }
+#endif
+    
+    DeviceRole getRole() const { return role_.role(); }
+    
+private:
+    static constexpr uint32_t BREATHING_TIME_MS = 10;
+    static constexpr uint32_t SPEED_NEGOTIATION_TIMEOUT_MS = 30;
+    static constexpr uint32_t SPEED_TEST_TIMEOUT_MS = 30;
+    static constexpr uint32_t LINK_TIMEOUT_MS = 300;
+    static constexpr uint32_t ACTIVE_SENSE_INTERVAL_MS = 250;
+    
+    // One-shot timer on the wrapping getMillis() clock
+    struct Deadline {
+        uint32_t at = 0;
+        bool armed = false;
+        
+        void arm(uint32_t time) {
+            at = time;
+            armed = true;
+        }
+        
+        // Due once `interval` ms have passed since `since`, at once if they already have
+        void armAfter(uint32_t since, uint32_t interval, uint32_t now) {
+            arm(now - since >= interval ? now : since + interval);
+        }
+        
+        void disarm() { armed = false; }
+        bool due(uint32_t now) const { return armed && static_cast<int32_t>(now - at) >= 0; }
+        
+        // Keep the earlier of this and `earliest`
+        void fold(bool& found, uint32_t& earliest, uint32_t now) const {
+            if (!armed) return;
+            if (!found || static_cast<int32_t>(at - now) < static_cast<int32_t>(earliest - now)) earliest = at;
+            found = true;
+        }
+    };
+    
+    enum class NegotiationPhase : uint8_t {
+        IDLE,
+        WAIT_ANSWER,
+        WAIT_ACK,
+        BREATHING,
+        WAIT_RESULT,
+        WAIT_RESULT2,
+        RESYNC,           // Best-speed search: wait for the peer to time out back to 1x
+        WAIT_LINK_REPORT  // Extended link test between SPEED_RESULT and SPEED_TEST2
+    };
+    
+    // What the current NEG exchange of a best-speed negotiation is for
+    enum class BestStep : uint8_t {
+        CACHED,     // Speed remembered for this peer
+        CERTIFIED,  // Fastest speed the peer certifies
+        SEARCH,     // Binary search over uncertified speeds
+        SETTLE      // Return to the fastest verified speed
+    };
+    
+    struct Negotiation {
+        NegotiationPhase phase = NegotiationPhase::IDLE;
+        SpeedMultiplier targetSpeed = SpeedMultiplier::SPEED_1X;
+        SpeedMultiplier testSpeed = SpeedMultiplier::SPEED_1X;
+        uint32_t timeoutMs = 30;
+        uint32_t phaseStart = 0;
+        uint32_t startMicros = 0;
+        uint32_t phaseMicros = 0;      // getMicros() when the phase was entered
+        bool resultOutstanding = false; // SPEED_TEST2 went out on the SPEED_RESULT header alone
+        
+        // Best-speed search (beginBestNegotiation)
+        bool best = false;
+        BestStep step = BestStep::SEARCH;
+        bool certifiedTried = false;
+        SpeedMultiplier certified = SpeedMultiplier::SPEED_1X;  // Fastest speed the peer certifies
+        SpeedMultiplier known = SpeedMultiplier::SPEED_1X;      // Fastest speed verified so far
+        uint8_t low = 0;                                        // Untried uncertified candidates
+        uint8_t high = 0;
+    };
+    
+    enum class TestState {
+        IDLE,
+        WAITING_FOR_TEST,
+        WAITING_FOR_TEST2
+    };
+    
+    // Streaming SysEx receive: TurboMIDI frames never reach the callbacks
+    enum class SysExStream : uint8_t {
+        IDLE,
+        HEADER,    // Held until the header shows it is not `F0 00 20 3C 00 00`
+        OPEN,      // Foreign message, delivered to onSysExChunk
+        PROTOCOL   // TurboMIDI frame, handled by the engine alone
+    };
+    
+    // Adaptive speed controller state (see enableAdaptiveSpeed)
+    struct Adaptive {
+        bool enabled = false;
+        bool recovering = false;       // Renegotiate `sustained` once recoverAt is reached
+        AdaptiveSpeedConfig config;
+        SpeedMultiplier maxSpeed = SpeedMultiplier::SPEED_1X;
+        SpeedMultiplier sustained = SpeedMultiplier::SPEED_1X;  // Highest speed known to work
+        uint16_t errors = 0;
+        uint32_t windowStart = 0;
+        uint32_t quietSince = 0;       // Last speed change or link error
+        uint32_t recoverAt = 0;
+    };
+    
+    struct SysExSend {
+        const uint8_t* data = nullptr;   // nullptr when idle
+        size_t length = 0;
+        size_t sent = 0;
+        size_t chunkLeft = 0;            // Bytes of the current chunk not handed over yet
+        SysExSendConfig config;
+        uint32_t nextChunkAt = 0;        // getMicros() time of the next chunk
+    };
+    
+    // Response slots filled as soon as the matching frame completes
+    struct PendingResponses {
+        SpeedConfig remoteConfig;
+        bool answer = false;
+        bool ack = false;
+        bool result = false;
+        bool result2 = false;
+#if TURBOMIDI_ENABLE_LINK_TEST
+        bool linkTestCapable = false;  // SPEED_ANSWER carried LINK_TEST_CAPABILITY
+        bool linkReport = false;
+#endif
+    };
+    
+#if TURBOMIDI_ENABLE_LINK_TEST
+    struct LinkTest {
+        bool enabled = false;
+        LinkTestConfig config;
+        bool peerCapable = false;      // The last SPEED_ANSWER advertised LINK_TEST
+        LinkTestChecker checker;       // Payload being received
+        PrbsGenerator prbs;            // Payload being sent
+        uint32_t length = 0;           // Payload bytes of the running test
+        uint32_t sendRemaining = 0;
+        bool sending = false;          // Frame open until its SYSEX_END is sent
+        uint32_t startMicros = 0;
+        LinkQuality quality;
+    };
+#endif
+    
+    IPlatform* platform_;
+    RolePolicy role_;
+    SpeedConfig localConfig_;
+    SpeedMultiplier currentSpeed_;
+    uint32_t lastActiveSenseTime_;
+    uint32_t lastMessageTime_;
+    SysExAssembler<TURBOMIDI_MAX_FRAME_LENGTH> incoming_;
+    MidiParser parser_;
+    SysExStream sysExStream_ = SysExStream::IDLE;
+    uint8_t sysExHeld_ = 0;        // Header bytes matched so far, all equal to ELEKTRON_ID
+    SpscByteRing* receiveRing_ = nullptr;
+    TestState testState_;
+    SpeedMultiplier pendingTestSpeed_;
+    SpeedMultiplier pendingTargetSpeed_;
+    PendingResponses pending_;
+    Negotiation negotiation_;
+    NegotiationStatus negotiationStatus_ = NegotiationStatus::IDLE;
+    NegotiationTiming timing_;
+    SpeedConfig remoteConfig_;
+    bool remoteConfigKnown_ = false;
+    Adaptive adaptive_;
+    PeerCache* peerCache_ = nullptr;
+#if TURBOMIDI_ENABLE_TRACE
+    TraceRecorder* traceRecorder_ = nullptr;
+#endif
+    ScheduledTxQueue* txScheduler_ = nullptr;
+    uint32_t txBusyUntil_ = 0;     // Estimated end of the bytes this link has sent (micros)
+    Array<uint8_t, TURBOMIDI_REALTIME_LANE_SIZE> realtimeLane_;  // Held by sendRealtime() during a speed test
+    uint8_t realtimeLaneCount_ = 0;
+    SysExSend sysExSend_;
+#if TURBOMIDI_ENABLE_LINK_TEST
+    LinkTest linkTest_;
+#endif
+    uint32_t breathingTimeMs_ = BREATHING_TIME_MS;
+    Deadline activeSenseDue_;      // Armed while above 1x
+    Deadline linkTimeoutDue_;      // Armed while above 1x, pushed back by every received byte
+    Deadline negotiationDue_;      // Timeout of the current master negotiation phase
+    uint32_t pollMillis_ = 0;      // Clock read at the start of handleIncomingData()
+    uint8_t pollDepth_ = 0;
+#if TURBOMIDI_ENABLE_STATS
+    LinkStats stats_;
+#endif
+    
+    // Time of the current poll, or a fresh reading outside handleIncomingData()
+    uint32_t nowMs() { return pollDepth_ ? pollMillis_ : platform_->getMillis(); }
+    
+    // Whole milliseconds until a microsecond-clock delta, rounded down so the caller wakes early
+    static uint32_t microsToMillis(uint32_t deltaMicros) {
+        return static_cast<int32_t>(deltaMicros) > 0 ? deltaMicros / 1000u : 0;
+    }
+    
+    // Constant with FixedRole, so the unused role's paths fold away
+    bool actsAsMaster() const { return role_.role() != DeviceRole::SLAVE; }
+    bool actsAsSlave() const { return role_.role() != DeviceRole::MASTER; }
+    
+    // Protocol frames and active sensing
+    void sendCommand(const uint8_t* frame, size_t length) {
+        trace(TraceRecordType::TX, frame, length);
+        transmit(frame, length);
+    }
+    
+    // Application bytes sent on its behalf: SysEx dumps and scheduled messages
+    void sendData(const uint8_t* data, size_t length) {
+        trace(TraceRecordType::TX_DATA, data, length);
+        transmit(data, length);
+    }
+    
+    void transmit(const uint8_t* frame, size_t length) {
+        countBytesOut(length);
+        trackLine(length);
+        platform_->sendMidiData(frame, length);
+    }
+    
+    // Priority lane: clock, active sensing and other realtime bytes
+    void transmitRealtime(TraceRecordType type, uint8_t byte) {
+        trace(type, &byte, 1);
+        countBytesOut(1);
+        trackLine(1);
+        platform_->sendRealtimeByte(byte);
+    }
+    
+    void trackLine(size_t length) {
+        if (txScheduler_ || isSysExSending()) {
+            // Track the line so scheduled messages start early enough and the bulk lane stays short
+            uint32_t now = platform_->getMicros();
+            txBusyUntil_ = now + lineBacklogMicros(now) + wireTimeMicros(currentSpeed_, static_cast<uint32_t>(length));
+        }
+    }
+    
+    // Estimated time until everything sent so far has left the UART
+    uint32_t lineBacklogMicros(uint32_t now) {
+        if (static_cast<int32_t>(txBusyUntil_ - now) <= 0) {
+            txBusyUntil_ = now;  // Keep the estimate close to the clock so it cannot wrap
+            return 0;
+        }
+        return txBusyUntil_ - now;
+    }
+    
+    void flushRealtimeLane() {
+        if (realtimeLaneCount_ == 0 || txHeld()) return;
+        for (uint8_t i = 0; i < realtimeLaneCount_; ++i) transmitRealtime(TraceRecordType::TX_DATA, realtimeLane_[i]);
+        realtimeLaneCount_ = 0;
+    }
+    
+    template <size_t N>
+    void sendCommand(const Array<uint8_t, N>& frame) {
+        sendCommand(frame.data(), N);
+    }
+    
+    void sendSpeedPush(SpeedMultiplier speed) {
+        if (!actsAsMaster()) return;
+        uint8_t frame[SPEED_PUSH_LENGTH];
+        sendCommand(frame, CommandBuilder::encodeSpeedPush(frame, speed));
+        setSpeed(speed);
+    }
+    
+    // Trace hooks; empty when TURBOMIDI_ENABLE_TRACE is off or no recorder is attached
+    void trace(TraceRecordType type, const uint8_t* data, size_t length) {
+#if TURBOMIDI_ENABLE_TRACE
+        if (traceRecorder_) traceRecorder_->record(type, platform_->getMicros(), data, length);
+#else
+        (void)type;
+        (void)data;
+        (void)length;
+#endif
+    }
+    
+    void traceCall(TraceCall call, uint8_t argument = 0, uint32_t timeoutMs = 0) {
+        uint16_t timeout = static_cast<uint16_t>(detail::minOf(timeoutMs, static_cast<uint32_t>(0xFFFF)));
+        const uint8_t record[4] = {static_cast<uint8_t>(call), argument,
+                                   static_cast<uint8_t>(timeout), static_cast<uint8_t>(timeout >> 8)};
+        trace(TraceRecordType::CALL, record, sizeof(record));
+    }
+    
+    void traceState() {
+        const uint8_t record[3] = {static_cast<uint8_t>(negotiation_.phase), static_cast<uint8_t>(negotiationStatus_),
+                                   static_cast<uint8_t>(currentSpeed_)};
+        trace(TraceRecordType::STATE, record, sizeof(record));
+    }
+    
+    // Statistics hooks; empty when TURBOMIDI_ENABLE_STATS is off
+    void countBytesOut(size_t length) {
+#if TURBOMIDI_ENABLE_STATS
+        stats_.bytesOut += static_cast<uint32_t>(length);
+#else
+        (void)length;
+#endif
+    }
+    
+    void pollSysExSend() {
+        if (!isSysExSending() || txHeld()) return;
+        
+        while (sysExSend_.sent < sysExSend_.length) {
+            uint32_t now = platform_->getMicros();
+            if (static_cast<int32_t>(sysExSend_.nextChunkAt - now) > 0) return;
+            
+            if (sysExSend_.chunkLeft == 0) {
+                sysExSend_.chunkLeft = detail::minOf(static_cast<size_t>(sysExSend_.config.chunkSize),
+                                                     sysExSend_.length - sysExSend_.sent);
+            }
+            size_t chunk = sysExSend_.chunkLeft;
+            if (sysExSend_.config.maxQueuedBytes > 0) {
+                // Keep the bulk lane short so realtime bytes reach the wire right behind it
+                uint32_t byteMicros = wireTimeMicros(currentSpeed_, 1);
+                size_t queued = (lineBacklogMicros(now) + byteMicros - 1) / byteMicros;
+                if (queued >= sysExSend_.config.maxQueuedBytes) {
+                    sysExSend_.nextChunkAt = txBusyUntil_ - (sysExSend_.config.maxQueuedBytes - 1) * byteMicros;
+                    return;
+                }
+                chunk = detail::minOf(chunk, sysExSend_.config.maxQueuedBytes - queued);
+            }
+            // Never more than the platform takes without blocking loop()
+            size_t space = platform_->txSpace();
+            if (space == 0) {
+                sysExSend_.nextChunkAt = now + wireTimeMicros(currentSpeed_, 1);
+                return;
+            }
+            chunk = detail::minOf(chunk, space);
+            sendData(sysExSend_.data + sysExSend_.sent, chunk);
+            sysExSend_.sent += chunk;
+            sysExSend_.chunkLeft -= chunk;
+            if (sysExSend_.chunkLeft == 0 && sysExSend_.config.chunkGapMicros > 0) {
+                sysExSend_.nextChunkAt = now + sysExSend_.config.chunkGapMicros;
+            }
+        }
+        sysExSend_ = SysExSend();
+    }
+    
+    // Send time that puts the last byte of the entry on the wire at its due time
+    uint32_t releaseMicros(const ScheduledTxQueue::Entry& entry, uint32_t now) const {
+        uint32_t backlog = static_cast<int32_t>(txBusyUntil_ - now) > 0 ? txBusyUntil_ - now : 0;
+        // A realtime byte overtakes the queue and only waits for the byte being shifted out
+        if (entry.data[0] >= REALTIME_FIRST && platform_->hasRealtimePriority()) {
+            backlog = detail::minOf(backlog, wireTimeMicros(currentSpeed_, 1));
+        }
+        return entry.dueMicros - wireTimeMicros(currentSpeed_, entry.length) - backlog;
+    }
+    
+    // Application data would corrupt a running speed test
+    bool txHeld() const {
+        return negotiation_.phase == NegotiationPhase::BREATHING ||
+               negotiation_.phase == NegotiationPhase::WAIT_RESULT ||
+               negotiation_.phase == NegotiationPhase::WAIT_RESULT2 ||
+               negotiation_.phase == NegotiationPhase::WAIT_LINK_REPORT ||
+               testState_ != TestState::IDLE;
+    }
+    
+    void rejectFrame(FrameRejectReason reason) {
+#if TURBOMIDI_ENABLE_STATS
+        ++stats_.framesRejected[static_cast<size_t>(reason)];
+#endif
+        // Frames damaged in transit count as link errors for the adaptive controller
+        if (reason == FrameRejectReason::TOO_SHORT || reason == FrameRejectReason::TRUNCATED ||
+            reason == FrameRejectReason::BAD_TEST_PATTERN) {
+            reportLinkError();
+        }
+    }
+    
+    void setSpeed(SpeedMultiplier speed) {
+        currentSpeed_ = speed;
+        uint32_t baudRate = getBaudRate(speed);
+        const uint8_t traced[4] = {static_cast<uint8_t>(baudRate), static_cast<uint8_t>(baudRate >> 8),
+                                   static_cast<uint8_t>(baudRate >> 16), static_cast<uint8_t>(baudRate >> 24)};
+        trace(TraceRecordType::BAUD, traced, sizeof(traced));
+        platform_->setBaudRate(baudRate);
+        
+        // Above 1x the link must be kept alive and watched
+        if (speed == SpeedMultiplier::SPEED_1X) {
+            activeSenseDue_.disarm();
+            linkTimeoutDue_.disarm();
+        } else {
+            uint32_t now = nowMs();
+            activeSenseDue_.armAfter(lastActiveSenseTime_, ACTIVE_SENSE_INTERVAL_MS + 1, now);
+            linkTimeoutDue_.armAfter(lastMessageTime_, LINK_TIMEOUT_MS + 1, now);
+        }
+        
+        this->notifySpeedChanged(speed);
+    }
+    
+    uint32_t getActualMultiplier(SpeedMultiplier speed) {
+        return speedMultiplierRounded(speed);
+    }
+    
+    uint32_t getBaudRate(SpeedMultiplier speed) {
+        return speedBaudRate(speed);
+    }
+    
+    // beginNegotiation() and beginBestNegotiation() without the trace record,
+    // also used by the adaptive controller
+    bool startNegotiation(SpeedMultiplier targetSpeed, uint32_t timeoutMs, bool best) {
+        if (!actsAsMaster()) return false;
+        if (negotiationStatus_ == NegotiationStatus::IN_PROGRESS) return false;
+        // A protocol frame would abort the dump at the receiver
+        if (isSysExSending()) return false;
+        
+        negotiation_ = Negotiation();
+        timing_ = NegotiationTiming();
+        negotiation_.startMicros = platform_->getMicros();
+        negotiation_.phaseMicros = negotiation_.startMicros;
+        negotiation_.targetSpeed = targetSpeed;
+        negotiation_.testSpeed = targetSpeed;
+        negotiation_.timeoutMs = timeoutMs;
+        negotiation_.best = best;
+        negotiationStatus_ = NegotiationStatus::IN_PROGRESS;
+#if TURBOMIDI_ENABLE_STATS
+        ++stats_.negotiationAttempts[LinkStats::speedIndex(targetSpeed)];
+#endif
+        
+        // Send speed request, dropping responses left over from earlier attempts
+        pending_ = PendingResponses();
+        sendCommand(SPEED_REQ_FRAME);
+        enterPhase(NegotiationPhase::WAIT_ANSWER);
+        return true;
+    }
+    
+    void enterPhase(NegotiationPhase phase) {
+        closePhaseTiming();
+        negotiation_.phase = phase;
+        negotiation_.phaseStart = nowMs();
+        negotiationDue_.arm(negotiation_.phaseStart + phaseTimeoutMs(phase));
+        traceState();
+    }
+    
+    // Charge the time since the phase was entered to its timing slot
+    void closePhaseTiming() {
+        uint32_t now = platform_->getMicros();
+        uint32_t spent = now - negotiation_.phaseMicros;
+        negotiation_.phaseMicros = now;
+        switch (negotiation_.phase) {
+            case NegotiationPhase::WAIT_ANSWER: timing_.answer += spent; break;
+            case NegotiationPhase::WAIT_ACK: timing_.ack += spent; break;
+            case NegotiationPhase::BREATHING: timing_.breathing += spent; break;
+            case NegotiationPhase::WAIT_RESULT: timing_.result += spent; break;
+            case NegotiationPhase::WAIT_RESULT2: timing_.result2 += spent; break;
+            case NegotiationPhase::RESYNC: timing_.resync += spent; break;
+#if TURBOMIDI_ENABLE_LINK_TEST
+            case NegotiationPhase::WAIT_LINK_REPORT: timing_.linkTest += spent; break;
+#else
+            case NegotiationPhase::WAIT_LINK_REPORT: break;
+#endif
+            case NegotiationPhase::IDLE: break;
+        }
+        timing_.total = now - negotiation_.startMicros;
     }
     
-    // Configure supported speeds
-    void setSupportedSpeed(SpeedMultiplier speed, bool certified = false) {
-        localConfig_.addSpeed(speed, certified);
+    uint32_t phaseTimeoutMs(NegotiationPhase phase) const {
+        switch (phase) {
+            case NegotiationPhase::BREATHING: return breathingTimeMs_;
+            case NegotiationPhase::WAIT_RESULT:
+            case NegotiationPhase::WAIT_RESULT2: return SPEED_TEST_TIMEOUT_MS;
+            case NegotiationPhase::RESYNC: return LINK_TIMEOUT_MS + 1;
+#if TURBOMIDI_ENABLE_LINK_TEST
+            case NegotiationPhase::WAIT_LINK_REPORT:
+                // Re-armed with every chunk: ours may still be queued, then the answer has to arrive
+                return SPEED_TEST_TIMEOUT_MS +
+                       2 * (linkTest_.length + LINK_REPORT_HEADER_LENGTH + 1) * getByteTimeMicros() / 1000u;
+#endif
+            default: return negotiation_.timeoutMs;
+        }
     }
     
-    // Master functions
-    bool negotiateSpeed(SpeedMultiplier targetSpeed, uint32_t timeoutMs = 30) {
-        if (role_ == DeviceRole::SLAVE) return false;
+    void finishNegotiation(bool success, bool revertSpeed) {
+        closePhaseTiming();
+        negotiation_.phase = NegotiationPhase::IDLE;
+        negotiationDue_.disarm();
+        if (revertSpeed) setSpeed(SpeedMultiplier::SPEED_1X);
+        negotiationStatus_ = success ? NegotiationStatus::SUCCEEDED : NegotiationStatus::FAILED;
+        traceState();
+#if TURBOMIDI_ENABLE_STATS
+        size_t speedIndex = LinkStats::speedIndex(negotiation_.targetSpeed);
+        ++(success ? stats_.negotiationSuccesses : stats_.negotiationFailures)[speedIndex];
+#endif
         
-        // Send speed request
-        sendCommand(CommandBuilder::buildSpeedReq());
-        
-        // Wait for answer
-        SpeedConfig remoteConfig;
-        if (!waitForSpeedAnswer(remoteConfig, timeoutMs)) {
-            return false;
+        if (success && peerCache_ && remoteConfigKnown_ && currentSpeed_ != SpeedMultiplier::SPEED_1X) {
+            peerCache_->store(remoteConfig_, currentSpeed_, !remoteConfig_.isCertified(currentSpeed_));
         }
+        if (adaptive_.enabled) adaptiveNegotiationFinished(success);
         
-        // Check if target speed is supported
-        if (!remoteConfig.hasSpeed(targetSpeed)) {
-            return false;
-        }
+        this->notifyNegotiationComplete(success, currentSpeed_);
+    }
+    
+    // Adaptive controller: learn from the outcome of any negotiation
+    void adaptiveNegotiationFinished(bool success) {
+        uint32_t now = nowMs();
+        adaptive_.quietSince = now;
+        adaptive_.errors = 0;
+        adaptive_.windowStart = now;
         
-        // Determine test speed
-        SpeedMultiplier testSpeed = targetSpeed;
-        if (!remoteConfig.isCertified(targetSpeed) && targetSpeed != SpeedMultiplier::SPEED_1X) {
-            // Need to test with higher speed first
-            testSpeed = getNextHigherSpeed(targetSpeed);
-            if (testSpeed == targetSpeed) return false; // No higher speed available
+        if (success) {
+            adaptive_.sustained = currentSpeed_;
+            adaptive_.recovering = false;
+            return;
         }
         
-        // Send negotiation
-        sendCommand(CommandBuilder::buildSpeedNeg(testSpeed, targetSpeed));
-        
-        // Wait for ACK
-        if (!waitForAck(timeoutMs)) {
-            return false;
+        // A failed recovery means the sustained speed no longer works either
+        if (adaptive_.recovering && negotiation_.targetSpeed == adaptive_.sustained) {
+            adaptive_.sustained = getNextLowerSpeed(adaptive_.sustained);
         }
+        adaptive_.recovering = false;
         
-        // Perform speed test if needed
-        if (targetSpeed != SpeedMultiplier::SPEED_1X && testSpeed != targetSpeed) {
-            if (!performSpeedTest(testSpeed, targetSpeed)) {
-                return false;
-            }
+        // A failed speed test leaves both sides at 1x; climb back to the sustained speed
+        if (currentSpeed_ == SpeedMultiplier::SPEED_1X && adaptive_.sustained != SpeedMultiplier::SPEED_1X) {
+            scheduleRecovery(now);
         }
-        
-        // Set new speed
-        setSpeed(targetSpeed);
-        return true;
     }
     
-    void pushSpeed(SpeedMultiplier speed) {
-        if (role_ == DeviceRole::SLAVE) return;
-        sendCommand(CommandBuilder::buildSpeedPush(speed));
-        setSpeed(speed);
+    void scheduleRecovery(uint32_t now) {
+        adaptive_.recovering = true;
+        adaptive_.recoverAt = now + adaptive_.config.recoveryDelayMs;
     }
     
-    // Slave functions
-    void handleIncomingData() {
-        uint8_t buffer[256];
-        size_t bytesRead = platform_->receiveMidiData(buffer, sizeof(buffer));
+    // Too many errors: push the next lower speed both sides support
+    void stepDown(uint32_t now) {
+        SpeedMultiplier lower = getNextLowerSpeed(currentSpeed_);
+        adaptive_.sustained = lower;
+        adaptive_.errors = 0;
+        adaptive_.windowStart = now;
+        adaptive_.quietSince = now;
+        sendSpeedPush(lower);
+    }
+    
+    void pollAdaptive(uint32_t now) {
+        if (negotiationStatus_ == NegotiationStatus::IN_PROGRESS || isSysExSending()) return;
         
-        for (size_t i = 0; i < bytesRead; ++i) {
-            processIncomingByte(buffer[i]);
+        if (adaptive_.recovering) {
+            if (static_cast<int32_t>(now - adaptive_.recoverAt) >= 0) {
+                if (adaptive_.sustained == SpeedMultiplier::SPEED_1X || currentSpeed_ == adaptive_.sustained) {
+                    adaptive_.recovering = false;
+                } else {
+                    startNegotiation(adaptive_.sustained, SPEED_NEGOTIATION_TIMEOUT_MS, false);
+                }
+            }
+            return;
         }
         
-        // Check for timeouts
-        checkTimeouts();
-    }
-    
-    // Common functions
-    void sendActiveSense() {
-        if (currentSpeed_ != SpeedMultiplier::SPEED_1X) {
-            uint8_t activeSense = ACTIVE_SENSING;
-            platform_->sendMidiData(&activeSense, 1);
-            lastActiveSenseTime_ = platform_->getMillis();
+        // Probe upwards after an error-free interval at the sustained speed
+        if (currentSpeed_ == adaptive_.sustained &&
+            static_cast<uint8_t>(currentSpeed_) < static_cast<uint8_t>(adaptive_.maxSpeed) &&
+            now - adaptive_.quietSince >= adaptive_.config.probeIntervalMs) {
+            SpeedMultiplier candidate = getNextHigherSpeed(currentSpeed_);
+            while (candidate != adaptive_.maxSpeed && !bothSupport(candidate)) {
+                candidate = getNextHigherSpeed(candidate);
+            }
+            if (bothSupport(candidate)) {
+                startNegotiation(candidate, SPEED_NEGOTIATION_TIMEOUT_MS, false);
+            } else {
+                adaptive_.quietSince = now;
+            }
         }
     }
     
-    SpeedMultiplier getCurrentSpeed() const { return currentSpeed_; }
-    
-    // Callbacks for slave mode
-    std::function<void(SpeedMultiplier)> onSpeedChanged;
-    std::function<void()> onSpeedRequest;
+    bool bothSupport(SpeedMultiplier speed) const {
+        return localConfig_.hasSpeed(speed) && (!remoteConfigKnown_ || remoteConfig_.hasSpeed(speed));
+    }
     
-private:
-    enum class TestState {
-        IDLE,
-        WAITING_FOR_TEST,
-        WAITING_FOR_TEST2
-    };
+    bool waitForNegotiation() {
+        while (true) {
+            handleIncomingData();
+            if (negotiationStatus_ != NegotiationStatus::IN_PROGRESS) break;
+            platform_->delayMicros(negotiationPollMicros());
+        }
+        return negotiationStatus_ == NegotiationStatus::SUCCEEDED;
+    }
     
-    IPlatform* platform_;
-    DeviceRole role_;
-    SpeedConfig localConfig_;
-    SpeedMultiplier currentSpeed_;
-    uint32_t lastActiveSenseTime_;
-    uint32_t lastMessageTime_;
-    std::vector<uint8_t> incomingBuffer_;
-    TestState testState_;
-    SpeedMultiplier pendingTestSpeed_;
-    SpeedMultiplier pendingTargetSpeed_;
+    // Poll every few byte times so a response is picked up soon after it lands
+    uint32_t negotiationPollMicros() const {
+        uint32_t interval = 4 * getByteTimeMicros();
+        return interval < 20 ? 20 : (interval > 1000 ? 1000 : interval);
+    }
     
-    void sendCommand(const std::vector<uint8_t>& cmd) {
-        platform_->sendMidiData(cmd.data(), cmd.size());
+    void sendSpeedNeg(SpeedMultiplier testSpeed, SpeedMultiplier targetSpeed) {
+        negotiation_.testSpeed = testSpeed;
+        negotiation_.targetSpeed = targetSpeed;
+        uint8_t frame[SPEED_NEG_LENGTH];
+        sendCommand(frame, CommandBuilder::encodeSpeedNeg(frame, testSpeed, targetSpeed));
+        enterPhase(NegotiationPhase::WAIT_ACK);
     }
     
-    void setSpeed(SpeedMultiplier speed) {
-        currentSpeed_ = speed;
-        uint32_t baudRate = getBaudRate(speed);
-        platform_->setBaudRate(baudRate);
+    // End of one NEG (and speed test) exchange
+    void finishStep(bool success, bool revertSpeed) {
+        if (!negotiation_.best) {
+            finishNegotiation(success, revertSpeed);
+            return;
+        }
+        
+        if (revertSpeed) setSpeed(SpeedMultiplier::SPEED_1X);
+        
+        uint8_t tried = static_cast<uint8_t>(negotiation_.targetSpeed);
+        switch (negotiation_.step) {
+            case BestStep::SETTLE:
+                finishNegotiation(success, false);
+                return;
+                
+            case BestStep::CACHED:
+                if (success) {
+                    finishNegotiation(true, false);
+                    return;
+                }
+                // The peer or cable changed; forget the entry and search normally
+                if (peerCache_) peerCache_->remove(remoteConfig_);
+                break;
+                
+            case BestStep::CERTIFIED:
+                if (success) negotiation_.known = negotiation_.targetSpeed;
+                break;
+                
+            case BestStep::SEARCH:
+                if (success) {
+                    negotiation_.known = negotiation_.targetSpeed;
+                    negotiation_.low = static_cast<uint8_t>(tried + 1);
+                } else {
+                    negotiation_.high = static_cast<uint8_t>(tried - 1);
+                }
+                break;
+        }
         
-        if (onSpeedChanged) {
-            onSpeedChanged(speed);
+        // A failed test leaves the peer at the test speed; let it time out first
+        if (revertSpeed) {
+            enterPhase(NegotiationPhase::RESYNC);
+        } else {
+            nextBestStep();
         }
     }
     
-    uint32_t getActualMultiplier(SpeedMultiplier speed) {
-        switch (speed) {
-            case SpeedMultiplier::SPEED_1X:    return 1;
-            case SpeedMultiplier::SPEED_2X:    return 2;
-            case SpeedMultiplier::SPEED_3_3X:  return 3;  // Actually 3.33, but using 3 for integer math
-            case SpeedMultiplier::SPEED_4X:    return 4;
-            case SpeedMultiplier::SPEED_5X:    return 5;
-            case SpeedMultiplier::SPEED_6_6X:  return 7;  // Actually 6.66, rounding to 7
-            case SpeedMultiplier::SPEED_8X:    return 8;
-            case SpeedMultiplier::SPEED_10X:   return 10;
-            case SpeedMultiplier::SPEED_13_3X: return 13; // Actually 13.33, using 13
-            case SpeedMultiplier::SPEED_16X:   return 16;
-            case SpeedMultiplier::SPEED_20X:   return 20;
-            default: return 1;
-        }
+    // Uncertified speeds can be tested if both sides support them and a faster test speed exists
+    bool isSearchCandidate(uint8_t speed) const {
+        SpeedMultiplier s = static_cast<SpeedMultiplier>(speed);
+        return localConfig_.hasSpeed(s) && remoteConfig_.hasSpeed(s) && !remoteConfig_.isCertified(s) &&
+               getNextHigherSpeed(s) != s;
     }
     
-    uint32_t getBaudRate(SpeedMultiplier speed) {
-        // Calculate exact baud rates for each speed
-        switch (speed) {
-            case SpeedMultiplier::SPEED_1X:    return 31250;
-            case SpeedMultiplier::SPEED_2X:    return 62500;
-            case SpeedMultiplier::SPEED_3_3X:  return 103125;   // 31250 * 3.3
-            case SpeedMultiplier::SPEED_4X:    return 125000;
-            case SpeedMultiplier::SPEED_5X:    return 156250;
-            case SpeedMultiplier::SPEED_6_6X:  return 206250;   // 31250 * 6.6
-            case SpeedMultiplier::SPEED_8X:    return 250000;
-            case SpeedMultiplier::SPEED_10X:   return 312500;
-            case SpeedMultiplier::SPEED_13_3X: return 415625;   // 31250 * 13.3
-            case SpeedMultiplier::SPEED_16X:   return 500000;
-            case SpeedMultiplier::SPEED_20X:   return 625000;
-            default: return 31250;
-        }
-    }
-    
-    bool waitForSpeedAnswer(SpeedConfig& config, uint32_t timeoutMs) {
-        uint32_t startTime = platform_->getMillis();
-        
-        while (platform_->getMillis() - startTime < timeoutMs) {
-            handleIncomingData();
-            
-            // Check if we received a complete SPEED_ANSWER message
-            if (parseSpeedAnswer(config)) {
-                return true;
+    void startBestSearch(const SpeedConfig& remoteConfig) {
+        // Highest speed the peer certifies needs no test
+        SpeedMultiplier certified = SpeedMultiplier::SPEED_1X;
+        for (uint8_t speed = 11; speed > 1; --speed) {
+            SpeedMultiplier s = static_cast<SpeedMultiplier>(speed);
+            if (localConfig_.hasSpeed(s) && remoteConfig.hasSpeed(s) && remoteConfig.isCertified(s)) {
+                certified = s;
+                break;
             }
-            
-            platform_->delayMs(1);
         }
         
-        return false;
+        negotiation_.certified = certified;
+        negotiation_.known = currentSpeed_ == certified ? certified : SpeedMultiplier::SPEED_1X;
+        negotiation_.low = static_cast<uint8_t>(static_cast<uint8_t>(certified) + 1);
+        negotiation_.high = 11;
+        
+        // Same peer as before: go straight to the speed that worked last time
+        const PeerCache::Entry* cached = peerCache_ ? peerCache_->lookup(remoteConfig) : nullptr;
+        if (cached && cached->speed != currentSpeed_ && localConfig_.hasSpeed(cached->speed)) {
+            SpeedMultiplier speed = cached->speed;
+            negotiation_.step = BestStep::CACHED;
+            sendSpeedNeg(remoteConfig.isCertified(speed) ? speed : getNextHigherSpeed(speed), speed);
+            return;
+        }
+        nextBestStep();
     }
     
-    bool waitForAck(uint32_t timeoutMs) {
-        uint32_t startTime = platform_->getMillis();
-        
-        while (platform_->getMillis() - startTime < timeoutMs) {
-            handleIncomingData();
-            
-            // Check if we received ACK
-            if (parseAck()) {
-                return true;
+    void nextBestStep() {
+        if (!negotiation_.certifiedTried) {
+            negotiation_.certifiedTried = true;
+            SpeedMultiplier certified = negotiation_.certified;
+            if (certified != SpeedMultiplier::SPEED_1X && certified != currentSpeed_) {
+                negotiation_.step = BestStep::CERTIFIED;
+                sendSpeedNeg(certified, certified);
+                return;
             }
-            
-            platform_->delayMs(1);
         }
         
-        return false;
+        negotiation_.step = BestStep::SEARCH;
+        // Binary search over the remaining uncertified candidates
+        uint8_t candidates[11];
+        size_t count = 0;
+        for (uint8_t speed = negotiation_.low; speed <= negotiation_.high && speed <= 11; ++speed) {
+            if (isSearchCandidate(speed)) candidates[count++] = speed;
+        }
+        if (count > 0) {
+            SpeedMultiplier target = static_cast<SpeedMultiplier>(candidates[count / 2]);
+            sendSpeedNeg(getNextHigherSpeed(target), target);
+            return;
+        }
+        
+        // Search done: make sure the link ends at the fastest verified speed
+        SpeedMultiplier known = negotiation_.known;
+        if (currentSpeed_ == known) {
+            finishNegotiation(known != SpeedMultiplier::SPEED_1X, false);
+            return;
+        }
+        negotiation_.step = BestStep::SETTLE;
+        sendSpeedNeg(remoteConfig_.isCertified(known) ? known : getNextHigherSpeed(known), known);
     }
     
-    bool performSpeedTest(SpeedMultiplier testSpeed, SpeedMultiplier targetSpeed) {
-        // Send breathing time (16 null bytes)
-        uint8_t nullBytes[16] = {0};
-        platform_->sendMidiData(nullBytes, 16);
-        platform_->delayMs(10);
-        
-        // Switch to test speed
-        setSpeed(testSpeed);
+    // Advance the master negotiation; never blocks
+    void pollNegotiation(uint32_t now) {
+        if (!actsAsMaster() || negotiation_.phase == NegotiationPhase::IDLE) return;
         
-        // Send first test pattern
-        sendCommand(CommandBuilder::buildSpeedTest());
+        bool timedOut = negotiationDue_.due(now);
         
-        // Wait for first result
-        if (!waitForSpeedResult(30)) {
-            setSpeed(SpeedMultiplier::SPEED_1X);
-            return false;
+        switch (negotiation_.phase) {
+            case NegotiationPhase::WAIT_ANSWER: {
+                SpeedConfig remoteConfig;
+                if (takeSpeedAnswer(remoteConfig)) {
+                    remoteConfig_ = remoteConfig;
+                    remoteConfigKnown_ = true;
+#if TURBOMIDI_ENABLE_LINK_TEST
+                    linkTest_.peerCapable = pending_.linkTestCapable;
+#endif
+#if TURBOMIDI_ENABLE_STATS
+                    ++stats_.negotiationRtt[LinkStats::rttBucket(now - negotiation_.phaseStart)];
+#endif
+                    if (negotiation_.best) {
+                        startBestSearch(remoteConfig);
+                        return;
+                    }
+                    
+                    SpeedMultiplier targetSpeed = negotiation_.targetSpeed;
+                    
+                    // Check if target speed is supported
+                    if (!remoteConfig.hasSpeed(targetSpeed)) {
+                        finishNegotiation(false, false);
+                        return;
+                    }
+                    
+                    // Uncertified speeds are tested at the next higher speed first
+                    if (!remoteConfig.isCertified(targetSpeed) && targetSpeed != SpeedMultiplier::SPEED_1X) {
+                        negotiation_.testSpeed = getNextHigherSpeed(targetSpeed);
+                        if (negotiation_.testSpeed == targetSpeed) {
+                            finishNegotiation(false, false); // No higher speed available
+                            return;
+                        }
+                    }
+                    
+                    sendSpeedNeg(negotiation_.testSpeed, targetSpeed);
+                } else if (timedOut) {
+                    finishNegotiation(false, false);
+                }
+                break;
+            }
+                
+            case NegotiationPhase::WAIT_ACK:
+                if (takeResponse(pending_.ack)) {
+                    if (negotiation_.targetSpeed != SpeedMultiplier::SPEED_1X &&
+                        negotiation_.testSpeed != negotiation_.targetSpeed) {
+                        // Send breathing time (16 null bytes) before switching to the test speed
+                        uint8_t nullBytes[16] = {0};
+                        sendCommand(nullBytes, sizeof(nullBytes));
+                        enterPhase(NegotiationPhase::BREATHING);
+                    } else {
+                        setSpeed(negotiation_.targetSpeed);
+                        finishStep(true, false);
+                    }
+                } else if (timedOut) {
+                    finishStep(false, false);
+                }
+                break;
+                
+            case NegotiationPhase::BREATHING:
+                if (timedOut) {
+                    setSpeed(negotiation_.testSpeed);
+                    sendCommand(SPEED_TEST_FRAME);
+                    enterPhase(NegotiationPhase::WAIT_RESULT);
+                }
+                break;
+                
+            case NegotiationPhase::WAIT_RESULT:
+                if (takeResponse(pending_.result)) {
+#if TURBOMIDI_ENABLE_LINK_TEST
+                    if (linkTestApplies()) {
+                        startLinkTest();
+                        break;
+                    }
+#endif
+                    sendSpeedTest2(false);
+                } else if (timedOut) {
+                    finishStep(false, true);
+                }
+                break;
+                
+            case NegotiationPhase::WAIT_RESULT2:
+                if (takeResponse(pending_.result2)) {
+                    // RESULT precedes RESULT2, so a missing one means its echo was damaged
+                    if (negotiation_.resultOutstanding && !takeResponse(pending_.result)) {
+                        finishStep(false, true);
+                        return;
+                    }
+                    // Tests passed, switch to target speed
+                    setSpeed(negotiation_.targetSpeed);
+                    finishStep(true, false);
+                } else if (timedOut) {
+                    finishStep(false, true);
+                }
+                break;
+                
+            case NegotiationPhase::RESYNC:
+                if (timedOut) nextBestStep();
+                break;
+                
+            case NegotiationPhase::WAIT_LINK_REPORT:
+#if TURBOMIDI_ENABLE_LINK_TEST
+                if (takeResponse(pending_.linkReport)) {
+                    linkTest_.quality.passed = linkTest_.quality.byteErrors() <= linkTest_.config.maxByteErrors;
+                    if (linkTest_.quality.passed) {
+                        sendSpeedTest2(false);
+                    } else {
+                        finishStep(false, true);
+                    }
+                } else if (timedOut && !linkTest_.sending) {
+                    finishStep(false, true);
+                }
+#endif
+                break;
+                
+            case NegotiationPhase::IDLE:
+                break;
         }
-        
-        // Send second test pattern
-        sendCommand(CommandBuilder::buildSpeedTest2());
-        
-        // Wait for second result
-        if (!waitForSpeedResult2(30)) {
-            setSpeed(SpeedMultiplier::SPEED_1X);
-            return false;
+    }
+    
+    void sendSpeedTest2(bool resultOutstanding) {
+        negotiation_.resultOutstanding = resultOutstanding;
+        sendCommand(SPEED_TEST2_FRAME);
+        enterPhase(NegotiationPhase::WAIT_RESULT2);
+    }
+    
+    // The slave sends SPEED_RESULT in reply to SPEED_TEST and is ready for
+    // SPEED_TEST2 from then on, so TEST2 can be queued as soon as RESULT's
+    // header is seen, while the echoed pattern is still arriving
+    void pipelineSpeedTest2() {
+#if TURBOMIDI_ENABLE_LINK_TEST
+        if (linkTestApplies()) return;  // The link test follows the complete echo
+#endif
+        if (incoming_.receivedLength() < COMMAND_HEADER_LENGTH) return;
+        const uint8_t* frame = incoming_.data();
+        if (frame[6] != static_cast<uint8_t>(CommandID::SPEED_RESULT) ||
+            memcmp(frame + 1, ELEKTRON_ID.data(), ELEKTRON_ID.size()) != 0) {
+            return;
         }
-        
-        // Tests passed, switch to target speed
-        setSpeed(targetSpeed);
-        return true;
+        sendSpeedTest2(true);
     }
     
-    bool waitForSpeedResult(uint32_t timeoutMs) {
-        uint32_t startTime = platform_->getMillis();
+    void processIncomingBytes(const uint8_t* data, size_t length) {
+        if (length == 0) return;
+        trace(TraceRecordType::RX, data, length);
         
-        while (platform_->getMillis() - startTime < timeoutMs) {
-            handleIncomingData();
-            
-            // Check if we received SPEED_RESULT
-            if (parseSpeedResult()) {
-                return true;
+        // Any byte, including active sensing, resets the timeout
+        lastMessageTime_ = nowMs();
+        if (linkTimeoutDue_.armed) linkTimeoutDue_.arm(lastMessageTime_ + LINK_TIMEOUT_MS + 1);
+#if TURBOMIDI_ENABLE_STATS
+        stats_.bytesIn += static_cast<uint32_t>(length);
+#endif
+        
+        size_t i = 0;
+        while (i < length) {
+            if (parser_.expectsData()) {
+                processIncomingByte(data[i++]);
+                continue;
             }
             
-            platform_->delayMs(1);
+            // Data bytes only matter to the assembler here: hand it the whole run
+            size_t run = detail::findStatusByte(data + i, length - i);
+            if (run > 0) {
+                streamSysExData(data + i, run);
+                pushFrameData(data + i, run);
+                i += run;
+                if (actsAsMaster() && negotiation_.phase == NegotiationPhase::WAIT_RESULT) pipelineSpeedTest2();
+            }
+            if (i < length) processIncomingByte(data[i++]);
         }
-        
-        return false;
     }
     
-    bool waitForSpeedResult2(uint32_t timeoutMs) {
-        uint32_t startTime = platform_->getMillis();
+    void streamSysExData(const uint8_t* data, size_t length) {
+        if (sysExStream_ == SysExStream::OPEN) {
+            this->notifySysExChunk(data, length);
+            return;
+        }
+        if (sysExStream_ != SysExStream::HEADER) return;
         
-        while (platform_->getMillis() - startTime < timeoutMs) {
-            handleIncomingData();
-            
-            // Check if we received SPEED_RESULT2
-            if (parseSpeedResult2()) {
-                return true;
+        size_t matched = 0;
+        while (matched < length && sysExHeld_ + matched < ELEKTRON_ID.size() &&
+               data[matched] == ELEKTRON_ID[sysExHeld_ + matched]) {
+            ++matched;
+        }
+        if (sysExHeld_ + matched == ELEKTRON_ID.size()) {
+            sysExStream_ = SysExStream::PROTOCOL;
+        } else if (matched == length) {
+            sysExHeld_ = static_cast<uint8_t>(sysExHeld_ + matched);
+        } else {
+            openSysExStream();
+            this->notifySysExChunk(data, length);
+        }
+    }
+    
+    // A foreign message: report it, starting with the header bytes held so far
+    void openSysExStream() {
+        sysExStream_ = SysExStream::OPEN;
+        this->notifySysExBegin();
+        if (sysExHeld_ > 0) this->notifySysExChunk(ELEKTRON_ID.data(), sysExHeld_);
+    }
+    
+    void endSysExStream(bool complete) {
+        // A message that ends inside the header is too short to be a TurboMIDI frame
+        if (sysExStream_ == SysExStream::HEADER) openSysExStream();
+        if (sysExStream_ == SysExStream::OPEN) this->notifySysExEnd(complete);
+        sysExStream_ = SysExStream::IDLE;
+    }
+    
+    void pushFrameData(const uint8_t* data, size_t length) {
+#if TURBOMIDI_ENABLE_LINK_TEST
+        if (linkTest_.checker.active()) {
+            linkTest_.checker.check(data, length);
+            return;
+        }
+        // Up to the end of an expected link test header, then the payload goes to the checker
+        size_t header = linkTestHeaderLength();
+        size_t received = incoming_.receivedLength();
+        if (received > 0 && header > received) {
+            size_t count = detail::minOf(length, header - received);
+            incoming_.pushData(data, count);
+            data += count;
+            length -= count;
+            if (incoming_.receivedLength() == header) beginLinkCheck();
+            if (linkTest_.checker.active()) {
+                linkTest_.checker.check(data, length);
+                return;
             }
-            
-            platform_->delayMs(1);
         }
-        
-        return false;
+#endif
+        if (incoming_.pushData(data, length) == SysExAssembler<TURBOMIDI_MAX_FRAME_LENGTH>::Result::OVERFLOWED) {
+            rejectFrame(FrameRejectReason::OVERSIZED);
+        }
     }
     
     void processIncomingByte(uint8_t byte) {
-        lastMessageTime_ = platform_->getMillis();
-        
-        if (byte == SYSEX_START) {
-            incomingBuffer_.clear();
+#if TURBOMIDI_ENABLE_LINK_TEST
+        if (linkTest_.checker.active() && (byte & 0x80) && byte < REALTIME_FIRST && byte != SYSEX_END) {
+            // Only data bytes are sent in the payload, so a status byte there is a damaged one
+            if (linkTest_.checker.expectsPayload()) {
+                linkTest_.checker.check(&byte, 1);
+                return;
+            }
+            linkTest_.checker.abort();
+        }
+#endif
+        // Streaming SysEx: any non-realtime status byte ends the message, SYSEX_START opens one
+        if ((byte & 0x80) && byte < REALTIME_FIRST) {
+            endSysExStream(byte == SYSEX_END);
+            if (byte == SYSEX_START) {
+                sysExStream_ = SysExStream::HEADER;
+                sysExHeld_ = 0;
+            }
         }
         
-        incomingBuffer_.push_back(byte);
-        
-        if (byte == SYSEX_END) {
-            processCompleteMessage();
+        switch (parser_.parse(byte)) {
+            case MidiParser::Event::MESSAGE:
+                this->notifyMidiMessage(parser_.message());
+                break;
+                
+            case MidiParser::Event::REALTIME:
+                // Active sensing is consumed by the link supervision
+                if (byte != ACTIVE_SENSING) this->notifyRealtime(byte);
+                break;
+                
+            case MidiParser::Event::NONE:
+                break;
         }
         
-        if (byte == ACTIVE_SENSING) {
-            // Reset timeout
-            lastMessageTime_ = platform_->getMillis();
+        switch (incoming_.push(byte)) {
+            case SysExAssembler<TURBOMIDI_MAX_FRAME_LENGTH>::Result::COMPLETE:
+                processCompleteMessage();
+                break;
+                
+            case SysExAssembler<TURBOMIDI_MAX_FRAME_LENGTH>::Result::OVERFLOWED:
+                rejectFrame(FrameRejectReason::OVERSIZED);
+                break;
+                
+            case SysExAssembler<TURBOMIDI_MAX_FRAME_LENGTH>::Result::NONE:
+                break;
         }
     }
     
     void processCompleteMessage() {
-        if (incomingBuffer_.size() < 8) return;
-        
-        // Verify Elektron header
-        if (incomingBuffer_[0] != SYSEX_START ||
-            incomingBuffer_[incomingBuffer_.size() - 1] != SYSEX_END) {
+        const uint8_t* frame = incoming_.data();
+        const size_t frameSize = incoming_.size();
+#if TURBOMIDI_ENABLE_STATS
+        ++stats_.framesParsed;
+#endif
+        if (frameSize < 8) {
+            rejectFrame(FrameRejectReason::TOO_SHORT);
             return;
         }
         
         // Check manufacturer ID
-        bool validManufacturer = true;
         for (size_t i = 0; i < ELEKTRON_ID.size(); ++i) {
-            if (incomingBuffer_[i + 1] != ELEKTRON_ID[i]) {
-                validManufacturer = false;
-                break;
+            if (frame[i + 1] != ELEKTRON_ID[i]) {
+                rejectFrame(FrameRejectReason::FOREIGN);
+                return;
             }
         }
-        if (!validManufacturer) return;
         
-        CommandID cmd = static_cast<CommandID>(incomingBuffer_[6]);
+        CommandID cmd = static_cast<CommandID>(frame[6]);
         
         // Handle commands based on role
         switch (cmd) {
             case CommandID::SPEED_REQ:
-                if (role_ != DeviceRole::MASTER) {
-                    sendCommand(CommandBuilder::buildSpeedAnswer(localConfig_));
-                    if (onSpeedRequest) onSpeedRequest();
+                if (actsAsSlave()) {
+                    uint8_t answer[SPEED_ANSWER_EXT_LENGTH];
+                    sendCommand(answer, CommandBuilder::encodeSpeedAnswer(answer, localConfig_, capabilities()));
+                    this->notifySpeedRequest();
+                } else {
+                    rejectFrame(FrameRejectReason::UNEXPECTED);
                 }
                 break;
                 
             case CommandID::SPEED_NEG:
-                if (role_ != DeviceRole::MASTER && incomingBuffer_.size() >= 10) {
-                    SpeedMultiplier testSpeed = static_cast<SpeedMultiplier>(incomingBuffer_[7]);
-                    SpeedMultiplier targetSpeed = static_cast<SpeedMultiplier>(incomingBuffer_[8]);
+                if (!actsAsSlave()) {
+                    rejectFrame(FrameRejectReason::UNEXPECTED);
+                } else if (frameSize < 10) {
+                    rejectFrame(FrameRejectReason::TRUNCATED);
+                } else {
+                    SpeedMultiplier testSpeed = static_cast<SpeedMultiplier>(frame[7]);
+                    SpeedMultiplier targetSpeed = static_cast<SpeedMultiplier>(frame[8]);
                     
                     if (localConfig_.hasSpeed(targetSpeed)) {
-                        sendCommand(CommandBuilder::buildSpeedAck());
+                        sendCommand(SPEED_ACK_FRAME);
                         
                         // Wait for test or immediate speed change
                         if (targetSpeed == SpeedMultiplier::SPEED_1X || 
@@ -521,150 +3126,299 @@ private:
                             // No test needed, change speed immediately
                             setSpeed(targetSpeed);
                         } else {
-                            // Prepare for speed test
+                            // The master sends SPEED_TEST at the test speed after the breathing time
                             pendingTestSpeed_ = testSpeed;
                             pendingTargetSpeed_ = targetSpeed;
                             testState_ = TestState::WAITING_FOR_TEST;
+                            setSpeed(testSpeed);
                         }
                     }
                 }
                 break;
                 
             case CommandID::SPEED_TEST:
-                if (role_ != DeviceRole::MASTER && testState_ == TestState::WAITING_FOR_TEST &&
-                    incomingBuffer_.size() >= 16) {
-                    // Verify test pattern
-                    bool testValid = true;
-                    if (incomingBuffer_[7] != 0x55 || incomingBuffer_[8] != 0x55 ||
-                        incomingBuffer_[9] != 0x55 || incomingBuffer_[10] != 0x55 ||
-                        incomingBuffer_[11] != 0x00 || incomingBuffer_[12] != 0x00 ||
-                        incomingBuffer_[13] != 0x00 || incomingBuffer_[14] != 0x00) {
-                        testValid = false;
-                    }
-                    
-                    if (testValid) {
-                        // Switch to test speed and send result
-                        setSpeed(pendingTestSpeed_);
-                        sendCommand(CommandBuilder::buildSpeedResult());
-                        testState_ = TestState::WAITING_FOR_TEST2;
-                    } else {
-                        // Test failed, revert to 1x
-                        setSpeed(SpeedMultiplier::SPEED_1X);
-                        testState_ = TestState::IDLE;
-                    }
+                if (!actsAsSlave() || testState_ != TestState::WAITING_FOR_TEST) {
+                    rejectFrame(FrameRejectReason::UNEXPECTED);
+                } else if (frameSize < 16) {
+                    rejectFrame(FrameRejectReason::TRUNCATED);
+                } else if (hasTestPattern(frame)) {
+                    // Received intact at the test speed: answer at the same speed
+                    sendCommand(SPEED_RESULT_FRAME);
+                    testState_ = TestState::WAITING_FOR_TEST2;
+                } else {
+                    // Test failed, revert to 1x
+                    rejectFrame(FrameRejectReason::BAD_TEST_PATTERN);
+                    setSpeed(SpeedMultiplier::SPEED_1X);
+                    testState_ = TestState::IDLE;
                 }
                 break;
                 
             case CommandID::SPEED_TEST2:
-                if (role_ != DeviceRole::MASTER && testState_ == TestState::WAITING_FOR_TEST2) {
-                    sendCommand(CommandBuilder::buildSpeedResult2());
+                if (actsAsSlave() && testState_ == TestState::WAITING_FOR_TEST2) {
+                    sendCommand(SPEED_RESULT2_FRAME);
                     // Test complete, switch to target speed
                     setSpeed(pendingTargetSpeed_);
                     testState_ = TestState::IDLE;
+                } else {
+                    rejectFrame(FrameRejectReason::UNEXPECTED);
+                }
+                break;
+                
+            // Responses to our own requests, picked up by the waitFor* loops
+            case CommandID::SPEED_ANSWER:
+                if (frameSize >= 12) {
+                    pending_.remoteConfig.mask1 = frame[7];
+                    pending_.remoteConfig.mask2 = frame[8];
+                    pending_.remoteConfig.cert1 = frame[9];
+                    pending_.remoteConfig.cert2 = frame[10];
+#if TURBOMIDI_ENABLE_LINK_TEST
+                    pending_.linkTestCapable = frameSize >= SPEED_ANSWER_EXT_LENGTH &&
+                                               (frame[11] & LINK_TEST_CAPABILITY) != 0;
+#endif
+                    pending_.answer = true;
+                } else {
+                    rejectFrame(FrameRejectReason::TRUNCATED);
+                }
+                break;
+                
+            case CommandID::SPEED_ACK:
+                pending_.ack = true;
+                break;
+                
+            case CommandID::SPEED_RESULT:
+                // Only accept a result that echoes the pattern we sent
+                if (frameSize < 16) {
+                    rejectFrame(FrameRejectReason::TRUNCATED);
+                } else if (hasTestPattern(frame)) {
+                    pending_.result = true;
+                } else {
+                    rejectFrame(FrameRejectReason::BAD_TEST_PATTERN);
+                }
+                break;
+                
+            case CommandID::SPEED_RESULT2:
+                pending_.result2 = true;
+                break;
+                
+#if TURBOMIDI_ENABLE_LINK_TEST
+            // Header-only frames: the payload went to the checker
+            case CommandID::LINK_TEST:
+                if (linkTest_.checker.active() && slaveAwaitsLinkTest()) {
+                    answerLinkTest(frame);
+                } else {
+                    linkTest_.checker.abort();
+                    rejectFrame(FrameRejectReason::UNEXPECTED);
+                }
+                break;
+                
+            case CommandID::LINK_REPORT:
+                if (linkTest_.checker.active() && masterAwaitsLinkReport()) {
+                    LinkQuality& quality = linkTest_.quality;
+                    quality.received = linkTest_.checker.finish();
+                    quality.sent.bytes = linkTest_.length;
+                    quality.sent.byteErrors = CommandBuilder::readField(frame + 7, 3);
+                    quality.sent.bitErrors = CommandBuilder::readField(frame + 10, 3);
+                    quality.sent.lostBytes = CommandBuilder::readField(frame + 13, 3);
+                    quality.exchangeMicros = platform_->getMicros() - linkTest_.startMicros;
+                    quality.completed = true;
+                    pending_.linkReport = true;
+                } else {
+                    linkTest_.checker.abort();
+                    rejectFrame(FrameRejectReason::UNEXPECTED);
                 }
                 break;
+#endif
                 
             case CommandID::SPEED_PUSH:
-                if (incomingBuffer_.size() >= 9) {
-                    SpeedMultiplier speed = static_cast<SpeedMultiplier>(incomingBuffer_[7]);
+                if (frameSize >= 9) {
+                    SpeedMultiplier speed = static_cast<SpeedMultiplier>(frame[7]);
                     if (localConfig_.hasSpeed(speed)) {
                         setSpeed(speed);
                     }
+                } else {
+                    rejectFrame(FrameRejectReason::TRUNCATED);
                 }
                 break;
                 
             default:
+                rejectFrame(FrameRejectReason::UNKNOWN_COMMAND);
                 break;
         }
     }
     
-    bool parseSpeedAnswer(SpeedConfig& config) {
-        // Look for SPEED_ANSWER in buffer
-        for (const auto& msg : getParsedMessages()) {
-            if (msg.size() >= 12 && msg[6] == static_cast<uint8_t>(CommandID::SPEED_ANSWER)) {
-                config.mask1 = msg[7];
-                config.mask2 = msg[8];
-                config.cert1 = msg[9];
-                config.cert2 = msg[10];
-                return true;
-            }
-        }
-        return false;
+    bool takeSpeedAnswer(SpeedConfig& config) {
+        if (!pending_.answer) return false;
+        config = pending_.remoteConfig;
+        pending_.answer = false;
+        return true;
     }
     
-    bool parseAck() {
-        for (const auto& msg : getParsedMessages()) {
-            if (msg.size() >= 8 && msg[6] == static_cast<uint8_t>(CommandID::SPEED_ACK)) {
-                return true;
-            }
-        }
-        return false;
+    static bool takeResponse(bool& slot) {
+        if (!slot) return false;
+        slot = false;
+        return true;
     }
     
-    bool parseSpeedResult() {
-        for (const auto& msg : getParsedMessages()) {
-            if (msg.size() >= 16 && msg[6] == static_cast<uint8_t>(CommandID::SPEED_RESULT)) {
-                // Verify the result pattern matches what we sent
-                if (msg[7] == 0x55 && msg[8] == 0x55 && msg[9] == 0x55 && msg[10] == 0x55 &&
-                    msg[11] == 0x00 && msg[12] == 0x00 && msg[13] == 0x00 && msg[14] == 0x00) {
-                    return true;
-                }
-            }
-        }
-        return false;
+    static bool hasTestPattern(const uint8_t* frame) {
+        return frame[7] == 0x55 && frame[8] == 0x55 && frame[9] == 0x55 && frame[10] == 0x55 &&
+               frame[11] == 0x00 && frame[12] == 0x00 && frame[13] == 0x00 && frame[14] == 0x00;
     }
     
-    bool parseSpeedResult2() {
-        for (const auto& msg : getParsedMessages()) {
-            if (msg.size() >= 8 && msg[6] == static_cast<uint8_t>(CommandID::SPEED_RESULT2)) {
-                return true;
-            }
+    // Capability byte of our SPEED_ANSWER; 0 keeps the stock four-byte answer
+    uint8_t capabilities() const {
+#if TURBOMIDI_ENABLE_LINK_TEST
+        return linkTest_.enabled ? LINK_TEST_CAPABILITY : 0;
+#else
+        return 0;
+#endif
+    }
+    
+#if TURBOMIDI_ENABLE_LINK_TEST
+    // The settle step of a best-speed search returns to a speed the search has qualified already
+    bool linkTestApplies() const {
+        return linkTest_.enabled && linkTest_.peerCapable && !(negotiation_.best && negotiation_.step == BestStep::SETTLE);
+    }
+    bool masterAwaitsLinkReport() const {
+        return actsAsMaster() && negotiation_.phase == NegotiationPhase::WAIT_LINK_REPORT;
+    }
+    bool slaveAwaitsLinkTest() const {
+        return actsAsSlave() && linkTest_.enabled && testState_ == TestState::WAITING_FOR_TEST2;
+    }
+    
+    // Header length of the link test frame this side is waiting for, 0 if none
+    size_t linkTestHeaderLength() const {
+        if (masterAwaitsLinkReport()) return LINK_REPORT_HEADER_LENGTH;
+        if (slaveAwaitsLinkTest()) return LINK_TEST_HEADER_LENGTH;
+        return 0;
+    }
+    
+    // A complete link test header is in the assembler: check the payload that follows it
+    void beginLinkCheck() {
+        const uint8_t* frame = incoming_.data();
+        bool master = masterAwaitsLinkReport();
+        CommandID expected = master ? CommandID::LINK_REPORT : CommandID::LINK_TEST;
+        if (frame[6] != static_cast<uint8_t>(expected) ||
+            memcmp(frame + 1, ELEKTRON_ID.data(), ELEKTRON_ID.size()) != 0) {
+            return;
+        }
+        if (master) {
+            linkTest_.checker.begin(linkTest_.length, linkTestSeed());
+        } else {
+            linkTest_.checker.begin(CommandBuilder::readField(frame + 7, 3),
+                                    static_cast<uint16_t>(CommandBuilder::readField(frame + 10, 2)));
         }
-        return false;
     }
     
-    std::vector<std::vector<uint8_t>> getParsedMessages() {
-        std::vector<std::vector<uint8_t>> messages;
-        std::vector<uint8_t> currentMsg;
+    // The seed as it fits the LINK_TEST header
+    uint16_t linkTestSeed() const { return static_cast<uint16_t>(linkTest_.config.seed & 0x3FFF); }
+    
+    // Payload bytes that take at most 150 ms at `speed`, so neither side's link timeout fires mid-test
+    static uint32_t linkTestPayloadLimit(SpeedMultiplier speed) {
+        return speedBaudRate(speed) / 10u * 15u / 100u;
+    }
+    
+    // Master, at the test speed after SPEED_RESULT
+    void startLinkTest() {
+        linkTest_.length = detail::minOf(linkTest_.config.payloadBytes, linkTestPayloadLimit(currentSpeed_));
+        linkTest_.quality = LinkQuality();
+        linkTest_.quality.speed = currentSpeed_;
+        linkTest_.startMicros = platform_->getMicros();
+        enterPhase(NegotiationPhase::WAIT_LINK_REPORT);
         
-        for (uint8_t byte : incomingBuffer_) {
-            if (byte == SYSEX_START) {
-                currentMsg.clear();
-            }
-            currentMsg.push_back(byte);
-            if (byte == SYSEX_END && !currentMsg.empty()) {
-                messages.push_back(currentMsg);
-            }
-        }
+        uint8_t header[LINK_TEST_HEADER_LENGTH];
+        sendCommand(header, CommandBuilder::encodeLinkTestHeader(header, linkTest_.length, linkTestSeed()));
+        startLinkTestPayload(linkTest_.length, linkTestSeed());
+    }
+    
+    // Slave: report what arrived and send the same sequence back
+    void answerLinkTest(const uint8_t* frame) {
+        const LinkTestCounts& counts = linkTest_.checker.finish();
+        uint32_t length = detail::minOf(CommandBuilder::readField(frame + 7, 3), linkTestPayloadLimit(currentSpeed_));
+        uint16_t seed = static_cast<uint16_t>(CommandBuilder::readField(frame + 10, 2));
         
-        return messages;
+        uint8_t header[LINK_REPORT_HEADER_LENGTH];
+        sendCommand(header, CommandBuilder::encodeLinkReportHeader(header, counts));
+        startLinkTestPayload(length, seed);
     }
     
-    void checkTimeouts() {
-        uint32_t now = platform_->getMillis();
+    void startLinkTestPayload(uint32_t length, uint16_t seed) {
+        linkTest_.prbs.reset(seed);
+        linkTest_.sendRemaining = length;
+        linkTest_.sending = true;
+    }
+    
+    // One chunk per poll keeps every poll short; the rest is dropped once the test is over
+    void pollLinkTestSend() {
+        static constexpr size_t CHUNK_SIZE = 32;
+        if (!linkTest_.sending) return;
+        bool master = masterAwaitsLinkReport();
+        if (!master && !slaveAwaitsLinkTest()) {
+            linkTest_.sending = false;
+            return;
+        }
         
+        uint8_t chunk[CHUNK_SIZE + 1];
+        size_t count = static_cast<size_t>(detail::minOf(linkTest_.sendRemaining, static_cast<uint32_t>(CHUNK_SIZE)));
+        for (size_t i = 0; i < count; ++i) chunk[i] = linkTest_.prbs.next();
+        linkTest_.sendRemaining -= static_cast<uint32_t>(count);
+        if (linkTest_.sendRemaining == 0) {
+            chunk[count++] = SYSEX_END;
+            linkTest_.sending = false;
+        }
+        sendCommand(chunk, count);
+        if (master) negotiationDue_.arm(nowMs() + phaseTimeoutMs(NegotiationPhase::WAIT_LINK_REPORT));
+    }
+#endif
+    
+    void checkTimeouts(uint32_t now) {
         // Check active sensing timeout (300ms)
-        if (currentSpeed_ != SpeedMultiplier::SPEED_1X && 
-            now - lastMessageTime_ > 300) {
+        if (linkTimeoutDue_.due(now)) {
+#if TURBOMIDI_ENABLE_STATS
+            ++stats_.activeSenseTimeouts;
+#endif
+            if (adaptive_.enabled && negotiationStatus_ != NegotiationStatus::IN_PROGRESS) {
+                // Come back one step below the speed that lost the link
+                adaptive_.sustained = getNextLowerSpeed(currentSpeed_);
+                scheduleRecovery(now);
+            }
+            // A speed test the master gave up on ends here as well
+            testState_ = TestState::IDLE;
             setSpeed(SpeedMultiplier::SPEED_1X);
         }
         
         // Send active sensing if needed
-        if (currentSpeed_ != SpeedMultiplier::SPEED_1X && 
-            now - lastActiveSenseTime_ > 250) {
-            sendActiveSense();
-        }
+        if (activeSenseDue_.due(now)) sendActiveSense();
     }
     
-    SpeedMultiplier getNextHigherSpeed(SpeedMultiplier speed) {
+    SpeedMultiplier getNextHigherSpeed(SpeedMultiplier speed) const {
         int current = static_cast<int>(speed);
         if (current < 11) {
             return static_cast<SpeedMultiplier>(current + 1);
         }
         return speed;
     }
+    
+    // Next lower speed supported by both sides; 1x is always available
+    SpeedMultiplier getNextLowerSpeed(SpeedMultiplier speed) const {
+        int current = static_cast<int>(speed);
+        while (--current > 1) {
+            SpeedMultiplier lower = static_cast<SpeedMultiplier>(current);
+            if (bothSupport(lower)) return lower;
+        }
+        return SpeedMultiplier::SPEED_1X;
+    }
 };
 
+// Runtime role with Callback members
+typedef BasicTurboMIDI<RuntimeRole, FunctionCallbacks> TurboMIDI;
+
+// Compile-time roles, e.g. TurboMIDISlave<StaticCallbacks<MyHandler>>
+template <typename Callbacks = PointerCallbacks>
+using TurboMIDIMaster = BasicTurboMIDI<FixedRole<DeviceRole::MASTER>, Callbacks>;
+
+template <typename Callbacks = PointerCallbacks>
+using TurboMIDISlave = BasicTurboMIDI<FixedRole<DeviceRole::SLAVE>, Callbacks>;
+
 } // namespace TurboMIDI
 
 #endif // TURBOMIDI_HPP
\ No newline at end of file
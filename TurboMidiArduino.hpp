@@ -13,8 +13,70 @@
 #include "TurboMidi.hpp"
 #include <Arduino.h>
 
+// Size of the transmit queue used to coalesce outgoing MIDI into block writes
+#ifndef TURBOMIDI_ARDUINO_TX_QUEUE_SIZE
+#if defined(__AVR__)
+#define TURBOMIDI_ARDUINO_TX_QUEUE_SIZE 64
+#else
+#define TURBOMIDI_ARDUINO_TX_QUEUE_SIZE 512
+#endif
+#endif
+
+// Define if the core's HardwareSerial lacks availableForWrite(); writes may then block
+// #define TURBOMIDI_ARDUINO_NO_AVAILABLE_FOR_WRITE
+
+// Pause after the end()/begin() fallback of setBaudRate(); the fast re-clock paths need none
+#ifndef TURBOMIDI_ARDUINO_REBEGIN_DELAY_MS
+#define TURBOMIDI_ARDUINO_REBEGIN_DELAY_MS 10
+#endif
+
+// Define to enable EepromPeerCacheStore (needs the core's EEPROM library)
+// #define TURBOMIDI_ARDUINO_EEPROM
+
+#if defined(TURBOMIDI_ARDUINO_EEPROM)
+#include <EEPROM.h>
+#endif
+
 namespace TurboMIDI {
 
+#if defined(TURBOMIDI_ARDUINO_EEPROM)
+/**
+ * PeerCache persistence in EEPROM (or the flash-emulated EEPROM on ESP32/RP2040)
+ *
+ * Occupies PeerCache::STORAGE_BYTES bytes starting at the given address.
+ * On ESP32 and RP2040, call EEPROM.begin() with a large enough size first.
+ */
+class EepromPeerCacheStore : public IPeerCacheStore {
+public:
+    /**
+     * Constructor
+     * @param address First EEPROM address used by the cache
+     */
+    explicit EepromPeerCacheStore(int address = 0) : address_(address) {}
+    
+    bool load(uint8_t* data, size_t length) override {
+        for (size_t i = 0; i < length; ++i) {
+            data[i] = EEPROM.read(address_ + static_cast<int>(i));
+        }
+        return true;  // PeerCache checks the magic and version bytes
+    }
+    
+    void save(const uint8_t* data, size_t length) override {
+        for (size_t i = 0; i < length; ++i) {
+            // Only rewrite changed cells to spare EEPROM wear
+            int address = address_ + static_cast<int>(i);
+            if (EEPROM.read(address) != data[i]) EEPROM.write(address, data[i]);
+        }
+#if defined(ESP32) || defined(ESP8266) || defined(ARDUINO_ARCH_RP2040)
+        EEPROM.commit();
+#endif
+    }
+    
+private:
+    int address_;
+};
+#endif
+
 /**
  * Arduino platform implementation using hardware UART
  * 
@@ -50,9 +112,33 @@ public:
     
     // IPlatform interface implementation
     void sendMidiData(const uint8_t* data, size_t length) override {
-        for (size_t i = 0; i < length; ++i) {
-            serial_->write(data[i]);
+        // Protocol frames share the queue with application data to keep ordering
+        queueMidiData(data, length);
+        pumpTx();
+    }
+    
+    // Realtime bytes jump the transmit queue; only the core's own TX buffer
+    // (SERIAL_TX_BUFFER_SIZE, 64 bytes on AVR) is still ahead of them
+    void sendRealtimeByte(uint8_t byte) override {
+        pumpTx();
+        if (txCount_ == TURBOMIDI_ARDUINO_TX_QUEUE_SIZE) {
+            serial_->write(byte);  // Full queue: blocking write, still ahead of it
+            return;
         }
+        txStart_ = (txStart_ + TURBOMIDI_ARDUINO_TX_QUEUE_SIZE - 1) % TURBOMIDI_ARDUINO_TX_QUEUE_SIZE;
+        txQueue_[txStart_] = byte;
+        ++txCount_;
+        pumpTx();
+    }
+    
+    bool hasRealtimePriority() const override {
+        return true;
+    }
+    
+    // Room left in the transmit queue once the UART has taken what it accepts
+    size_t txSpace() override {
+        pumpTx();
+        return TURBOMIDI_ARDUINO_TX_QUEUE_SIZE - txCount_;
     }
     
     size_t receiveMidiData(uint8_t* buffer, size_t maxLength) override {
@@ -67,37 +153,42 @@ public:
         return millis();
     }
     
+    uint32_t getMicros() override {
+        return micros();
+    }
+    
     void setBaudRate(uint32_t baudRate) override {
-        // End current serial connection
-        serial_->end();
-        
-        // Restart with new baud rate
-        serial_->begin(baudRate);
-        
-        // Some Arduino boards need special handling for non-standard baud rates
-        // This is especially true for rates above 115200
-        
-#if defined(__AVR_ATmega32U4__) || defined(__AVR_ATmega16U4__)
-        // Leonardo, Micro, etc. - These can handle most rates directly
-#elif defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__)
-        // Uno, Nano, etc. - May need custom divisor for some rates
-        // For now, we'll rely on the Serial library to handle it
-#elif defined(ARDUINO_ARCH_SAMD)
-        // SAMD boards (Zero, MKR series) - Generally handle high rates well
-#elif defined(ESP32) || defined(ESP8266)
-        // ESP boards - Can handle very high baud rates
-#elif defined(ARDUINO_ARCH_RP2040)
-        // Raspberry Pi Pico - Good high-speed UART support
-#endif
+        // Queued bytes belong to the old speed; wait until the last stop bit is out
+        drainTx();
+        serial_->flush();
         
-        // Small delay to ensure UART is ready
-        delay(10);
+        uint32_t start = micros();
+        if (!reclock(baudRate)) {
+            // No fast path: restart the port, which also drops received bytes
+            serial_->end();
+            serial_->begin(baudRate);
+            delay(TURBOMIDI_ARDUINO_REBEGIN_DELAY_MS);
+        }
+        switchMicros_ = micros() - start;
+    }
+    
+    /**
+     * Time the last setBaudRate() kept the UART unusable, after TX drained
+     * Use it to size the breathing time (TurboMIDI::setBreathingTime()).
+     * @return Microseconds
+     */
+    uint32_t lastBaudSwitchMicros() const {
+        return switchMicros_;
     }
     
     void delayMs(uint32_t ms) override {
         delay(ms);
     }
     
+    void delayMicros(uint32_t micros) override {
+        delayMicroseconds(micros);
+    }
+    
     /**
      * Check if data is available to read
      * @return Number of bytes available
@@ -106,15 +197,135 @@ public:
         return serial_->available();
     }
     
+    /**
+     * Queue MIDI data for transmission without writing it yet
+     * The queue is written out by pumpTx(). If the data does not fit, the
+     * queue is drained with blocking writes first so no bytes are lost.
+     * @param data Pointer to data buffer
+     * @param length Number of bytes to queue
+     */
+    void queueMidiData(const uint8_t* data, size_t length) {
+        if (length > TURBOMIDI_ARDUINO_TX_QUEUE_SIZE - txCount_) {
+            pumpTx();
+        }
+        if (length > TURBOMIDI_ARDUINO_TX_QUEUE_SIZE - txCount_) {
+            // Overflow fallback: keep ordering, accept blocking
+            drainTx();
+            if (length > TURBOMIDI_ARDUINO_TX_QUEUE_SIZE) {
+                serial_->write(data, length);
+                return;
+            }
+        }
+        
+        for (size_t i = 0; i < length; ++i) {
+            txQueue_[(txStart_ + txCount_ + i) % TURBOMIDI_ARDUINO_TX_QUEUE_SIZE] = data[i];
+        }
+        txCount_ += length;
+    }
+    
+    /**
+     * Write as much queued data as the UART accepts without blocking
+     * Uses the block write() overload on contiguous runs of the queue.
+     * @return Number of bytes handed to the UART
+     */
+    size_t pumpTx() {
+        size_t written = 0;
+        while (txCount_ > 0) {
+            size_t run = contiguousTxRun();
+#ifndef TURBOMIDI_ARDUINO_NO_AVAILABLE_FOR_WRITE
+            int space = serial_->availableForWrite();
+            if (space <= 0) break;
+            if (run > static_cast<size_t>(space)) run = static_cast<size_t>(space);
+#endif
+            size_t sent = serial_->write(txQueue_ + txStart_, run);
+            if (sent == 0) break;
+            consumeTx(sent);
+            written += sent;
+        }
+        return written;
+    }
+    
+    /**
+     * Write out the whole queue, blocking until the UART has taken it
+     */
+    void drainTx() {
+        while (txCount_ > 0) {
+            size_t run = contiguousTxRun();
+            consumeTx(serial_->write(txQueue_ + txStart_, run));
+        }
+    }
+    
+    /**
+     * Number of bytes waiting in the transmit queue
+     */
+    size_t pendingTx() const {
+        return txCount_;
+    }
+    
     /**
      * Flush the output buffer
      */
     void flush() {
+        drainTx();
         serial_->flush();
     }
     
 private:
+    uint8_t txQueue_[TURBOMIDI_ARDUINO_TX_QUEUE_SIZE];
+    size_t txStart_ = 0;
+    size_t txCount_ = 0;
+    
+    size_t contiguousTxRun() const {
+        size_t toEnd = TURBOMIDI_ARDUINO_TX_QUEUE_SIZE - txStart_;
+        return txCount_ < toEnd ? txCount_ : toEnd;
+    }
+    
+    void consumeTx(size_t count) {
+        txStart_ = (txStart_ + count) % TURBOMIDI_ARDUINO_TX_QUEUE_SIZE;
+        txCount_ -= count;
+    }
+    
+    /**
+     * Change the rate of the running UART in place
+     * The receiver and the core's RX buffer stay intact.
+     * @return false if this board has no fast path
+     */
+    bool reclock(uint32_t baudRate) {
+#if defined(__AVR__)
+        // Double-speed divisor, computed like HardwareSerial::begin()
+        uint16_t divisor = static_cast<uint16_t>((F_CPU / 4 / baudRate - 1) / 2);
+        if (divisor > 4095) return false;
+        volatile uint8_t* ubrrh = nullptr;
+        volatile uint8_t* ubrrl = nullptr;
+        volatile uint8_t* ucsra = nullptr;
+#if defined(HAVE_HWSERIAL0)
+        if (serial_ == &Serial) { ubrrh = &UBRR0H; ubrrl = &UBRR0L; ucsra = &UCSR0A; }
+#endif
+#if defined(HAVE_HWSERIAL1)
+        if (serial_ == &Serial1) { ubrrh = &UBRR1H; ubrrl = &UBRR1L; ucsra = &UCSR1A; }
+#endif
+#if defined(HAVE_HWSERIAL2)
+        if (serial_ == &Serial2) { ubrrh = &UBRR2H; ubrrl = &UBRR2L; ucsra = &UCSR2A; }
+#endif
+#if defined(HAVE_HWSERIAL3)
+        if (serial_ == &Serial3) { ubrrh = &UBRR3H; ubrrl = &UBRR3L; ucsra = &UCSR3A; }
+#endif
+        if (!ubrrh) return false;
+        *ucsra = 1 << U2X0;             // U2Xn is bit 1 on every USART
+        *ubrrh = static_cast<uint8_t>(divisor >> 8);
+        *ubrrl = static_cast<uint8_t>(divisor);   // Writing the low byte applies the divisor
+        return true;
+#elif defined(ESP32) || defined(ESP8266)
+        serial_->updateBaudRate(baudRate);
+        return true;
+#else
+        (void)baudRate;
+        return false;
+#endif
+    }
+    
     HardwareSerial* serial_;
+    uint32_t switchMicros_ = 0;
     uint8_t rxPin_;
     uint8_t txPin_;
     bool useSoftwareSerial_;
@@ -154,18 +365,32 @@ public:
         turboMidi_.setSupportedSpeed(speed, certified);
     }
     
+    /**
+     * Master: set the pause before switching to the test speed
+     * @param ms Must cover the slave's baud rate switch (default 10ms)
+     */
+    void setBreathingTime(uint32_t ms) {
+        turboMidi_.setBreathingTime(ms);
+    }
+    
+    /**
+     * Time the last baud rate switch kept the UART unusable
+     * @return Microseconds, see ArduinoPlatform::lastBaudSwitchMicros()
+     */
+    uint32_t lastBaudSwitchMicros() const {
+        return platform_.lastBaudSwitchMicros();
+    }
+    
     /**
      * Process incoming MIDI data
      * Call this regularly in Arduino loop() function
      */
     void update() {
+        // Also sends active sensing every 250ms when at high speed
         turboMidi_.handleIncomingData();
         
-        // Send active sensing if needed
-        if (shouldSendActiveSense()) {
-            turboMidi_.sendActiveSense();
-            lastActiveSenseTime_ = millis();
-        }
+        // One coalesced write for everything queued since the last update
+        platform_.pumpTx();
     }
     
     /**
@@ -178,6 +403,101 @@ public:
         return turboMidi_.negotiateSpeed(targetSpeed, timeoutMs);
     }
     
+    /**
+     * Master: Start a speed negotiation without blocking
+     * Progress is driven by update(); check getNegotiationStatus() or use
+     * onNegotiationComplete() to learn the outcome.
+     * @param targetSpeed Desired speed multiplier
+     * @param timeoutMs Timeout in milliseconds per protocol step
+     * @return true if the negotiation was started
+     */
+    bool beginNegotiation(SpeedMultiplier targetSpeed, uint32_t timeoutMs = 30) {
+        return turboMidi_.beginNegotiation(targetSpeed, timeoutMs);
+    }
+    
+    /**
+     * Master: Negotiate the fastest speed both sides support (blocking)
+     * Uses one SPEED_REQ/SPEED_ANSWER exchange, takes the fastest speed the
+     * peer certifies and then binary-searches faster uncertified speeds.
+     * @param timeoutMs Timeout in milliseconds per protocol step
+     * @return true if the link now runs faster than 1x
+     */
+    bool negotiateBestSpeed(uint32_t timeoutMs = 30) {
+        return turboMidi_.negotiateBestSpeed(timeoutMs);
+    }
+    
+    /**
+     * Master: Start a best-speed negotiation without blocking
+     * @param timeoutMs Timeout in milliseconds per protocol step
+     * @return true if the negotiation was started
+     */
+    bool beginBestNegotiation(uint32_t timeoutMs = 30) {
+        return turboMidi_.beginBestNegotiation(timeoutMs);
+    }
+    
+    /**
+     * Get the state of the last started negotiation
+     * @return IDLE, IN_PROGRESS, SUCCEEDED or FAILED
+     */
+    NegotiationStatus getNegotiationStatus() const {
+        return turboMidi_.getNegotiationStatus();
+    }
+    
+    /**
+     * Master: Keep the link at the highest speed it can sustain
+     * Errors step the speed down one multiplier at a time and clean periods
+     * probe the next higher speed; driven by update().
+     * @param maxSpeed Highest speed to probe
+     * @param config Error threshold, error window, probe interval and recovery delay
+     * @return false if this device is a slave
+     */
+    bool enableAdaptiveSpeed(SpeedMultiplier maxSpeed, const AdaptiveSpeedConfig& config = AdaptiveSpeedConfig()) {
+        return turboMidi_.enableAdaptiveSpeed(maxSpeed, config);
+    }
+    
+    /**
+     * Stop adapting; the current speed is kept
+     */
+    void disableAdaptiveSpeed() {
+        turboMidi_.disableAdaptiveSpeed();
+    }
+    
+    /**
+     * Report a receive error (framing, parity, overrun) to the adaptive controller
+     */
+    void reportLinkError() {
+        turboMidi_.reportLinkError();
+    }
+    
+    /**
+     * Master: Remember successful negotiations per peer
+     * @param cache Cache to use, nullptr to detach
+     */
+    void attachPeerCache(PeerCache* cache) {
+        turboMidi_.attachPeerCache(cache);
+    }
+
+#if TURBOMIDI_ENABLE_LINK_TEST
+    /**
+     * Qualify every tested speed with a PRBS exchange (needs both sides)
+     * @param config Payload length, tolerated byte errors and PRBS seed
+     */
+    void enableLinkTest(const LinkTestConfig& config = LinkTestConfig()) {
+        turboMidi_.enableLinkTest(config);
+    }
+
+    void disableLinkTest() {
+        turboMidi_.disableLinkTest();
+    }
+
+    /**
+     * Master: Error counts and throughput of the last extended link test
+     */
+    const LinkQuality& getLinkQuality() const {
+        return turboMidi_.getLinkQuality();
+    }
+#endif
+
     /**
      * Master: Push speed change to slave
      * @param speed New speed multiplier
@@ -194,19 +514,36 @@ public:
         return turboMidi_.getCurrentSpeed();
     }
     
+#if TURBOMIDI_ENABLE_STATS
+    /**
+     * Get link statistics (requires TURBOMIDI_ENABLE_STATS)
+     * @return Counters for bytes, frames, negotiations and timeouts
+     */
+    const LinkStats& getStats() const {
+        return turboMidi_.getStats();
+    }
+    
+    /**
+     * Reset all link statistics to zero
+     */
+    void resetStats() {
+        turboMidi_.resetStats();
+    }
+#endif
+    
     /**
      * Get current baud rate
      * @return Current UART baud rate
      */
     uint32_t getCurrentBaudRate() const {
-        return getBaudRateForSpeed(turboMidi_.getCurrentSpeed());
+        return speedBaudRate(turboMidi_.getCurrentSpeed());
     }
     
     /**
      * Set callback for speed changes (useful in slave mode)
      * @param callback Function to call when speed changes
      */
-    void onSpeedChanged(std::function<void(SpeedMultiplier)> callback) {
+    void onSpeedChanged(Callback<void(SpeedMultiplier)> callback) {
         turboMidi_.onSpeedChanged = callback;
     }
     
@@ -214,17 +551,117 @@ public:
      * Set callback for speed requests (useful in slave mode)
      * @param callback Function to call when speed request received
      */
-    void onSpeedRequest(std::function<void()> callback) {
+    void onSpeedRequest(Callback<void()> callback) {
         turboMidi_.onSpeedRequest = callback;
     }
     
     /**
-     * Send raw MIDI data
+     * Set callback for channel and system common messages
+     * Messages are decoded from the same stream as the protocol, with
+     * running status resolved.
+     * @param callback Function to call for each complete message
+     */
+    void onMidiMessage(Callback<void(const MidiMessage&)> callback) {
+        turboMidi_.onMidiMessage = callback;
+    }
+    
+    /**
+     * Set callback for realtime messages (clock, start, stop, ...)
+     * Active sensing is handled internally and not reported.
+     * @param callback Function to call with each realtime byte
+     */
+    void onRealtime(Callback<void(uint8_t)> callback) {
+        turboMidi_.onRealtime = callback;
+    }
+    
+    /**
+     * Set callback for negotiation completion (useful in master mode)
+     * @param callback Function called with the outcome and resulting speed
+     */
+    void onNegotiationComplete(Callback<void(bool, SpeedMultiplier)> callback) {
+        turboMidi_.onNegotiationComplete = callback;
+    }
+    
+    /**
+     * Set callbacks for streaming SysEx reception
+     * Chunks point into the receive buffer and are only valid during the call.
+     * @param begin Called on SYSEX_START
+     * @param chunk Called with each run of data bytes
+     * @param end Called with true on SYSEX_END, false if the message was aborted
+     */
+    void onSysEx(Callback<void()> begin, Callback<void(const uint8_t*, size_t)> chunk,
+                 Callback<void(bool)> end) {
+        turboMidi_.onSysExBegin = begin;
+        turboMidi_.onSysExChunk = chunk;
+        turboMidi_.onSysExEnd = end;
+    }
+    
+    /**
+     * Start sending a complete SysEx message without copying it
+     * Sent in chunks by update(); data must stay valid until isSysExSending() is false.
+     * @param data SysEx message including SYSEX_START and SYSEX_END
+     * @param length Message length in bytes
+     * @param config Chunk size and pause between chunks
+     * @return false if a dump or negotiation is running, or data is not a SysEx message
+     */
+    bool beginSysExSend(const uint8_t* data, size_t length, const SysExSendConfig& config = SysExSendConfig()) {
+        return turboMidi_.beginSysExSend(data, length, config);
+    }
+    
+    /**
+     * Check whether a SysEx dump is still being sent
+     */
+    bool isSysExSending() const {
+        return turboMidi_.isSysExSending();
+    }
+    
+    /**
+     * Stop a running dump; a partly sent message is terminated with SYSEX_END
+     */
+    void cancelSysExSend() {
+        turboMidi_.cancelSysExSend();
+    }
+    
+    /**
+     * Send timestamped messages from a TxScheduler; pass nullptr to detach
+     * @param scheduler Queue of scheduled messages
+     */
+    void attachTxScheduler(ScheduledTxQueue* scheduler) {
+        turboMidi_.attachTxScheduler(scheduler);
+    }
+    
+    /**
+     * Schedule a message (1-3 bytes) for a given micros() time
+     * Released by update(); the byte time at the current speed is taken
+     * into account, so the last byte is on the wire at dueMicros.
+     * @param dueMicros micros() value for the end of the message
+     * @param data Message bytes
+     * @param length Number of bytes (1-3)
+     * @return false without an attached scheduler, or if it is full
+     */
+    bool scheduleMessage(uint32_t dueMicros, const uint8_t* data, size_t length) {
+        return turboMidi_.scheduleMessage(dueMicros, data, length);
+    }
+    
+    /**
+     * When update() must run next, for sleeping between events
+     * Incoming MIDI data may need attention sooner; wake on the UART too.
+     * @param deadline Receives the millis() time of the next timer
+     * @return false if no timer is pending
+     */
+    bool nextDeadlineMs(uint32_t& deadline) {
+        return turboMidi_.nextDeadlineMs(deadline);
+    }
+    
+    /**
+     * Queue raw MIDI data for sending
+     * Messages queued between two update() calls are sent with a single
+     * non-blocking block write. Call flush() to send immediately.
      * @param data Pointer to data buffer
      * @param length Number of bytes to send
      */
     void sendMidiData(const uint8_t* data, size_t length) {
-        platform_.sendMidiData(data, length);
+        platform_.queueMidiData(data, length);
     }
     
     /**
@@ -236,7 +673,7 @@ public:
     }
     
     /**
-     * Flush output buffer
+     * Send all queued data and wait for the UART to finish
      */
     void flush() {
         platform_.flush();
@@ -245,30 +682,6 @@ public:
 private:
     ArduinoPlatform platform_;
     TurboMIDI turboMidi_;
-    uint32_t lastActiveSenseTime_ = 0;
-    
-    bool shouldSendActiveSense() {
-        // Send active sensing every 250ms when at high speed
-        return (turboMidi_.getCurrentSpeed() != SpeedMultiplier::SPEED_1X) &&
-               (millis() - lastActiveSenseTime_ > 250);
-    }
-    
-    static uint32_t getBaudRateForSpeed(SpeedMultiplier speed) {
-        switch (speed) {
-            case SpeedMultiplier::SPEED_1X:    return 31250;
-            case SpeedMultiplier::SPEED_2X:    return 62500;
-            case SpeedMultiplier::SPEED_3_3X:  return 103125;
-            case SpeedMultiplier::SPEED_4X:    return 125000;
-            case SpeedMultiplier::SPEED_5X:    return 156250;
-            case SpeedMultiplier::SPEED_6_6X:  return 206250;
-            case SpeedMultiplier::SPEED_8X:    return 250000;
-            case SpeedMultiplier::SPEED_10X:   return 312500;
-            case SpeedMultiplier::SPEED_13_3X: return 415625;
-            case SpeedMultiplier::SPEED_16X:   return 500000;
-            case SpeedMultiplier::SPEED_20X:   return 625000;
-            default: return 31250;
-        }
-    }
 };
 
 } // namespace TurboMIDI
@@ -0,0 +1,670 @@
+/**
+ * @file TurboMidiArduinoDma.hpp
+ * @brief DMA-assisted UART platforms for RP2040, ESP32 and SAMD boards
+ * @version 1.0
+ *
+ * These platforms implement IPlatform directly on top of the vendor UART
+ * and DMA drivers instead of the interrupt-per-byte HardwareSerial path,
+ * so turbo speeds cost close to no CPU time. Only the backend matching the
+ * selected board is compiled; include this file instead of (or next to)
+ * TurboMidiArduino.hpp.
+ */
+
+#ifndef TURBOMIDI_ARDUINO_DMA_HPP
+#define TURBOMIDI_ARDUINO_DMA_HPP
+
+#include "TurboMidi.hpp"
+#include <Arduino.h>
+
+// Receive ring size for the DMA backends (power of two)
+#ifndef TURBOMIDI_DMA_RX_BUFFER_SIZE
+#define TURBOMIDI_DMA_RX_BUFFER_SIZE 1024
+#endif
+
+// Transmit staging buffer size for the DMA backends
+#ifndef TURBOMIDI_DMA_TX_BUFFER_SIZE
+#define TURBOMIDI_DMA_TX_BUFFER_SIZE 512
+#endif
+
+// Longest DMA transmit run; a realtime byte waits for at most one run (plus the UART FIFO)
+#ifndef TURBOMIDI_DMA_TX_RUN_SIZE
+#define TURBOMIDI_DMA_TX_RUN_SIZE 16
+#endif
+
+// Realtime bytes waiting to overtake the staging buffer
+#ifndef TURBOMIDI_DMA_TX_URGENT_SIZE
+#define TURBOMIDI_DMA_TX_URGENT_SIZE 8
+#endif
+
+#if defined(ARDUINO_ARCH_RP2040)
+#include <hardware/dma.h>
+#include <hardware/gpio.h>
+#include <hardware/irq.h>
+#include <hardware/sync.h>
+#include <hardware/uart.h>
+#elif defined(ESP32)
+#include <driver/uart.h>
+#include <esp_idf_version.h>
+#elif defined(ARDUINO_ARCH_SAMD) && defined(__has_include)
+#if __has_include(<Adafruit_ZeroDMA.h>)
+#include <Adafruit_ZeroDMA.h>
+#define TURBOMIDI_HAS_ZERO_DMA 1
+#endif
+#endif
+
+namespace TurboMIDI {
+
+// Called when a DMA transmit run has completed
+typedef void (*TxCompleteCallback)(void* context);
+
+#if defined(ARDUINO_ARCH_RP2040)
+
+/**
+ * RP2040 UART platform with circular DMA receive and DMA transmit
+ *
+ * One DMA channel writes every received byte into an address-wrapped ring;
+ * the read position is derived from the channel's remaining transfer count,
+ * so no interrupt fires on receive. A second channel sends queued data and
+ * raises DMA_IRQ_0 when a run completes, which starts the next run and
+ * invokes the optional completion callback (in interrupt context).
+ */
+class RP2040DmaPlatform : public IPlatform {
+    static_assert((TURBOMIDI_DMA_RX_BUFFER_SIZE & (TURBOMIDI_DMA_RX_BUFFER_SIZE - 1)) == 0,
+                  "TURBOMIDI_DMA_RX_BUFFER_SIZE must be a power of two");
+
+public:
+    /**
+     * Constructor
+     * @param uart UART instance (uart0 or uart1)
+     * @param txPin GPIO used for UART TX
+     * @param rxPin GPIO used for UART RX
+     */
+    RP2040DmaPlatform(uart_inst_t* uart, uint txPin, uint rxPin)
+        : uart_(uart), txPin_(txPin), rxPin_(rxPin) {}
+
+    /**
+     * Initialize UART and claim two DMA channels
+     * Call this in Arduino setup() function
+     */
+    void begin() {
+        uart_init(uart_, 31250);
+        gpio_set_function(txPin_, GPIO_FUNC_UART);
+        gpio_set_function(rxPin_, GPIO_FUNC_UART);
+        uart_set_fifo_enabled(uart_, true);
+
+        // Receive: UART DR -> ring, write address wraps at the ring size
+        rxChannel_ = dma_claim_unused_channel(true);
+        dma_channel_config rx = dma_channel_get_default_config(rxChannel_);
+        channel_config_set_transfer_data_size(&rx, DMA_SIZE_8);
+        channel_config_set_read_increment(&rx, false);
+        channel_config_set_write_increment(&rx, true);
+        channel_config_set_ring(&rx, true, ringBits());
+        channel_config_set_dreq(&rx, uart_get_dreq(uart_, false));
+        dma_channel_configure(rxChannel_, &rx, rxBuffer_, &uart_get_hw(uart_)->dr, RX_TRANSFER_COUNT, true);
+
+        // Transmit: staging buffer -> UART DR, started per contiguous run
+        txChannel_ = dma_claim_unused_channel(true);
+        dma_channel_config tx = dma_channel_get_default_config(txChannel_);
+        channel_config_set_transfer_data_size(&tx, DMA_SIZE_8);
+        channel_config_set_read_increment(&tx, true);
+        channel_config_set_write_increment(&tx, false);
+        channel_config_set_dreq(&tx, uart_get_dreq(uart_, true));
+        dma_channel_configure(txChannel_, &tx, &uart_get_hw(uart_)->dr, txBuffer_, 0, false);
+
+        registerInstance(this);
+        dma_channel_set_irq0_enabled(txChannel_, true);
+        installIrqHandler();
+    }
+
+    // IPlatform interface implementation
+    void sendMidiData(const uint8_t* data, size_t length) override {
+        size_t offset = 0;
+        while (offset < length) {
+            uint32_t state = save_and_disable_interrupts();
+            size_t space = TURBOMIDI_DMA_TX_BUFFER_SIZE - txCount_;
+            size_t count = std::min(space, length - offset);
+            for (size_t i = 0; i < count; ++i) {
+                txBuffer_[(txStart_ + txCount_ + i) % TURBOMIDI_DMA_TX_BUFFER_SIZE] = data[offset + i];
+            }
+            txCount_ += count;
+            startTx();
+            restore_interrupts(state);
+
+            offset += count;
+            if (offset < length) tight_loop_contents();  // Staging buffer full, wait for DMA
+        }
+    }
+
+    // Realtime bytes go out as the next DMA run, ahead of the staging buffer
+    void sendRealtimeByte(uint8_t byte) override {
+        uint32_t state = save_and_disable_interrupts();
+        bool queued = urgentCount_ < TURBOMIDI_DMA_TX_URGENT_SIZE;
+        if (queued) {
+            urgent_[urgentCount_] = byte;
+            urgentCount_ = urgentCount_ + 1;
+            startTx();
+        }
+        restore_interrupts(state);
+        if (!queued) sendMidiData(&byte, 1);
+    }
+
+    bool hasRealtimePriority() const override {
+        return true;
+    }
+
+    size_t txSpace() override {
+        return TURBOMIDI_DMA_TX_BUFFER_SIZE - txCount_;
+    }
+
+    size_t receiveMidiData(uint8_t* buffer, size_t maxLength) override {
+        uint32_t head = readableHead();
+        size_t count = std::min(static_cast<size_t>(head - rxTail_), maxLength);
+        for (size_t i = 0; i < count; ++i) {
+            buffer[i] = rxBuffer_[(rxTail_ + i) & (TURBOMIDI_DMA_RX_BUFFER_SIZE - 1)];
+        }
+        rxTail_ += count;
+        return count;
+    }
+
+    // Zero-copy receive: the parser reads straight from the DMA ring
+    size_t peekMidiData(const uint8_t*& data) override {
+        uint32_t head = readableHead();
+        size_t offset = rxTail_ & (TURBOMIDI_DMA_RX_BUFFER_SIZE - 1);
+        data = rxBuffer_ + offset;
+        return std::min(static_cast<size_t>(head - rxTail_), TURBOMIDI_DMA_RX_BUFFER_SIZE - offset);
+    }
+
+    void consumeMidiData(size_t count) override {
+        rxTail_ += count;
+    }
+
+    uint32_t getMillis() override {
+        return millis();
+    }
+
+    uint32_t getMicros() override {
+        return micros();
+    }
+
+    void setBaudRate(uint32_t baudRate) override {
+        // Let DMA and the UART FIFO drain at the old rate first
+        while (txCount_ > 0 || urgentCount_ > 0 || dma_channel_is_busy(txChannel_)) {
+            tight_loop_contents();
+        }
+        uart_tx_wait_blocking(uart_);
+        uart_set_baudrate(uart_, baudRate);
+    }
+
+    void delayMs(uint32_t ms) override {
+        delay(ms);
+    }
+
+    void delayMicros(uint32_t micros) override {
+        delayMicroseconds(micros);
+    }
+
+    /**
+     * Set callback for completed DMA transmit runs (runs in interrupt context)
+     */
+    void onTxComplete(TxCompleteCallback callback, void* context) {
+        txCallback_ = callback;
+        txContext_ = context;
+    }
+
+    /**
+     * Bytes lost because the receive ring was not drained in time
+     */
+    uint32_t getRxOverruns() const {
+        return rxOverruns_;
+    }
+
+private:
+    static constexpr uint32_t RX_TRANSFER_COUNT = 0xFFFFFFFFu;
+
+    uart_inst_t* uart_;
+    uint txPin_;
+    uint rxPin_;
+    int rxChannel_ = -1;
+    int txChannel_ = -1;
+
+    alignas(TURBOMIDI_DMA_RX_BUFFER_SIZE) uint8_t rxBuffer_[TURBOMIDI_DMA_RX_BUFFER_SIZE];
+    uint32_t rxArmedAt_ = 0;  // Bytes received before the current DMA run
+    uint32_t rxTail_ = 0;
+    uint32_t rxOverruns_ = 0;
+
+    uint8_t txBuffer_[TURBOMIDI_DMA_TX_BUFFER_SIZE];
+    volatile size_t txStart_ = 0;
+    volatile size_t txCount_ = 0;
+    volatile size_t txInFlight_ = 0;
+    uint8_t urgent_[TURBOMIDI_DMA_TX_URGENT_SIZE];
+    volatile size_t urgentCount_ = 0;
+    volatile bool urgentInFlight_ = false;
+    TxCompleteCallback txCallback_ = nullptr;
+    void* txContext_ = nullptr;
+
+    static RP2040DmaPlatform*& instance(size_t index) {
+        static RP2040DmaPlatform* instances[NUM_UARTS] = {};
+        return instances[index];
+    }
+
+    static void registerInstance(RP2040DmaPlatform* platform) {
+        instance(uart_get_index(platform->uart_)) = platform;
+    }
+
+    // handleDmaIrq serves every instance, so the second port must not add it again
+    static void installIrqHandler() {
+        static bool installed = false;
+        if (installed) return;
+        installed = true;
+        irq_add_shared_handler(DMA_IRQ_0, handleDmaIrq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_0, true);
+    }
+
+    static constexpr uint ringBits(size_t size = TURBOMIDI_DMA_RX_BUFFER_SIZE, uint bits = 0) {
+        return size <= 1 ? bits : ringBits(size >> 1, bits + 1);
+    }
+
+    // Total bytes written by the receive channel; re-arms it if it ever runs out
+    // Write position of the DMA, after skipping bytes lost to an overrun
+    uint32_t readableHead() {
+        uint32_t head = rxWritten();
+
+        // Overrun: the DMA lapped the reader, skip to the oldest valid byte
+        if (head - rxTail_ > TURBOMIDI_DMA_RX_BUFFER_SIZE) {
+            rxOverruns_ += head - rxTail_ - TURBOMIDI_DMA_RX_BUFFER_SIZE;
+            rxTail_ = head - TURBOMIDI_DMA_RX_BUFFER_SIZE;
+        }
+        return head;
+    }
+
+    uint32_t rxWritten() {
+        uint32_t remaining = dma_channel_hw_addr(rxChannel_)->transfer_count;
+        uint32_t written = rxArmedAt_ + (RX_TRANSFER_COUNT - remaining);
+        if (!dma_channel_is_busy(rxChannel_)) {
+            rxArmedAt_ = written;
+            dma_channel_set_trans_count(rxChannel_, RX_TRANSFER_COUNT, false);
+            dma_channel_set_write_addr(rxChannel_, rxBuffer_ + (written & (TURBOMIDI_DMA_RX_BUFFER_SIZE - 1)), true);
+        }
+        return written;
+    }
+
+    // Start the next contiguous run if the channel is idle; interrupts must be off
+    void startTx() {
+        if (txInFlight_ > 0) return;
+        uint8_t* run = urgent_;
+        size_t length = urgentCount_;
+        urgentInFlight_ = length > 0;
+        if (!urgentInFlight_) {
+            // Short runs keep the wait of a realtime byte short
+            if (txCount_ == 0) return;
+            run = txBuffer_ + txStart_;
+            length = std::min(std::min(static_cast<size_t>(txCount_), TURBOMIDI_DMA_TX_BUFFER_SIZE - txStart_),
+                              static_cast<size_t>(TURBOMIDI_DMA_TX_RUN_SIZE));
+        }
+        txInFlight_ = length;
+        dma_channel_transfer_from_buffer_now(txChannel_, run, length);
+    }
+
+    void completeTx() {
+        if (urgentInFlight_) {
+            // Bytes queued during the run move to the front
+            size_t left = urgentCount_ - txInFlight_;
+            for (size_t i = 0; i < left; ++i) urgent_[i] = urgent_[txInFlight_ + i];
+            urgentCount_ = left;
+        } else {
+            txStart_ = (txStart_ + txInFlight_) % TURBOMIDI_DMA_TX_BUFFER_SIZE;
+            txCount_ -= txInFlight_;
+        }
+        txInFlight_ = 0;
+        startTx();
+        if (txCallback_) txCallback_(txContext_);
+    }
+
+    static void handleDmaIrq() {
+        for (size_t i = 0; i < NUM_UARTS; ++i) {
+            RP2040DmaPlatform* platform = instance(i);
+            if (platform && dma_channel_get_irq0_status(platform->txChannel_)) {
+                dma_channel_acknowledge_irq0(platform->txChannel_);
+                platform->completeTx();
+            }
+        }
+    }
+};
+
+#elif defined(ESP32)
+
+/**
+ * ESP32 UART platform on the ESP-IDF UART driver
+ *
+ * The Arduino and IDF UART drivers do not expose DMA for UART, so this
+ * backend gets its savings from the driver's hardware FIFOs instead: the RX
+ * interrupt only fires when the FIFO reaches a threshold or the line goes
+ * idle, and transmit data is copied into the driver ring once and drained
+ * from the TX-empty interrupt. Completion is reported from pollTxComplete().
+ */
+class ESP32UartPlatform : public IPlatform {
+public:
+    /**
+     * Constructor
+     * @param port UART port (UART_NUM_1, UART_NUM_2, ...)
+     * @param txPin GPIO used for UART TX
+     * @param rxPin GPIO used for UART RX
+     */
+    ESP32UartPlatform(uart_port_t port, int txPin, int rxPin)
+        : port_(port), txPin_(txPin), rxPin_(rxPin) {}
+
+    /**
+     * Install the UART driver
+     * Call this in Arduino setup() function
+     */
+    void begin() {
+        uart_config_t config = {};
+        config.baud_rate = 31250;
+        config.data_bits = UART_DATA_8_BITS;
+        config.parity = UART_PARITY_DISABLE;
+        config.stop_bits = UART_STOP_BITS_1;
+        config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+#if ESP_IDF_VERSION_MAJOR >= 5
+        config.source_clk = UART_SCLK_DEFAULT;
+#else
+        config.source_clk = UART_SCLK_APB;
+#endif
+
+        uart_driver_install(port_, TURBOMIDI_DMA_RX_BUFFER_SIZE, TURBOMIDI_DMA_TX_BUFFER_SIZE, 0, nullptr, 0);
+        uart_param_config(port_, &config);
+        uart_set_pin(port_, txPin_, rxPin_, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+
+        // Batch receive interrupts: FIFO threshold, or idle for two symbols
+        uart_set_rx_full_threshold(port_, RX_FIFO_THRESHOLD);
+        uart_set_rx_timeout(port_, 2);
+    }
+
+    // IPlatform interface implementation
+    void sendMidiData(const uint8_t* data, size_t length) override {
+        uart_write_bytes(port_, reinterpret_cast<const char*>(data), length);
+        txPending_ = true;
+    }
+
+    size_t receiveMidiData(uint8_t* buffer, size_t maxLength) override {
+        size_t available = 0;
+        if (uart_get_buffered_data_len(port_, &available) != ESP_OK || available == 0) return 0;
+        int count = uart_read_bytes(port_, buffer, std::min(available, maxLength), 0);
+        return count > 0 ? static_cast<size_t>(count) : 0;
+    }
+
+    uint32_t getMillis() override {
+        return millis();
+    }
+
+    uint32_t getMicros() override {
+        return micros();
+    }
+
+    void setBaudRate(uint32_t baudRate) override {
+        uart_wait_tx_done(port_, portMAX_DELAY);
+        uart_set_baudrate(port_, baudRate);
+    }
+
+    void delayMs(uint32_t ms) override {
+        delay(ms);
+    }
+
+    void delayMicros(uint32_t micros) override {
+        delayMicroseconds(micros);
+    }
+
+    /**
+     * Set callback for completed transmissions (called from pollTxComplete())
+     */
+    void onTxComplete(TxCompleteCallback callback, void* context) {
+        txCallback_ = callback;
+        txContext_ = context;
+    }
+
+    /**
+     * Report a finished transmission without blocking
+     * Call this regularly, e.g. right after TurboMIDI::handleIncomingData()
+     * @return true if all queued data has left the UART
+     */
+    bool pollTxComplete() {
+        if (uart_wait_tx_done(port_, 0) != ESP_OK) return false;
+        if (txPending_) {
+            txPending_ = false;
+            if (txCallback_) txCallback_(txContext_);
+        }
+        return true;
+    }
+
+private:
+    static constexpr uint8_t RX_FIFO_THRESHOLD = 64;
+
+    uart_port_t port_;
+    int txPin_;
+    int rxPin_;
+    bool txPending_ = false;
+    TxCompleteCallback txCallback_ = nullptr;
+    void* txContext_ = nullptr;
+};
+
+#elif defined(ARDUINO_ARCH_SAMD) && defined(TURBOMIDI_HAS_ZERO_DMA)
+
+/**
+ * SAMD UART platform with DMA transmit (requires Adafruit_ZeroDMA)
+ *
+ * Transmit data is staged and sent by a DMAC channel triggered by the
+ * SERCOM, with the completion callback starting the next run. Receive
+ * stays on the core's interrupt-driven Uart: the SAMD DMAC only reports
+ * progress of a circular transfer when a block completes, which would
+ * hold short messages back until the block fills.
+ */
+class SAMDDmaPlatform : public IPlatform {
+public:
+    /**
+     * Constructor
+     * @param serial Core UART object (Serial1, ...)
+     * @param sercom SERCOM register block behind it (SERCOM0, ...)
+     * @param txTrigger Matching DMAC trigger (SERCOM0_DMAC_ID_TX, ...)
+     */
+    SAMDDmaPlatform(Uart& serial, Sercom* sercom, uint8_t txTrigger)
+        : serial_(&serial), sercom_(sercom), txTrigger_(txTrigger) {}
+
+    /**
+     * Initialize UART and allocate a DMA channel
+     * Call this in Arduino setup() function
+     */
+    void begin() {
+        serial_->begin(31250);
+
+        dma_.setTrigger(txTrigger_);
+        dma_.setAction(DMA_TRIGGER_ACTON_BEAT);
+        dma_.allocate();
+        descriptor_ = dma_.addDescriptor(txBuffer_, const_cast<uint16_t*>(&sercom_->USART.DATA.reg), 0,
+                                         DMA_BEAT_SIZE_BYTE, true, false);
+        registerInstance(this);
+        dma_.setCallback(handleDmaDone);
+    }
+
+    // IPlatform interface implementation
+    void sendMidiData(const uint8_t* data, size_t length) override {
+        size_t offset = 0;
+        while (offset < length) {
+            noInterrupts();
+            size_t space = TURBOMIDI_DMA_TX_BUFFER_SIZE - txCount_;
+            size_t count = std::min(space, length - offset);
+            for (size_t i = 0; i < count; ++i) {
+                txBuffer_[(txStart_ + txCount_ + i) % TURBOMIDI_DMA_TX_BUFFER_SIZE] = data[offset + i];
+            }
+            txCount_ += count;
+            startTx();
+            interrupts();
+            offset += count;
+        }
+    }
+
+    // Realtime bytes go out as the next DMA run, ahead of the staging buffer
+    void sendRealtimeByte(uint8_t byte) override {
+        noInterrupts();
+        bool queued = urgentCount_ < TURBOMIDI_DMA_TX_URGENT_SIZE;
+        if (queued) {
+            urgent_[urgentCount_] = byte;
+            urgentCount_ = urgentCount_ + 1;
+            startTx();
+        }
+        interrupts();
+        if (!queued) sendMidiData(&byte, 1);
+    }
+
+    bool hasRealtimePriority() const override {
+        return true;
+    }
+
+    size_t txSpace() override {
+        return TURBOMIDI_DMA_TX_BUFFER_SIZE - txCount_;
+    }
+
+    size_t receiveMidiData(uint8_t* buffer, size_t maxLength) override {
+        size_t bytesRead = 0;
+        while (serial_->available() && bytesRead < maxLength) {
+            buffer[bytesRead++] = serial_->read();
+        }
+        return bytesRead;
+    }
+
+    uint32_t getMillis() override {
+        return millis();
+    }
+
+    uint32_t getMicros() override {
+        return micros();
+    }
+
+    void setBaudRate(uint32_t baudRate) override {
+        while (txCount_ > 0 || urgentCount_ > 0) {
+            // Wait for the DMA to hand over everything at the old rate
+        }
+        serial_->flush();
+        
+        // BAUD is enable-protected: stop the USART only while rewriting it, keeping the RX ring
+        uint32_t start = micros();
+        SercomUsart& usart = sercom_->USART;
+        usart.CTRLA.bit.ENABLE = 0;
+        while (usart.SYNCBUSY.bit.ENABLE) {}
+#if defined(__SAMD51__)
+        uint32_t baudTimes8 = (SERCOM_FREQ_REF * 8) / (16 * baudRate);
+#else
+        uint32_t baudTimes8 = (SystemCoreClock * 8) / (16 * baudRate);
+#endif
+        // 16x fractional sampling, as set up by Uart::begin()
+        usart.BAUD.FRAC.FP = baudTimes8 % 8;
+        usart.BAUD.FRAC.BAUD = baudTimes8 / 8;
+        usart.CTRLA.bit.ENABLE = 1;
+        while (usart.SYNCBUSY.bit.ENABLE) {}
+        switchMicros_ = micros() - start;
+    }
+    
+    /**
+     * Time the last setBaudRate() kept the UART unusable, after TX drained
+     */
+    uint32_t lastBaudSwitchMicros() const {
+        return switchMicros_;
+    }
+
+    void delayMs(uint32_t ms) override {
+        delay(ms);
+    }
+
+    void delayMicros(uint32_t micros) override {
+        delayMicroseconds(micros);
+    }
+
+    /**
+     * Set callback for completed DMA transmit runs (runs in interrupt context)
+     */
+    void onTxComplete(TxCompleteCallback callback, void* context) {
+        txCallback_ = callback;
+        txContext_ = context;
+    }
+
+private:
+    static constexpr size_t MAX_INSTANCES = 6;  // One per SERCOM
+
+    Uart* serial_;
+    Sercom* sercom_;
+    uint8_t txTrigger_;
+    Adafruit_ZeroDMA dma_;
+    DmacDescriptor* descriptor_ = nullptr;
+    uint32_t switchMicros_ = 0;
+
+    uint8_t txBuffer_[TURBOMIDI_DMA_TX_BUFFER_SIZE];
+    volatile size_t txStart_ = 0;
+    volatile size_t txCount_ = 0;
+    volatile size_t txInFlight_ = 0;
+    uint8_t urgent_[TURBOMIDI_DMA_TX_URGENT_SIZE];
+    volatile size_t urgentCount_ = 0;
+    volatile bool urgentInFlight_ = false;
+    TxCompleteCallback txCallback_ = nullptr;
+    void* txContext_ = nullptr;
+
+    static SAMDDmaPlatform*& instance(size_t index) {
+        static SAMDDmaPlatform* instances[MAX_INSTANCES] = {};
+        return instances[index];
+    }
+
+    static void registerInstance(SAMDDmaPlatform* platform) {
+        for (size_t i = 0; i < MAX_INSTANCES; ++i) {
+            if (!instance(i)) {
+                instance(i) = platform;
+                return;
+            }
+        }
+    }
+
+    // Start the next contiguous run if the channel is idle; interrupts must be off
+    void startTx() {
+        if (txInFlight_ > 0) return;
+        uint8_t* run = urgent_;
+        size_t length = urgentCount_;
+        urgentInFlight_ = length > 0;
+        if (!urgentInFlight_) {
+            // Short runs keep the wait of a realtime byte short
+            if (txCount_ == 0) return;
+            run = txBuffer_ + txStart_;
+            length = std::min(std::min(static_cast<size_t>(txCount_), TURBOMIDI_DMA_TX_BUFFER_SIZE - txStart_),
+                              static_cast<size_t>(TURBOMIDI_DMA_TX_RUN_SIZE));
+        }
+        txInFlight_ = length;
+        dma_.changeDescriptor(descriptor_, run, nullptr, length);
+        dma_.startJob();
+    }
+
+    void completeTx() {
+        if (urgentInFlight_) {
+            // Bytes queued during the run move to the front
+            size_t left = urgentCount_ - txInFlight_;
+            for (size_t i = 0; i < left; ++i) urgent_[i] = urgent_[txInFlight_ + i];
+            urgentCount_ = left;
+        } else {
+            txStart_ = (txStart_ + txInFlight_) % TURBOMIDI_DMA_TX_BUFFER_SIZE;
+            txCount_ -= txInFlight_;
+        }
+        txInFlight_ = 0;
+        startTx();
+        if (txCallback_) txCallback_(txContext_);
+    }
+
+    static void handleDmaDone(Adafruit_ZeroDMA* dma) {
+        for (size_t i = 0; i < MAX_INSTANCES; ++i) {
+            SAMDDmaPlatform* platform = instance(i);
+            if (platform && &platform->dma_ == dma) {
+                platform->completeTx();
+                return;
+            }
+        }
+    }
+};
+
+#endif
+
+} // namespace TurboMIDI
+
+#endif // TURBOMIDI_ARDUINO_DMA_HPP
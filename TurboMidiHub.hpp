@@ -0,0 +1,378 @@
+/**
+ * @file TurboMidiHub.hpp
+ * @brief Multi-port TurboMIDI hub for patchbays and routers
+ * @version 1.0
+ *
+ * TurboMIDIHub owns one TurboMIDI link per port, negotiates all of them in
+ * parallel with the non-blocking negotiation API, keeps a separate speed per
+ * port and routes channel and realtime messages between ports. On host
+ * builds the ports can be serviced by several worker threads.
+ */
+
+#ifndef TURBOMIDI_HUB_HPP
+#define TURBOMIDI_HUB_HPP
+
+#include "TurboMidi.hpp"
+#include <new>
+#include <type_traits>
+
+// Worker threads need std::thread; enabled by default on POSIX hosts
+#ifndef TURBOMIDI_HAS_THREADS
+#if defined(__unix__) || defined(__APPLE__)
+#define TURBOMIDI_HAS_THREADS 1
+#else
+#define TURBOMIDI_HAS_THREADS 0
+#endif
+#endif
+
+#if TURBOMIDI_HAS_THREADS
+#include <chrono>
+#include <thread>
+#endif
+
+// Maximum number of worker threads (shards) a hub can run
+#ifndef TURBOMIDI_HUB_MAX_SHARDS
+#define TURBOMIDI_HUB_MAX_SHARDS 4
+#endif
+
+// Per destination and shard buffer for messages routed across threads
+#ifndef TURBOMIDI_HUB_ROUTE_BUFFER_SIZE
+#define TURBOMIDI_HUB_ROUTE_BUFFER_SIZE 1024
+#endif
+
+// Per port buffer for messages routed to it while it negotiates
+#ifndef TURBOMIDI_HUB_HOLD_BUFFER_SIZE
+#define TURBOMIDI_HUB_HOLD_BUFFER_SIZE 256
+#endif
+
+namespace TurboMIDI {
+
+namespace detail {
+
+#if TURBOMIDI_HAS_ATOMIC
+typedef std::atomic<uint8_t> SharedByte;
+typedef std::atomic<bool> SharedFlag;
+
+inline uint8_t takeShared(SharedByte& value) { return value.exchange(0); }
+#else
+typedef volatile uint8_t SharedByte;
+typedef volatile bool SharedFlag;
+
+inline uint8_t takeShared(SharedByte& value) {
+    uint8_t current = value;
+    value = 0;
+    return current;
+}
+#endif
+
+} // namespace detail
+
+/**
+ * Hub managing up to MaxPorts TurboMIDI links
+ *
+ * Without worker threads, call update() from the main loop; every port is
+ * serviced in turn and routed messages are sent directly to the destination
+ * platform. With startWorkers(n), port i is serviced by worker i % n and
+ * messages crossing workers travel through lock-free SPSC rings, so each
+ * platform is only ever touched by the thread that owns its port.
+ *
+ * Routed realtime bytes take the destination's priority lane
+ * (TurboMIDI::sendRealtime()); other messages wait while the destination
+ * negotiates, so they never cut into its speed test.
+ *
+ * Hub callbacks run on the thread that services the port.
+ */
+template <size_t MaxPorts>
+class TurboMIDIHub {
+    static_assert(MaxPorts > 0 && MaxPorts <= 32, "Routes are stored as 32-bit port masks");
+
+public:
+    typedef uint32_t PortMask;
+
+    TurboMIDIHub() {
+        for (size_t i = 0; i < MaxPorts; ++i) {
+            routes_[i] = 0;
+            speeds_[i] = static_cast<uint8_t>(SpeedMultiplier::SPEED_1X);
+            requests_[i] = 0;
+        }
+        running_ = false;
+    }
+
+    ~TurboMIDIHub() {
+#if TURBOMIDI_HAS_THREADS
+        stopWorkers();
+#endif
+        for (size_t i = 0; i < portCount_; ++i) {
+            port(i).~TurboMIDI();
+        }
+    }
+
+    TurboMIDIHub(const TurboMIDIHub&) = delete;
+    TurboMIDIHub& operator=(const TurboMIDIHub&) = delete;
+
+    /**
+     * Add a link; must be called before workers are started
+     * @param platform Platform of the port
+     * @param role Role of this side of the link
+     * @return Port index, or -1 if the hub is full or running
+     */
+    int addPort(IPlatform* platform, DeviceRole role = DeviceRole::MASTER) {
+        if (portCount_ >= MaxPorts || running_) return -1;
+
+        size_t index = portCount_++;
+        platforms_[index] = platform;
+        TurboMIDI* link = new (&storage_[index]) TurboMIDI(platform, role);
+
+        link->onMidiMessage = [this, index](const MidiMessage& message) {
+            const uint8_t bytes[3] = {message.status, message.data1, message.data2};
+            route(index, bytes, message.length);
+        };
+        link->onRealtime = [this, index](uint8_t byte) {
+            route(index, &byte, 1);
+        };
+        link->onSpeedChanged = [this, index](SpeedMultiplier speed) {
+            speeds_[index] = static_cast<uint8_t>(speed);
+            if (onPortSpeedChanged) onPortSpeedChanged(index, speed);
+        };
+        link->onNegotiationComplete = [this, index](bool success, SpeedMultiplier speed) {
+            if (onPortNegotiationComplete) onPortNegotiationComplete(index, success, speed);
+        };
+        return static_cast<int>(index);
+    }
+
+    size_t portCount() const { return portCount_; }
+
+    // Direct access for configuration; only safe while no workers are running
+    TurboMIDI& port(size_t index) { return *reinterpret_cast<TurboMIDI*>(&storage_[index]); }
+
+    // Current speed of a port, safe to call from any thread
+    SpeedMultiplier getSpeed(size_t index) const {
+        return static_cast<SpeedMultiplier>(static_cast<uint8_t>(speeds_[index]));
+    }
+
+    // Routing: messages received on `source` are forwarded to every port in the mask
+    void setRoutes(size_t source, PortMask destinations) { routes_[source] = destinations; }
+    void connect(size_t source, size_t destination) { routes_[source] |= PortMask(1) << destination; }
+    void disconnect(size_t source, size_t destination) { routes_[source] &= ~(PortMask(1) << destination); }
+    PortMask getRoutes(size_t source) const { return routes_[source]; }
+
+    /**
+     * Request a negotiation on a port; safe to call from any thread
+     * The owning worker (or the next update()) starts it without blocking.
+     */
+    void requestNegotiation(size_t index, SpeedMultiplier targetSpeed) {
+        requests_[index] = static_cast<uint8_t>(targetSpeed);
+    }
+
+    void requestNegotiationAll(SpeedMultiplier targetSpeed) {
+        for (size_t i = 0; i < portCount_; ++i) requestNegotiation(i, targetSpeed);
+    }
+
+    /**
+     * Negotiate all ports in parallel and wait for every link to finish
+     * Only for use without worker threads.
+     * @return Mask of ports that switched to the target speed
+     */
+    PortMask negotiateAll(SpeedMultiplier targetSpeed, uint32_t timeoutMs = 30) {
+        PortMask started = 0;
+        for (size_t i = 0; i < portCount_; ++i) {
+            if (port(i).beginNegotiation(targetSpeed, timeoutMs)) started |= PortMask(1) << i;
+        }
+
+        int pending;
+        while ((pending = firstNegotiating(started)) >= 0) {
+            platforms_[pending]->delayMs(1);
+            update();
+        }
+
+        PortMask succeeded = 0;
+        for (size_t i = 0; i < portCount_; ++i) {
+            if ((started & (PortMask(1) << i)) &&
+                port(i).getNegotiationStatus() == NegotiationStatus::SUCCEEDED) {
+                succeeded |= PortMask(1) << i;
+            }
+        }
+        return succeeded;
+    }
+
+    // Service every port once (single-threaded operation)
+    void update() {
+        for (size_t i = 0; i < portCount_; ++i) servicePort(i);
+    }
+
+    // Service the ports of one shard: port i belongs to shard i % shardCount
+    void updateShard(size_t shard, size_t shardCount) {
+        for (size_t i = shard; i < portCount_; i += shardCount) servicePort(i);
+    }
+
+    // Messages dropped because a route or hold buffer was full
+    uint32_t droppedRouteMessages() const {
+        uint32_t total = 0;
+        for (size_t i = 0; i < MaxPorts; ++i) total += heldDropped_[i].load();
+#if TURBOMIDI_HAS_THREADS
+        for (size_t s = 0; s < TURBOMIDI_HUB_MAX_SHARDS; ++s) {
+            total += droppedMessages_[s].load(std::memory_order_relaxed);
+        }
+#endif
+        return total;
+    }
+
+#if TURBOMIDI_HAS_THREADS
+    /**
+     * Service the ports from `count` worker threads
+     * @param count Number of workers (clamped to TURBOMIDI_HUB_MAX_SHARDS and the port count)
+     * @param idleSleepMicros Pause between service passes, 0 just yields
+     */
+    void startWorkers(size_t count, uint32_t idleSleepMicros = 100) {
+        if (running_ || portCount_ == 0) return;
+        count = std::min(std::min(count, static_cast<size_t>(TURBOMIDI_HUB_MAX_SHARDS)), portCount_);
+        if (count == 0) count = 1;
+
+        shardCount_ = count;
+        idleSleepMicros_ = idleSleepMicros;
+        running_ = true;
+        for (size_t i = 0; i < count; ++i) {
+            workers_[i] = std::thread(&TurboMIDIHub::workerLoop, this, i);
+        }
+    }
+
+    void stopWorkers() {
+        if (!running_) return;
+        running_ = false;
+        for (size_t i = 0; i < shardCount_; ++i) {
+            if (workers_[i].joinable()) workers_[i].join();
+        }
+        shardCount_ = 1;
+    }
+
+    bool workersRunning() const { return running_; }
+#endif
+
+    // Hub callbacks (port index first)
+    std::function<void(size_t, SpeedMultiplier)> onPortSpeedChanged;
+    std::function<void(size_t, bool, SpeedMultiplier)> onPortNegotiationComplete;
+
+private:
+    typename std::aligned_storage<sizeof(TurboMIDI), alignof(TurboMIDI)>::type storage_[MaxPorts];
+    IPlatform* platforms_[MaxPorts] = {};
+    PortMask routes_[MaxPorts];
+    detail::SharedByte speeds_[MaxPorts];
+    detail::SharedByte requests_[MaxPorts];
+    size_t portCount_ = 0;
+    size_t shardCount_ = 1;
+    detail::SharedFlag running_;
+    // Messages routed to a negotiating port, touched by its owner only
+    SpscRing<TURBOMIDI_HUB_HOLD_BUFFER_SIZE> held_[MaxPorts];
+    detail::RingTally heldDropped_[MaxPorts];
+
+#if TURBOMIDI_HAS_THREADS
+    std::thread workers_[TURBOMIDI_HUB_MAX_SHARDS];
+    uint32_t idleSleepMicros_ = 100;
+    // inbox_[destination][source shard]: one producer (that shard) and one consumer (owner of destination)
+    SpscRing<TURBOMIDI_HUB_ROUTE_BUFFER_SIZE> inbox_[MaxPorts][TURBOMIDI_HUB_MAX_SHARDS];
+    std::atomic<uint32_t> droppedMessages_[TURBOMIDI_HUB_MAX_SHARDS] = {};  // Written by that shard only
+
+    void workerLoop(size_t shard) {
+        while (running_) {
+            updateShard(shard, shardCount_);
+            if (idleSleepMicros_ > 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(idleSleepMicros_));
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+#endif
+
+    // Index of the first port in the mask still negotiating, -1 if none
+    int firstNegotiating(PortMask ports) {
+        for (size_t i = 0; i < portCount_; ++i) {
+            if ((ports & (PortMask(1) << i)) &&
+                port(i).getNegotiationStatus() == NegotiationStatus::IN_PROGRESS) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    void servicePort(size_t index) {
+        uint8_t request = detail::takeShared(requests_[index]);
+        if (request != 0) {
+            port(index).beginNegotiation(static_cast<SpeedMultiplier>(request));
+        }
+
+        if (!negotiating(index)) {
+            const uint8_t* region;
+            size_t length;
+            while ((length = held_[index].peek(region)) > 0) {
+                platforms_[index]->sendMidiData(region, length);
+                held_[index].consume(length);
+            }
+#if TURBOMIDI_HAS_THREADS
+            // Forward what other shards routed here, straight from the ring
+            for (size_t s = 0; s < TURBOMIDI_HUB_MAX_SHARDS; ++s) {
+                while ((length = inbox_[index][s].peek(region)) > 0) {
+                    forward(index, region, length);
+                    inbox_[index][s].consume(length);
+                }
+            }
+#endif
+        }
+
+        port(index).handleIncomingData();
+    }
+
+    bool negotiating(size_t index) {
+        return port(index).getNegotiationStatus() == NegotiationStatus::IN_PROGRESS;
+    }
+
+    // Send routed bytes from the port's own thread; realtime bytes take its priority lane
+    void forward(size_t index, const uint8_t* data, size_t length) {
+        size_t start = 0;
+        for (size_t i = 0; i < length; ++i) {
+            if (data[i] < REALTIME_FIRST) continue;
+            if (i > start) platforms_[index]->sendMidiData(data + start, i - start);
+            port(index).sendRealtime(data[i]);
+            start = i + 1;
+        }
+        if (length > start) platforms_[index]->sendMidiData(data + start, length - start);
+    }
+
+    void route(size_t source, const uint8_t* data, size_t length) {
+        PortMask destinations = routes_[source];
+        for (size_t dst = 0; destinations != 0 && dst < portCount_; ++dst, destinations >>= 1) {
+            if (!(destinations & 1) || dst == source) continue;
+
+#if TURBOMIDI_HAS_THREADS
+            if (running_ && dst % shardCount_ != source % shardCount_) {
+                // Whole messages only, so a full ring never splits one
+                size_t shard = source % shardCount_;
+                SpscByteRing& ring = inbox_[dst][shard];
+                if (ring.capacity() - ring.size() >= length) {
+                    ring.write(data, length);
+                } else {
+                    droppedMessages_[shard].fetch_add(1, std::memory_order_relaxed);
+                }
+                continue;
+            }
+#endif
+            if (length == 1 && data[0] >= REALTIME_FIRST) {
+                port(dst).sendRealtime(data[0]);
+            } else if (negotiating(dst) || !held_[dst].empty()) {
+                // Held until the negotiation is over, in order
+                SpscByteRing& held = held_[dst];
+                if (held.capacity() - held.size() >= length) {
+                    held.write(data, length);
+                } else {
+                    heldDropped_[dst].add(1);
+                }
+            } else {
+                platforms_[dst]->sendMidiData(data, length);
+            }
+        }
+    }
+};
+
+} // namespace TurboMIDI
+
+#endif // TURBOMIDI_HUB_HPP
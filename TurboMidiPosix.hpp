@@ -0,0 +1,380 @@
+/**
+ * @file TurboMidiPosix.hpp
+ * @brief POSIX (Linux/macOS/BSD) serial port implementation of TurboMIDI
+ * @version 1.0
+ *
+ * This file provides a host platform for TurboMIDI on serial devices
+ * (/dev/ttyUSB0, /dev/ttyAMA0, /dev/cu.usbserial-*, ...). It sets the exact
+ * TurboMIDI baud rates, including non-standard ones like 103125 and 415625,
+ * reads in large non-blocking chunks and waits for data with epoll/kqueue.
+ */
+
+#ifndef TURBOMIDI_POSIX_HPP
+#define TURBOMIDI_POSIX_HPP
+
+#include "TurboMidi.hpp"
+
+#include <cerrno>
+#include <ctime>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#define TURBOMIDI_POSIX_EPOLL 1
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
+#include <sys/event.h>
+#define TURBOMIDI_POSIX_KQUEUE 1
+#endif
+
+#if defined(__APPLE__)
+#include <IOKit/serial/ioss.h>
+#endif
+
+namespace TurboMIDI {
+
+namespace detail {
+
+#if defined(__linux__) && (defined(__x86_64__) || defined(__i386__) || defined(__arm__) || \
+                           defined(__aarch64__) || defined(__riscv))
+// Kernel struct termios2 (asm-generic layout). Declared here because
+// <asm/termbits.h> cannot be included together with <termios.h>.
+struct Termios2 {
+    unsigned int c_iflag;
+    unsigned int c_oflag;
+    unsigned int c_cflag;
+    unsigned int c_lflag;
+    unsigned char c_line;
+    unsigned char c_cc[19];
+    unsigned int c_ispeed;
+    unsigned int c_ospeed;
+};
+
+constexpr unsigned int TERMIOS2_CBAUD = 0010017;
+constexpr unsigned int TERMIOS2_BOTHER = 0010000;
+#define TURBOMIDI_POSIX_TERMIOS2 1
+#endif
+
+} // namespace detail
+
+/**
+ * POSIX serial port platform
+ *
+ * Opens the device in raw, non-blocking mode. setBaudRate() uses
+ * termios2/BOTHER on Linux and IOSSIOSPEED on macOS so every TurboMIDI rate
+ * is programmed exactly; other BSDs accept numeric speeds in cfsetspeed().
+ * getMillis() and getMicros() are based on the monotonic clock.
+ */
+class PosixPlatform : public IPlatform {
+public:
+    PosixPlatform() : epoch_(monotonicMillis()) {}
+
+    /**
+     * Adopt an already open descriptor (pty, socket pair, ...)
+     * @param fd Descriptor to use; switched to non-blocking mode
+     * @param ownsFd Close the descriptor on destruction
+     */
+    explicit PosixPlatform(int fd, bool ownsFd = false) : epoch_(monotonicMillis()) {
+        attach(fd, ownsFd);
+    }
+
+    ~PosixPlatform() override {
+        close();
+    }
+
+    PosixPlatform(const PosixPlatform&) = delete;
+    PosixPlatform& operator=(const PosixPlatform&) = delete;
+
+    /**
+     * Open a serial device in raw mode at the standard MIDI rate
+     * @param device Device path, e.g. "/dev/ttyUSB0"
+     * @return true on success; see lastError() otherwise
+     */
+    bool open(const char* device) {
+        close();
+
+        int fd = ::open(device, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) {
+            lastError_ = errno;
+            return false;
+        }
+
+        struct termios tio;
+        if (tcgetattr(fd, &tio) != 0) {
+            lastError_ = errno;
+            ::close(fd);
+            return false;
+        }
+        cfmakeraw(&tio);
+        tio.c_cflag |= CLOCAL | CREAD;
+        tio.c_cflag &= ~(CSTOPB | PARENB);
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 0;
+        if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+            lastError_ = errno;
+            ::close(fd);
+            return false;
+        }
+
+        if (!attach(fd, true)) return false;
+        setBaudRate(31250);
+        return lastError_ == 0;
+    }
+
+    void close() {
+        closePoller();
+        if (fd_ >= 0 && ownsFd_) ::close(fd_);
+        fd_ = -1;
+        ownsFd_ = false;
+    }
+
+    bool isOpen() const { return fd_ >= 0; }
+    int fd() const { return fd_; }
+    uint32_t getBaudRate() const { return baudRate_; }
+
+    // errno of the last failed operation (0 if none)
+    int lastError() const { return lastError_; }
+
+    // IPlatform interface implementation
+    void sendMidiData(const uint8_t* data, size_t length) override {
+        while (length > 0 && fd_ >= 0) {
+            ssize_t written = ::write(fd_, data, length);
+            if (written > 0) {
+                data += written;
+                length -= static_cast<size_t>(written);
+            } else if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                struct pollfd pfd = {fd_, POLLOUT, 0};
+                ::poll(&pfd, 1, -1);
+            } else if (written < 0 && errno == EINTR) {
+                continue;
+            } else {
+                lastError_ = errno;
+                return;
+            }
+        }
+    }
+
+    size_t receiveMidiData(uint8_t* buffer, size_t maxLength) override {
+        if (fd_ < 0) return 0;
+        ssize_t count;
+        do {
+            count = ::read(fd_, buffer, maxLength);
+        } while (count < 0 && errno == EINTR);
+
+        if (count < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) lastError_ = errno;
+            return 0;
+        }
+        return static_cast<size_t>(count);
+    }
+
+    uint32_t getMillis() override {
+        return static_cast<uint32_t>(monotonicMillis() - epoch_);
+    }
+
+    uint32_t getMicros() override {
+        return static_cast<uint32_t>(monotonicMicros() - epoch_ * 1000u);
+    }
+
+    void setBaudRate(uint32_t baudRate) override {
+        if (fd_ < 0) return;
+
+        // Bytes still in the driver belong to the old rate
+        tcdrain(fd_);
+
+        if (applyBaudRate(baudRate)) {
+            baudRate_ = baudRate;
+        } else {
+            lastError_ = errno;
+        }
+    }
+
+    void delayMs(uint32_t ms) override {
+        struct timespec ts;
+        ts.tv_sec = static_cast<time_t>(ms / 1000);
+        ts.tv_nsec = static_cast<long>((ms % 1000) * 1000000L);
+        while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+        }
+    }
+
+    void delayMicros(uint32_t micros) override {
+        struct timespec ts;
+        ts.tv_sec = static_cast<time_t>(micros / 1000000);
+        ts.tv_nsec = static_cast<long>((micros % 1000000) * 1000L);
+        while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+        }
+    }
+
+    /**
+     * Wait until data is readable (epoll on Linux, kqueue on macOS/BSD)
+     * @param timeoutMs Maximum time to wait, -1 waits forever
+     * @return true if data is available
+     */
+    bool waitReadable(int timeoutMs) {
+        if (fd_ < 0) return false;
+#if defined(TURBOMIDI_POSIX_EPOLL)
+        struct epoll_event event;
+        int ready;
+        do {
+            ready = epoll_wait(poller_, &event, 1, timeoutMs);
+        } while (ready < 0 && errno == EINTR);
+        return ready > 0;
+#elif defined(TURBOMIDI_POSIX_KQUEUE)
+        struct kevent event;
+        struct timespec ts;
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = (timeoutMs % 1000) * 1000000L;
+        int ready;
+        do {
+            ready = kevent(poller_, nullptr, 0, &event, 1, timeoutMs < 0 ? nullptr : &ts);
+        } while (ready < 0 && errno == EINTR);
+        return ready > 0;
+#else
+        struct pollfd pfd = {fd_, POLLIN, 0};
+        return ::poll(&pfd, 1, timeoutMs) > 0;
+#endif
+    }
+
+    /**
+     * Reader-thread helper: wait for data and move it into a receive ring
+     * Pair with TurboMIDI::attachReceiveRing() on the consumer side.
+     * @return Number of bytes placed in the ring
+     */
+    size_t serviceReceive(SpscByteRing& ring, int timeoutMs) {
+        if (!waitReadable(timeoutMs)) return 0;
+
+        uint8_t buffer[4096];
+        size_t total = 0;
+        size_t count;
+        while ((count = receiveMidiData(buffer, sizeof(buffer))) > 0) {
+            total += ring.write(buffer, count);
+            if (count < sizeof(buffer)) break;
+        }
+        return total;
+    }
+
+private:
+    int fd_ = -1;
+    bool ownsFd_ = false;
+    int poller_ = -1;
+    int lastError_ = 0;
+    uint32_t baudRate_ = 31250;
+    uint64_t epoch_;
+
+    static uint64_t monotonicMillis() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000u + static_cast<uint64_t>(ts.tv_nsec / 1000000L);
+    }
+
+    static uint64_t monotonicMicros() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000u + static_cast<uint64_t>(ts.tv_nsec / 1000L);
+    }
+
+    bool attach(int fd, bool ownsFd) {
+        fd_ = fd;
+        ownsFd_ = ownsFd;
+        lastError_ = 0;
+
+        int flags = fcntl(fd_, F_GETFL);
+        if (flags < 0 || fcntl(fd_, F_SETFL, flags | O_NONBLOCK) != 0) {
+            lastError_ = errno;
+        }
+
+#if defined(TURBOMIDI_POSIX_EPOLL)
+        poller_ = epoll_create1(EPOLL_CLOEXEC);
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = fd_;
+        if (poller_ < 0 || epoll_ctl(poller_, EPOLL_CTL_ADD, fd_, &event) != 0) {
+            lastError_ = errno;
+        }
+#elif defined(TURBOMIDI_POSIX_KQUEUE)
+        poller_ = kqueue();
+        struct kevent event;
+        EV_SET(&event, fd_, EVFILT_READ, EV_ADD, 0, 0, nullptr);
+        if (poller_ < 0 || kevent(poller_, &event, 1, nullptr, 0, nullptr) != 0) {
+            lastError_ = errno;
+        }
+#endif
+        return lastError_ == 0;
+    }
+
+    void closePoller() {
+        if (poller_ >= 0) ::close(poller_);
+        poller_ = -1;
+    }
+
+    bool applyBaudRate(uint32_t baudRate) {
+#if defined(TURBOMIDI_POSIX_TERMIOS2)
+        detail::Termios2 tio;
+        if (ioctl(fd_, _IOR('T', 0x2A, detail::Termios2), &tio) != 0) return false;
+        tio.c_cflag &= ~detail::TERMIOS2_CBAUD;
+        tio.c_cflag |= detail::TERMIOS2_BOTHER;
+        tio.c_ispeed = baudRate;
+        tio.c_ospeed = baudRate;
+        return ioctl(fd_, _IOW('T', 0x2B, detail::Termios2), &tio) == 0;
+#elif defined(__APPLE__)
+        speed_t speed = static_cast<speed_t>(baudRate);
+        return ioctl(fd_, IOSSIOSPEED, &speed) == 0;
+#else
+        // BSD termios stores speeds as plain numbers
+        struct termios tio;
+        if (tcgetattr(fd_, &tio) != 0) return false;
+        cfsetispeed(&tio, static_cast<speed_t>(baudRate));
+        cfsetospeed(&tio, static_cast<speed_t>(baudRate));
+        return tcsetattr(fd_, TCSANOW, &tio) == 0;
+#endif
+    }
+};
+
+/**
+ * PeerCache persistence in a small binary file
+ * The file is rewritten whenever the cache changes.
+ */
+class FilePeerCacheStore : public IPeerCacheStore {
+public:
+    /**
+     * @param path File to keep the cache in; the string must outlive the store
+     */
+    explicit FilePeerCacheStore(const char* path) : path_(path) {}
+    
+    bool load(uint8_t* data, size_t length) override {
+        int fd = ::open(path_, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        size_t total = 0;
+        while (total < length) {
+            ssize_t count = ::read(fd, data + total, length - total);
+            if (count < 0 && errno == EINTR) continue;
+            if (count <= 0) break;
+            total += static_cast<size_t>(count);
+        }
+        ::close(fd);
+        return total == length;
+    }
+    
+    void save(const uint8_t* data, size_t length) override {
+        int fd = ::open(path_, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) return;
+        size_t total = 0;
+        while (total < length) {
+            ssize_t count = ::write(fd, data + total, length - total);
+            if (count < 0 && errno == EINTR) continue;
+            if (count <= 0) break;
+            total += static_cast<size_t>(count);
+        }
+        ::close(fd);
+    }
+    
+private:
+    const char* path_;
+};
+
+} // namespace TurboMIDI
+
+#endif // TURBOMIDI_POSIX_HPP
@@ -0,0 +1,286 @@
+/**
+ * @file TurboMidiSim.hpp
+ * @brief Deterministic virtual-time MIDI link for tests and benchmarks
+ * @version 1.0
+ *
+ * SimulatedLink connects two IPlatform endpoints through a simulated cable.
+ * Both share a virtual clock; bytes take their real time on the wire at the
+ * sender's baud rate, arrive garbled when the receiver runs at a different
+ * rate or has just switched, and can be hit by bit errors or dropped. All
+ * randomness comes from a seeded generator, so every run is reproducible.
+ * A full negotiation takes about 15 us of CPU time; a 100 KB dump at 20x,
+ * 1.6 s of virtual time in 100 us steps, about 3 ms. The byte queues keep
+ * their capacity, so a link allocates only while they first grow. Host
+ * only (uses std::vector and std::function).
+ */
+
+#ifndef TURBOMIDI_SIM_HPP
+#define TURBOMIDI_SIM_HPP
+
+#include "TurboMidi.hpp"
+#include <vector>
+
+namespace TurboMIDI {
+
+namespace detail {
+
+// FIFO on a vector that keeps its capacity, so a warmed-up link does not allocate
+template <typename T>
+class SimQueue {
+public:
+    bool empty() const { return head_ == items_.size(); }
+    size_t size() const { return items_.size() - head_; }
+    const T& front() const { return items_[head_]; }
+    T& operator[](size_t index) { return items_[head_ + index]; }
+    void push_back(const T& item) { items_.push_back(item); }
+    void insert(size_t index, const T& item) {
+        items_.insert(items_.begin() + static_cast<std::ptrdiff_t>(head_ + index), item);
+    }
+
+    void pop_front() {
+        if (++head_ == items_.size()) {
+            items_.clear();
+            head_ = 0;
+        } else if (head_ >= 4096 && head_ * 2 >= items_.size()) {
+            // Never drained: drop the consumed half, amortized O(1) per byte
+            items_.erase(items_.begin(), items_.begin() + static_cast<std::ptrdiff_t>(head_));
+            head_ = 0;
+        }
+    }
+
+private:
+    std::vector<T> items_;
+    size_t head_ = 0;
+};
+
+} // namespace detail
+
+// Fault model and time resolution of a SimulatedLink
+struct SimLinkConfig {
+    double bitErrorRate = 0.0;          // Probability that a data bit is flipped
+    uint32_t bitErrorMinBaudRate = 0;   // Bit errors only hit bytes sent this fast or faster (a marginal cable)
+    double dropRate = 0.0;              // Probability that a byte is lost
+    uint32_t switchWindowMicros = 0;    // Bytes arriving this soon after the receiver's setBaudRate() are garbled
+    uint32_t stepMicros = 100;          // Time step of delayMs() and runUntil(); the peer is serviced every step
+    bool realtimePriority = true;       // sendRealtimeByte() overtakes queued bytes, like a priority TX queue
+    uint32_t seed = 1;
+};
+
+// Counters for the bytes travelling towards one endpoint
+struct SimLinkCounters {
+    uint32_t sent = 0;          // Bytes the peer put on the wire
+    uint32_t delivered = 0;     // Bytes that reached the receive buffer (possibly damaged)
+    uint32_t garbled = 0;       // Received at the wrong baud rate or during a switch
+    uint32_t corrupted = 0;     // Hit by at least one bit error
+    uint32_t dropped = 0;
+};
+
+class SimulatedLink {
+public:
+    class Endpoint : public IPlatform {
+    public:
+        // Runs this side's device while the other side is blocked in delayMs()
+        std::function<void()> service;
+
+        void sendMidiData(const uint8_t* data, size_t length) override {
+            uint64_t now = link_->nanos_;
+            uint64_t byteNanos = (10000000000ull + baudRate_ / 2) / baudRate_;
+            for (size_t i = 0; i < length; ++i) {
+                // Bytes queue up behind whatever is still being shifted out
+                uint64_t start = txBusyUntil_ > now ? txBusyUntil_ : now;
+                txBusyUntil_ = start + byteNanos;
+                WireByte wireByte = {txBusyUntil_, baudRate_, data[i]};
+                wire_.push_back(wireByte);
+            }
+            peer_->counters_.sent += static_cast<uint32_t>(length);
+        }
+
+        void sendRealtimeByte(uint8_t byte) override {
+            if (link_->config_.realtimePriority) {
+                uint64_t now = link_->nanos_;
+                for (size_t i = 0; i < wire_.size(); ++i) {
+                    // Slip in before the first byte that has not started shifting out
+                    WireByte& next = wire_[i];
+                    uint64_t byteNanos = (10000000000ull + next.baudRate / 2) / next.baudRate;
+                    if (next.arrival - byteNanos < now) continue;
+                    WireByte wireByte = {next.arrival, next.baudRate, byte};
+                    for (size_t j = i; j < wire_.size(); ++j) wire_[j].arrival += byteNanos;
+                    wire_.insert(i, wireByte);
+                    txBusyUntil_ += byteNanos;
+                    ++peer_->counters_.sent;
+                    return;
+                }
+            }
+            sendMidiData(&byte, 1);
+        }
+
+        bool hasRealtimePriority() const override { return link_->config_.realtimePriority; }
+
+        size_t receiveMidiData(uint8_t* buffer, size_t maxLength) override {
+            link_->deliver();
+            size_t count = 0;
+            while (count < maxLength && !rx_.empty()) {
+                buffer[count++] = rx_.front();
+                rx_.pop_front();
+            }
+            return count;
+        }
+
+        uint32_t getMillis() override { return static_cast<uint32_t>(link_->nanos_ / 1000000u); }
+        uint32_t getMicros() override { return static_cast<uint32_t>(link_->nanos_ / 1000u); }
+
+        // Bytes already on the wire keep the old rate, as if the UART drained first
+        void setBaudRate(uint32_t baudRate) override {
+            link_->deliver();
+            baudRate_ = baudRate;
+            switchedAt_ = link_->nanos_;
+            switched_ = true;
+        }
+
+        void delayMs(uint32_t ms) override { link_->advance(static_cast<uint64_t>(ms) * 1000u, this); }
+        void delayMicros(uint32_t micros) override { link_->advance(micros, this); }
+
+        uint32_t baudRate() const { return baudRate_; }
+        const SimLinkCounters& counters() const { return counters_; }
+        size_t pendingRx() const { return rx_.size(); }
+
+    private:
+        friend class SimulatedLink;
+
+        struct WireByte {
+            uint64_t arrival;       // Virtual time the stop bit is received (ns)
+            uint32_t baudRate;      // Rate it was sent at
+            uint8_t byte;
+        };
+
+        SimulatedLink* link_ = nullptr;
+        Endpoint* peer_ = nullptr;
+        uint32_t baudRate_ = MIDI_BAUD_RATE;
+        uint64_t switchedAt_ = 0;
+        bool switched_ = false;
+        uint64_t txBusyUntil_ = 0;
+        detail::SimQueue<WireByte> wire_;   // Sent by this endpoint, still in flight
+        detail::SimQueue<uint8_t> rx_;
+        SimLinkCounters counters_;
+    };
+
+    explicit SimulatedLink(const SimLinkConfig& config = SimLinkConfig()) : config_(config), random_(config.seed) {
+        if (random_ == 0) random_ = 1;
+        a_.link_ = this;
+        b_.link_ = this;
+        a_.peer_ = &b_;
+        b_.peer_ = &a_;
+    }
+
+    SimulatedLink(const SimulatedLink&) = delete;
+    SimulatedLink& operator=(const SimulatedLink&) = delete;
+
+    Endpoint& a() { return a_; }
+    Endpoint& b() { return b_; }
+
+    // Fault rates may be changed at any time, e.g. to degrade a running link
+    SimLinkConfig& config() { return config_; }
+
+    uint64_t nowNanos() const { return nanos_; }
+    uint32_t nowMicros() const { return static_cast<uint32_t>(nanos_ / 1000u); }
+
+    // Advance virtual time, servicing both endpoints every step
+    void advance(uint32_t micros) { advance(micros, nullptr); }
+
+    /**
+     * Service both endpoints and advance time until done() returns true
+     * @return false if timeoutMicros of virtual time passed first
+     */
+    template <typename Done>
+    bool runUntil(Done done, uint32_t timeoutMicros) {
+        uint64_t end = nanos_ + static_cast<uint64_t>(timeoutMicros) * 1000u;
+        serviceAll(nullptr);
+        while (!done()) {
+            if (nanos_ >= end) return false;
+            advance(config_.stepMicros, nullptr);
+        }
+        return true;
+    }
+
+private:
+    SimLinkConfig config_;
+    uint32_t random_;
+    uint64_t nanos_ = 0;
+    bool servicing_ = false;
+    Endpoint a_;
+    Endpoint b_;
+
+    void advance(uint64_t micros, Endpoint* blocked) {
+        uint64_t end = nanos_ + micros * 1000u;
+        while (nanos_ < end) {
+            uint64_t step = std::min(static_cast<uint64_t>(config_.stepMicros ? config_.stepMicros : 1) * 1000u,
+                                     end - nanos_);
+            nanos_ += step;
+            deliver();
+            serviceAll(blocked);
+        }
+    }
+
+    void serviceAll(Endpoint* blocked) {
+        // A device blocking inside its own service only moves the clock
+        if (servicing_) return;
+        servicing_ = true;
+        if (&a_ != blocked && a_.service) a_.service();
+        if (&b_ != blocked && b_.service) b_.service();
+        servicing_ = false;
+    }
+
+    void deliver() {
+        deliverTo(b_, a_.wire_);
+        deliverTo(a_, b_.wire_);
+    }
+
+    void deliverTo(Endpoint& receiver, detail::SimQueue<Endpoint::WireByte>& wire) {
+        while (!wire.empty() && wire.front().arrival <= nanos_) {
+            Endpoint::WireByte wireByte = wire.front();
+            wire.pop_front();
+
+            if (config_.dropRate > 0 && chance(config_.dropRate)) {
+                ++receiver.counters_.dropped;
+                continue;
+            }
+
+            uint8_t byte = wireByte.byte;
+            bool switching = receiver.switched_ &&
+                             wireByte.arrival - receiver.switchedAt_ < static_cast<uint64_t>(config_.switchWindowMicros) * 1000u;
+            if (wireByte.baudRate != receiver.baudRate_ || switching) {
+                // A line held low reads as zero at any rate; anything else is noise
+                if (byte != 0) byte = static_cast<uint8_t>(nextRandom());
+                ++receiver.counters_.garbled;
+            } else if (config_.bitErrorRate > 0 && wireByte.baudRate >= config_.bitErrorMinBaudRate) {
+                uint8_t flips = 0;
+                for (int bit = 0; bit < 8; ++bit) {
+                    if (chance(config_.bitErrorRate)) flips |= static_cast<uint8_t>(1u << bit);
+                }
+                if (flips) {
+                    byte ^= flips;
+                    ++receiver.counters_.corrupted;
+                }
+            }
+
+            receiver.rx_.push_back(byte);
+            ++receiver.counters_.delivered;
+        }
+    }
+
+    // xorshift32: fast and identical on every platform
+    uint32_t nextRandom() {
+        random_ ^= random_ << 13;
+        random_ ^= random_ >> 17;
+        random_ ^= random_ << 5;
+        return random_;
+    }
+
+    bool chance(double probability) {
+        return nextRandom() * (1.0 / 4294967296.0) < probability;
+    }
+};
+
+} // namespace TurboMIDI
+
+#endif // TURBOMIDI_SIM_HPP
@@ -0,0 +1,430 @@
+/**
+ * @file TurboMidiThreaded.hpp
+ * @brief Thread-safe host facade running a TurboMIDI link on its own threads
+ * @version 1.0
+ *
+ * ThreadedTurboMIDI owns two worker threads. The RX thread only reads the
+ * platform and writes into a lock-free receive ring. The link thread owns
+ * the protocol engine: it parses, runs negotiations and timers and does all
+ * sending. The application talks to the link thread through two more SPSC
+ * rings, a command mailbox and an event queue, so no thread takes a lock.
+ * Host only (std::thread).
+ */
+
+#ifndef TURBOMIDI_THREADED_HPP
+#define TURBOMIDI_THREADED_HPP
+
+#include "TurboMidi.hpp"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// Bytes the RX thread can buffer ahead of the link thread
+#ifndef TURBOMIDI_THREADED_RX_BUFFER_SIZE
+#define TURBOMIDI_THREADED_RX_BUFFER_SIZE 8192
+#endif
+
+// Application to link thread commands, including queued send data
+#ifndef TURBOMIDI_THREADED_MAILBOX_SIZE
+#define TURBOMIDI_THREADED_MAILBOX_SIZE 4096
+#endif
+
+// Link thread to application events
+#ifndef TURBOMIDI_THREADED_EVENT_BUFFER_SIZE
+#define TURBOMIDI_THREADED_EVENT_BUFFER_SIZE 8192
+#endif
+
+namespace TurboMIDI {
+
+enum class LinkEventType : uint8_t {
+    MIDI_MESSAGE,
+    REALTIME,
+    SYSEX_BEGIN,
+    SYSEX_DATA,
+    SYSEX_DONE,         // Not SYSEX_END, which would shadow the status byte constant
+    SPEED_CHANGED,
+    NEGOTIATION_COMPLETE
+};
+
+// Something the link thread reports back to the application
+struct LinkEvent {
+    static constexpr size_t MAX_DATA = 64;  // SysEx arrives in chunks of at most this size
+
+    LinkEventType type = LinkEventType::MIDI_MESSAGE;
+    MidiMessage message;                            // MIDI_MESSAGE
+    uint8_t realtime = 0;                           // REALTIME
+    SpeedMultiplier speed = SpeedMultiplier::SPEED_1X;  // SPEED_CHANGED, NEGOTIATION_COMPLETE
+    bool success = false;                           // NEGOTIATION_COMPLETE; SYSEX_DONE: terminated by SYSEX_END
+    uint8_t length = 0;                             // SYSEX_DATA
+    uint8_t data[MAX_DATA] = {};
+};
+
+namespace detail {
+
+// Mailbox and event records: fixed header, then `length` payload bytes.
+// A record is only written when it fits as a whole, and write() publishes
+// it with a single head update, so the consumer never sees half a record.
+struct ThreadedRecord {
+    static constexpr size_t HEADER = 6;
+
+    uint8_t type;
+    uint8_t value[4];
+    uint8_t length;
+
+    static bool write(SpscByteRing& ring, const ThreadedRecord& record, const uint8_t* payload) {
+        if (ring.capacity() - ring.size() < HEADER + record.length) return false;
+        uint8_t buffer[HEADER + 255];
+        buffer[0] = record.type;
+        memcpy(buffer + 1, record.value, 4);
+        buffer[5] = record.length;
+        if (payload && record.length > 0) memcpy(buffer + HEADER, payload, record.length);
+        ring.write(buffer, HEADER + record.length);
+        return true;
+    }
+
+    // Header of the next record without consuming it
+    static bool peek(SpscByteRing& ring, ThreadedRecord& record) {
+        if (ring.size() < HEADER) return false;
+        uint8_t buffer[HEADER];
+        copyOut(ring, buffer, HEADER, 0);
+        record.type = buffer[0];
+        memcpy(record.value, buffer + 1, 4);
+        record.length = buffer[5];
+        return true;
+    }
+
+    // Consume the record returned by peek(), copying its payload out
+    static void take(SpscByteRing& ring, const ThreadedRecord& record, uint8_t* payload) {
+        copyOut(ring, payload, record.length, HEADER);
+        ring.consume(HEADER + record.length);
+    }
+
+private:
+    // Copy without consuming; the ring may wrap inside the record
+    static void copyOut(SpscByteRing& ring, uint8_t* out, size_t length, size_t skip) {
+        const uint8_t* region;
+        size_t first = ring.peek(region);
+        if (skip < first) {
+            size_t count = minOf(length, first - skip);
+            memcpy(out, region + skip, count);
+            out += count;
+            length -= count;
+            skip = first;
+        }
+        // Anything after the contiguous region continues at the start of the storage
+        if (length > 0) memcpy(out, region + first - ring.capacity() + (skip - first), length);
+    }
+};
+
+} // namespace detail
+
+/**
+ * TurboMIDI link serviced by dedicated RX and link threads
+ *
+ * Configure the engine with link() and start() the threads; from then on
+ * only use the thread-safe interface:
+ *
+ * - send(), requestNegotiation(), requestBestNegotiation(), pushSpeed() and
+ *   cancelNegotiation() post to the command mailbox and return at once
+ *   (false if the mailbox is full). One application thread may post.
+ * - pollEvent() returns received messages, SysEx chunks, speed changes and
+ *   negotiation results. One application thread may poll.
+ * - getSpeed() and getNegotiationStatus() may be read from any thread.
+ *
+ * Sends posted while a negotiation runs are held in the mailbox and go out
+ * once it finishes, at the new speed. The platform must allow
+ * receiveMidiData() to run on the RX thread while the link thread sends and
+ * changes the baud rate; PosixPlatform does.
+ */
+class ThreadedTurboMIDI {
+public:
+    ThreadedTurboMIDI(IPlatform* platform, DeviceRole role = DeviceRole::MASTER)
+        : platform_(platform), link_(platform, role) {
+        link_.attachReceiveRing(&rxRing_);
+
+        link_.onMidiMessage = [this](const MidiMessage& message) {
+            ThreadedRecord record = header(LinkEventType::MIDI_MESSAGE);
+            record.value[0] = message.status;
+            record.value[1] = message.data1;
+            record.value[2] = message.data2;
+            record.value[3] = message.length;
+            postEvent(record);
+        };
+        link_.onRealtime = [this](uint8_t byte) {
+            ThreadedRecord record = header(LinkEventType::REALTIME);
+            record.value[0] = byte;
+            postEvent(record);
+        };
+        link_.onSysExBegin = [this]() { postEvent(header(LinkEventType::SYSEX_BEGIN)); };
+        link_.onSysExChunk = [this](const uint8_t* data, size_t length) {
+            while (length > 0) {
+                ThreadedRecord record = header(LinkEventType::SYSEX_DATA);
+                record.length = static_cast<uint8_t>(detail::minOf(length, LinkEvent::MAX_DATA));
+                postEvent(record, data);
+                data += record.length;
+                length -= record.length;
+            }
+        };
+        link_.onSysExEnd = [this](bool complete) {
+            ThreadedRecord record = header(LinkEventType::SYSEX_DONE);
+            record.value[0] = complete ? 1 : 0;
+            postEvent(record);
+        };
+        link_.onSpeedChanged = [this](SpeedMultiplier speed) {
+            speed_.store(static_cast<uint8_t>(speed), std::memory_order_release);
+            ThreadedRecord record = header(LinkEventType::SPEED_CHANGED);
+            record.value[0] = static_cast<uint8_t>(speed);
+            postEvent(record);
+        };
+        link_.onNegotiationComplete = [this](bool success, SpeedMultiplier speed) {
+            ThreadedRecord record = header(LinkEventType::NEGOTIATION_COMPLETE);
+            record.value[0] = success ? 1 : 0;
+            record.value[1] = static_cast<uint8_t>(speed);
+            postEvent(record);
+        };
+    }
+
+    ~ThreadedTurboMIDI() { stop(); }
+
+    ThreadedTurboMIDI(const ThreadedTurboMIDI&) = delete;
+    ThreadedTurboMIDI& operator=(const ThreadedTurboMIDI&) = delete;
+
+    // Direct access for configuration; only safe while stopped. Do not
+    // replace the callbacks, they feed the event queue.
+    TurboMIDI& link() { return link_; }
+
+    /**
+     * Start the RX and link threads
+     * @param idleSleepMicros Pause of a thread that found nothing to do, 0 just yields
+     */
+    void start(uint32_t idleSleepMicros = 100) {
+        if (running_) return;
+        idleSleepMicros_ = idleSleepMicros;
+        speed_.store(static_cast<uint8_t>(link_.getCurrentSpeed()), std::memory_order_relaxed);
+        status_.store(static_cast<uint8_t>(link_.getNegotiationStatus()), std::memory_order_relaxed);
+        running_ = true;
+        rxThread_ = std::thread(&ThreadedTurboMIDI::rxLoop, this);
+        linkThread_ = std::thread(&ThreadedTurboMIDI::linkLoop, this);
+    }
+
+    // Stop and join both threads; commands still in the mailbox stay queued
+    void stop() {
+        if (!running_) return;
+        running_ = false;
+        if (rxThread_.joinable()) rxThread_.join();
+        if (linkThread_.joinable()) linkThread_.join();
+    }
+
+    bool running() const { return running_; }
+
+    // Application side: command mailbox (single producer)
+
+    // Queue bytes for sending; split into records, all or nothing
+    bool send(const uint8_t* data, size_t length) {
+        size_t records = (length + 254) / 255;
+        if (mailbox_.capacity() - mailbox_.size() < length + records * ThreadedRecord::HEADER) {
+            droppedCommands_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        while (length > 0) {
+            ThreadedRecord record = header(Command::SEND);
+            record.length = static_cast<uint8_t>(detail::minOf(length, static_cast<size_t>(255)));
+            ThreadedRecord::write(mailbox_, record, data);
+            data += record.length;
+            length -= record.length;
+        }
+        return true;
+    }
+
+    bool send(const MidiMessage& message) {
+        const uint8_t bytes[3] = {message.status, message.data1, message.data2};
+        return send(bytes, message.length);
+    }
+
+    bool requestNegotiation(SpeedMultiplier targetSpeed, uint32_t timeoutMs = 30) {
+        ThreadedRecord record = header(Command::NEGOTIATE);
+        record.value[0] = static_cast<uint8_t>(targetSpeed);
+        putTimeout(record, timeoutMs);
+        return postCommand(record);
+    }
+
+    bool requestBestNegotiation(uint32_t timeoutMs = 30) {
+        ThreadedRecord record = header(Command::NEGOTIATE_BEST);
+        putTimeout(record, timeoutMs);
+        return postCommand(record);
+    }
+
+    bool pushSpeed(SpeedMultiplier speed) {
+        ThreadedRecord record = header(Command::PUSH_SPEED);
+        record.value[0] = static_cast<uint8_t>(speed);
+        return postCommand(record);
+    }
+
+    bool cancelNegotiation() { return postCommand(header(Command::CANCEL)); }
+
+    // Application side: event queue (single consumer)
+    bool pollEvent(LinkEvent& event) {
+        ThreadedRecord record;
+        if (!ThreadedRecord::peek(events_, record)) return false;
+        ThreadedRecord::take(events_, record, event.data);
+
+        event.type = static_cast<LinkEventType>(record.type);
+        event.length = record.length;
+        switch (event.type) {
+            case LinkEventType::MIDI_MESSAGE:
+                event.message.status = record.value[0];
+                event.message.data1 = record.value[1];
+                event.message.data2 = record.value[2];
+                event.message.length = record.value[3];
+                break;
+            case LinkEventType::REALTIME:
+                event.realtime = record.value[0];
+                break;
+            case LinkEventType::SYSEX_DONE:
+                event.success = record.value[0] != 0;
+                break;
+            case LinkEventType::SPEED_CHANGED:
+                event.speed = static_cast<SpeedMultiplier>(record.value[0]);
+                break;
+            case LinkEventType::NEGOTIATION_COMPLETE:
+                event.success = record.value[0] != 0;
+                event.speed = static_cast<SpeedMultiplier>(record.value[1]);
+                break;
+            default:
+                break;
+        }
+        return true;
+    }
+
+    // Any thread
+    SpeedMultiplier getSpeed() const {
+        return static_cast<SpeedMultiplier>(speed_.load(std::memory_order_acquire));
+    }
+
+    NegotiationStatus getNegotiationStatus() const {
+        return static_cast<NegotiationStatus>(status_.load(std::memory_order_acquire));
+    }
+
+    // Commands refused because the mailbox was full, events lost because
+    // the application fell behind, and received bytes the link thread
+    // could not keep up with
+    uint32_t droppedCommands() const { return droppedCommands_.load(std::memory_order_relaxed); }
+    uint32_t droppedEvents() const { return droppedEvents_.load(std::memory_order_relaxed); }
+    size_t droppedRxBytes() const { return rxRing_.droppedBytes(); }
+
+private:
+    typedef detail::ThreadedRecord ThreadedRecord;
+
+    enum class Command : uint8_t { SEND, NEGOTIATE, NEGOTIATE_BEST, PUSH_SPEED, CANCEL };
+
+    IPlatform* platform_;
+    TurboMIDI link_;
+    SpscRing<TURBOMIDI_THREADED_RX_BUFFER_SIZE> rxRing_;        // RX thread -> link thread
+    SpscRing<TURBOMIDI_THREADED_MAILBOX_SIZE> mailbox_;         // Application -> link thread
+    SpscRing<TURBOMIDI_THREADED_EVENT_BUFFER_SIZE> events_;     // Link thread -> application
+    std::atomic<bool> running_{false};
+    std::atomic<uint8_t> speed_{static_cast<uint8_t>(SpeedMultiplier::SPEED_1X)};
+    std::atomic<uint8_t> status_{static_cast<uint8_t>(NegotiationStatus::IDLE)};
+    std::atomic<uint32_t> droppedCommands_{0};
+    std::atomic<uint32_t> droppedEvents_{0};
+    std::thread rxThread_;
+    std::thread linkThread_;
+    uint32_t idleSleepMicros_ = 100;
+
+    template <typename Type>
+    static ThreadedRecord header(Type type) {
+        ThreadedRecord record = {static_cast<uint8_t>(type), {0, 0, 0, 0}, 0};
+        return record;
+    }
+
+    static void putTimeout(ThreadedRecord& record, uint32_t timeoutMs) {
+        uint16_t timeout = static_cast<uint16_t>(detail::minOf(timeoutMs, static_cast<uint32_t>(0xFFFF)));
+        record.value[1] = static_cast<uint8_t>(timeout >> 8);
+        record.value[2] = static_cast<uint8_t>(timeout & 0xFF);
+    }
+
+    static uint32_t getTimeout(const ThreadedRecord& record) {
+        return (static_cast<uint32_t>(record.value[1]) << 8) | record.value[2];
+    }
+
+    bool postCommand(const ThreadedRecord& record) {
+        if (ThreadedRecord::write(mailbox_, record, nullptr)) return true;
+        droppedCommands_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    void postEvent(const ThreadedRecord& record, const uint8_t* payload = nullptr) {
+        if (!ThreadedRecord::write(events_, record, payload)) {
+            droppedEvents_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void idle() {
+        if (idleSleepMicros_ > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(idleSleepMicros_));
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    void rxLoop() {
+        uint8_t buffer[256];
+        while (running_) {
+            size_t count = platform_->receiveMidiData(buffer, sizeof(buffer));
+            if (count > 0) {
+                rxRing_.write(buffer, count);
+            } else {
+                idle();
+            }
+        }
+    }
+
+    void linkLoop() {
+        while (running_) {
+            bool busy = serviceMailbox();
+            busy |= !rxRing_.empty();
+            link_.handleIncomingData();
+            status_.store(static_cast<uint8_t>(link_.getNegotiationStatus()), std::memory_order_release);
+            if (!busy) idle();
+        }
+    }
+
+    // Run queued commands in order; a send waits while a negotiation owns the wire
+    bool serviceMailbox() {
+        bool any = false;
+        ThreadedRecord record;
+        uint8_t payload[255];
+        while (ThreadedRecord::peek(mailbox_, record)) {
+            Command command = static_cast<Command>(record.type);
+            if (command == Command::SEND && link_.getNegotiationStatus() == NegotiationStatus::IN_PROGRESS) {
+                break;
+            }
+            ThreadedRecord::take(mailbox_, record, payload);
+            any = true;
+
+            switch (command) {
+                case Command::SEND:
+                    platform_->sendMidiData(payload, record.length);
+                    break;
+                case Command::NEGOTIATE:
+                    link_.beginNegotiation(static_cast<SpeedMultiplier>(record.value[0]), getTimeout(record));
+                    break;
+                case Command::NEGOTIATE_BEST:
+                    link_.beginBestNegotiation(getTimeout(record));
+                    break;
+                case Command::PUSH_SPEED:
+                    link_.pushSpeed(static_cast<SpeedMultiplier>(record.value[0]));
+                    break;
+                case Command::CANCEL:
+                    link_.cancelNegotiation();
+                    break;
+            }
+            status_.store(static_cast<uint8_t>(link_.getNegotiationStatus()), std::memory_order_release);
+        }
+        return any;
+    }
+};
+
+} // namespace TurboMIDI
+
+#endif // TURBOMIDI_THREADED_HPP
@@ -0,0 +1,440 @@
+/**
+ * @file TurboMidiTrace.hpp
+ * @brief Saving, reading and replaying TurboMIDI link traces on the host
+ * @version 1.0
+ *
+ * A trace is the record stream a TraceRecorder produces. Trace files start
+ * with a 12 byte header: "TMTR", format version, device role, two reserved
+ * bytes and the recording side's SpeedConfig masks, so a replay can rebuild
+ * the engine that produced it. TraceFileWriter drains a recorder's ring to
+ * a file, TraceFile memory-maps one, TraceReader walks the records and
+ * replayTrace() runs them through a TurboMIDI instance at full speed on a
+ * virtual clock. TraceFile and TraceFileWriter need POSIX file I/O and mmap
+ * (TURBOMIDI_HAS_TRACE_FILES); reading and replaying traces in memory works
+ * on any host.
+ */
+
+#ifndef TURBOMIDI_TRACE_HPP
+#define TURBOMIDI_TRACE_HPP
+
+#include "TurboMidi.hpp"
+
+// TraceFile and TraceFileWriter; enabled by default on Linux and macOS
+#ifndef TURBOMIDI_HAS_TRACE_FILES
+#if defined(__linux__) || defined(__APPLE__)
+#define TURBOMIDI_HAS_TRACE_FILES 1
+#else
+#define TURBOMIDI_HAS_TRACE_FILES 0
+#endif
+#endif
+
+#if TURBOMIDI_HAS_TRACE_FILES
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace TurboMIDI {
+
+constexpr size_t TRACE_FILE_HEADER_LENGTH = 12;
+constexpr uint8_t TRACE_FILE_VERSION = 2;  // 2: varint delta timestamps
+
+// Identity of the engine a trace was recorded on
+struct TraceFileHeader {
+    DeviceRole role = DeviceRole::ANY;
+    SpeedConfig speeds;
+
+    void encode(uint8_t* out) const {
+        out[0] = 'T';
+        out[1] = 'M';
+        out[2] = 'T';
+        out[3] = 'R';
+        out[4] = TRACE_FILE_VERSION;
+        out[5] = static_cast<uint8_t>(role);
+        out[6] = 0;
+        out[7] = 0;
+        out[8] = speeds.mask1;
+        out[9] = speeds.mask2;
+        out[10] = speeds.cert1;
+        out[11] = speeds.cert2;
+    }
+
+    // false unless the data starts with a header of a known version
+    bool decode(const uint8_t* data, size_t length) {
+        if (length < TRACE_FILE_HEADER_LENGTH || memcmp(data, "TMTR", 4) != 0) return false;
+        if (data[4] != TRACE_FILE_VERSION || data[5] > static_cast<uint8_t>(DeviceRole::ANY)) return false;
+        role = static_cast<DeviceRole>(data[5]);
+        speeds.mask1 = data[8];
+        speeds.mask2 = data[9];
+        speeds.cert1 = data[10];
+        speeds.cert2 = data[11];
+        return true;
+    }
+};
+
+// One record; data points into the trace and is valid as long as it is
+struct TraceRecord {
+    TraceRecordType type = TraceRecordType::RX;
+    uint32_t micros = 0;
+    const uint8_t* data = nullptr;
+    uint8_t length = 0;
+};
+
+/**
+ * Walks the records of a trace in memory without copying
+ * Accepts a trace file (header first) or a bare record stream, which must
+ * start at the recorder's first record since timestamps are deltas.
+ */
+class TraceReader {
+public:
+    TraceReader(const uint8_t* data, size_t length) : data_(data), length_(length) {
+        hasHeader_ = header_.decode(data, length);
+        if (hasHeader_) position_ = TRACE_FILE_HEADER_LENGTH;
+    }
+
+    bool hasHeader() const { return hasHeader_; }
+    const TraceFileHeader& header() const { return header_; }
+
+    bool next(TraceRecord& record) {
+        const uint8_t* p = data_ + position_;
+        size_t available = length_ - position_;
+        if (available < 3) return false;
+
+        // Type, varint delta to the previous record, payload length
+        uint32_t delta = 0;
+        size_t headerLength = 1;
+        for (unsigned shift = 0; ; shift += 7) {
+            if (headerLength >= available || headerLength >= TraceRecorder::MAX_HEADER_LENGTH - 1) return false;
+            uint8_t byte = p[headerLength++];
+            delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) break;
+        }
+        if (headerLength >= available) return false;
+        size_t payload = p[headerLength++];
+        if (available - headerLength < payload) return false;
+
+        micros_ += delta;
+        record.type = static_cast<TraceRecordType>(p[0]);
+        record.micros = micros_;
+        record.length = static_cast<uint8_t>(payload);
+        record.data = p + headerLength;
+        position_ += headerLength + payload;
+        return true;
+    }
+
+    // Bytes after the last whole record, e.g. a capture cut short
+    size_t trailingBytes() const {
+        TraceReader rest = *this;
+        TraceRecord record;
+        while (rest.next(record)) {}
+        return rest.length_ - rest.position_;
+    }
+
+    void rewind() {
+        position_ = hasHeader_ ? TRACE_FILE_HEADER_LENGTH : 0;
+        micros_ = 0;
+    }
+
+private:
+    const uint8_t* data_;
+    size_t length_;
+    size_t position_ = 0;
+    uint32_t micros_ = 0;
+    bool hasHeader_ = false;
+    TraceFileHeader header_;
+};
+
+#if TURBOMIDI_HAS_TRACE_FILES
+// Read-only memory map of a trace file
+class TraceFile {
+public:
+    TraceFile() {}
+    ~TraceFile() { close(); }
+
+    TraceFile(const TraceFile&) = delete;
+    TraceFile& operator=(const TraceFile&) = delete;
+
+    bool open(const char* path) {
+        close();
+        int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            lastError_ = errno;
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+            lastError_ = errno;
+            ::close(fd);
+            return false;
+        }
+        void* mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            lastError_ = errno;
+            return false;
+        }
+        data_ = static_cast<const uint8_t*>(mapped);
+        length_ = static_cast<size_t>(info.st_size);
+        lastError_ = 0;
+        return true;
+    }
+
+    void close() {
+        if (data_) munmap(const_cast<uint8_t*>(data_), length_);
+        data_ = nullptr;
+        length_ = 0;
+    }
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return length_; }
+    TraceReader reader() const { return TraceReader(data_, length_); }
+
+    // errno of the last failed operation (0 if none)
+    int lastError() const { return lastError_; }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t length_ = 0;
+    int lastError_ = 0;
+};
+
+// Saves what a TraceRecorder collects; call drain() regularly while recording
+class TraceFileWriter {
+public:
+    TraceFileWriter() {}
+    ~TraceFileWriter() { close(); }
+
+    TraceFileWriter(const TraceFileWriter&) = delete;
+    TraceFileWriter& operator=(const TraceFileWriter&) = delete;
+
+    template <typename Engine>
+    bool open(const char* path, const Engine& engine) {
+        TraceFileHeader header;
+        header.role = engine.getRole();
+        header.speeds = engine.getSupportedSpeeds();
+        return open(path, header);
+    }
+
+    bool open(const char* path, const TraceFileHeader& header) {
+        close();
+        fd_ = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            lastError_ = errno;
+            return false;
+        }
+        uint8_t encoded[TRACE_FILE_HEADER_LENGTH];
+        header.encode(encoded);
+        lastError_ = 0;
+        return writeAll(encoded, sizeof(encoded));
+    }
+
+    // Move everything queued in the ring to the file, straight from the ring
+    size_t drain(SpscByteRing& ring) {
+        size_t total = 0;
+        const uint8_t* region;
+        size_t length;
+        while (fd_ >= 0 && (length = ring.peek(region)) > 0) {
+            if (!writeAll(region, length)) break;
+            ring.consume(length);
+            total += length;
+        }
+        return total;
+    }
+
+    void close() {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+    }
+
+    bool isOpen() const { return fd_ >= 0; }
+    int lastError() const { return lastError_; }
+
+private:
+    int fd_ = -1;
+    int lastError_ = 0;
+
+    bool writeAll(const uint8_t* data, size_t length) {
+        while (length > 0) {
+            ssize_t written = ::write(fd_, data, length);
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) {
+                lastError_ = errno;
+                return false;
+            }
+            data += written;
+            length -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+};
+#endif
+
+/**
+ * Platform a trace is replayed on
+ *
+ * The clock only moves when replayTrace() reaches the next record. Received
+ * data is handed to the engine in place, in the chunks it was recorded in;
+ * sent bytes are collected for comparison with the recorded ones.
+ */
+class ReplayPlatform : public IPlatform {
+public:
+    std::vector<uint8_t> sent;
+    uint32_t baudRate = MIDI_BAUD_RATE;
+
+    void sendMidiData(const uint8_t* data, size_t length) override {
+        sent.insert(sent.end(), data, data + length);
+    }
+
+    size_t receiveMidiData(uint8_t* buffer, size_t maxLength) override {
+        size_t count = detail::minOf(maxLength, rxLength_);
+        if (count > 0) memcpy(buffer, rxData_, count);
+        consumeMidiData(count);
+        return count;
+    }
+
+    size_t peekMidiData(const uint8_t*& data) override {
+        data = rxData_;
+        return rxLength_;
+    }
+
+    void consumeMidiData(size_t count) override {
+        rxData_ += count;
+        rxLength_ -= count;
+    }
+
+    uint32_t getMillis() override { return static_cast<uint32_t>(micros_ / 1000u); }
+    uint32_t getMicros() override { return static_cast<uint32_t>(micros_); }
+    void setBaudRate(uint32_t rate) override { baudRate = rate; }
+    void delayMs(uint32_t ms) override { micros_ += static_cast<uint64_t>(ms) * 1000u; }
+    void delayMicros(uint32_t micros) override { micros_ += micros; }
+
+    // Move the clock to a recorded timestamp; never backwards
+    void advanceTo(uint32_t micros) {
+        int32_t delta = static_cast<int32_t>(micros - static_cast<uint32_t>(micros_));
+        if (delta > 0) micros_ += static_cast<uint64_t>(delta);
+    }
+
+    void startAt(uint32_t micros) { micros_ = micros; }
+
+    void feed(const uint8_t* data, size_t length) {
+        rxData_ = data;
+        rxLength_ = length;
+    }
+
+private:
+    uint64_t micros_ = 0;
+    const uint8_t* rxData_ = nullptr;
+    size_t rxLength_ = 0;
+};
+
+struct TraceReplayResult {
+    uint32_t records = 0;
+    uint32_t rxBytes = 0;
+    uint32_t recordedTxBytes = 0;
+    uint32_t replayedTxBytes = 0;
+    uint32_t dataTxBytes = 0;                 // Recorded application bytes; not replayed
+    uint32_t baudChanges = 0;
+    uint32_t stateChanges = 0;
+    uint32_t calls = 0;
+    uint32_t spanMicros = 0;                  // Recorded time from the first to the last record
+    size_t firstTxMismatch = SIZE_MAX;        // Offset where replayed and recorded TX diverge, SIZE_MAX if they match
+
+    bool txMatches() const { return firstTxMismatch == SIZE_MAX; }
+};
+
+// Configure an engine like the one the trace header describes
+template <typename Engine>
+void configureFromTrace(Engine& engine, const TraceFileHeader& header) {
+    for (uint8_t s = static_cast<uint8_t>(SpeedMultiplier::SPEED_1X); s <= static_cast<uint8_t>(SpeedMultiplier::SPEED_20X); ++s) {
+        SpeedMultiplier speed = static_cast<SpeedMultiplier>(s);
+        if (header.speeds.hasSpeed(speed)) engine.setSupportedSpeed(speed, header.speeds.isCertified(speed));
+    }
+}
+
+/**
+ * Run a trace through an engine attached to `platform`
+ *
+ * Received chunks are parsed at their recorded times, the engine is polled
+ * at every other record so its timers fire when they did, and recorded
+ * application calls (negotiations, pushes, cancels) are issued again.
+ * Protocol output is compared with the recorded TX records; application
+ * data (TX_DATA) only appears in the recording. The engine should be
+ * configured like the recording one, e.g. with configureFromTrace().
+ */
+template <typename Engine>
+TraceReplayResult replayTrace(Engine& engine, ReplayPlatform& platform, TraceReader reader) {
+    TraceReplayResult result;
+    std::vector<uint8_t> recordedTx;
+    TraceRecord record;
+    bool first = true;
+    uint32_t start = 0;
+
+    while (reader.next(record)) {
+        if (first) {
+            platform.startAt(record.micros);
+            start = record.micros;
+            first = false;
+        }
+        platform.advanceTo(record.micros);
+        result.spanMicros = record.micros - start;
+        ++result.records;
+
+        switch (record.type) {
+            case TraceRecordType::RX:
+                platform.feed(record.data, record.length);
+                result.rxBytes += record.length;
+                break;
+            case TraceRecordType::TX:
+                recordedTx.insert(recordedTx.end(), record.data, record.data + record.length);
+                break;
+            case TraceRecordType::TX_DATA:
+                result.dataTxBytes += record.length;
+                break;
+            case TraceRecordType::BAUD:
+                ++result.baudChanges;
+                break;
+            case TraceRecordType::STATE:
+                ++result.stateChanges;
+                break;
+            case TraceRecordType::CALL:
+                if (record.length == 4) {
+                    ++result.calls;
+                    uint32_t timeout = static_cast<uint32_t>(record.data[2]) | (static_cast<uint32_t>(record.data[3]) << 8);
+                    switch (static_cast<TraceCall>(record.data[0])) {
+                        case TraceCall::NEGOTIATE:
+                            engine.beginNegotiation(static_cast<SpeedMultiplier>(record.data[1]), timeout);
+                            break;
+                        case TraceCall::NEGOTIATE_BEST:
+                            engine.beginBestNegotiation(timeout);
+                            break;
+                        case TraceCall::PUSH_SPEED:
+                            engine.pushSpeed(static_cast<SpeedMultiplier>(record.data[1]));
+                            break;
+                        case TraceCall::CANCEL:
+                            engine.cancelNegotiation();
+                            break;
+                    }
+                }
+                break;
+        }
+        engine.handleIncomingData();
+    }
+
+    result.recordedTxBytes = static_cast<uint32_t>(recordedTx.size());
+    result.replayedTxBytes = static_cast<uint32_t>(platform.sent.size());
+    size_t common = detail::minOf(recordedTx.size(), platform.sent.size());
+    for (size_t i = 0; i < common; ++i) {
+        if (recordedTx[i] != platform.sent[i]) {
+            result.firstTxMismatch = i;
+            break;
+        }
+    }
+    if (result.txMatches() && recordedTx.size() != platform.sent.size()) result.firstTxMismatch = common;
+    return result;
+}
+
+} // namespace TurboMIDI
+
+#endif // TURBOMIDI_TRACE_HPP
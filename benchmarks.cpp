@@ -0,0 +1,477 @@
+/**
+ * @file benchmarks.cpp
+ * @brief Performance benchmarks for TurboMIDI library
+ *
+ * Compile with: g++ -std=c++11 -O2 benchmarks.cpp -o benchmarks
+ * Run: ./benchmarks [output.json]
+ *
+ * Results are written as JSON (to stdout, or to the given file) so CI can
+ * track them over time. Every benchmark also reports the number of heap
+ * allocations per operation, counted with a replaced global operator new.
+ * Negotiation latency is measured in virtual time on a loopback link; dumps
+ * and the noisy-link soak run on the byte-timed SimulatedLink.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+#include "TurboMidi.hpp"
+#include "TurboMidiSim.hpp"
+#include "TurboMidiTrace.hpp"
+
+// Allocation counting
+static size_t allocationCount = 0;
+
+void* operator new(size_t size) {
+    ++allocationCount;
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+// Keeps results observable so the optimizer cannot drop the measured work
+static volatile uint32_t sink = 0;
+
+// Mock platform with fixed-size buffers, so the platform itself never allocates
+class BenchPlatform : public TurboMIDI::IPlatform {
+public:
+    static constexpr size_t RX_CAPACITY = 4096;
+
+    BenchPlatform* peer = nullptr;     // Loopback: sent bytes go to the peer's receive buffer
+    uint32_t* clock = nullptr;         // Shared virtual clock (own clock if null)
+    std::function<void()> onDelay;     // Runs the other side while this side waits
+    const uint8_t* source = nullptr;   // Streaming input for throughput runs
+    size_t sourceLength = 0;
+    size_t sourcePos = 0;
+    size_t txBytes = 0;
+    bool inPlace = false;              // Expose the source through peekMidiData()
+
+    void sendMidiData(const uint8_t* data, size_t length) override {
+        txBytes += length;
+        if (!peer) return;
+        for (size_t i = 0; i < length; ++i) {
+            peer->rx_[peer->rxHead_++ % RX_CAPACITY] = data[i];
+        }
+    }
+
+    size_t receiveMidiData(uint8_t* buffer, size_t maxLength) override {
+        size_t count = 0;
+        while (count < maxLength && rxTail_ != rxHead_) {
+            buffer[count++] = rx_[rxTail_++ % RX_CAPACITY];
+        }
+        while (count < maxLength && sourcePos < sourceLength) {
+            buffer[count++] = source[sourcePos++];
+        }
+        return count;
+    }
+
+    size_t peekMidiData(const uint8_t*& data) override {
+        if (!inPlace || rxTail_ != rxHead_) return 0;
+        data = source + sourcePos;
+        return std::min<size_t>(sourceLength - sourcePos, 256);
+    }
+    
+    void consumeMidiData(size_t count) override {
+        sourcePos += count;
+    }
+    
+    uint32_t getMillis() override {
+        return clock ? *clock : ownClock_;
+    }
+
+    void setBaudRate(uint32_t) override {}
+
+    void delayMs(uint32_t ms) override {
+        if (clock) *clock += ms; else ownClock_ += ms;
+        if (onDelay) onDelay();
+    }
+
+    void feed(const std::vector<uint8_t>& data) {
+        source = data.data();
+        sourceLength = data.size();
+        sourcePos = 0;
+    }
+
+    bool drained() const {
+        return sourcePos >= sourceLength && rxTail_ == rxHead_;
+    }
+
+private:
+    uint8_t rx_[RX_CAPACITY];
+    size_t rxHead_ = 0;
+    size_t rxTail_ = 0;
+    uint32_t ownClock_ = 0;
+};
+
+// Result collection and JSON output
+struct BenchResult {
+    std::string name;
+    std::string unit;
+    double value;
+    double allocationsPerOp;
+};
+
+class BenchReport {
+public:
+    void add(const std::string& name, const std::string& unit, double value, double allocationsPerOp) {
+        BenchResult result = {name, unit, value, allocationsPerOp};
+        results_.push_back(result);
+        std::fprintf(stderr, "%-36s %14.2f %-10s %8.2f allocs/op\n",
+                     name.c_str(), value, unit.c_str(), allocationsPerOp);
+    }
+
+    void write(FILE* out) const {
+        std::fprintf(out, "{\n  \"library\": \"TurboMIDI\",\n  \"benchmarks\": [\n");
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const BenchResult& r = results_[i];
+            std::fprintf(out, "    {\"name\": \"%s\", \"unit\": \"%s\", \"value\": %.3f, \"allocations_per_op\": %.3f}%s\n",
+                         r.name.c_str(), r.unit.c_str(), r.value, r.allocationsPerOp,
+                         i + 1 < results_.size() ? "," : "");
+        }
+        std::fprintf(out, "  ]\n}\n");
+    }
+
+private:
+    std::vector<BenchResult> results_;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsedNs(Clock::time_point start) {
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+}
+
+// Receive path: bytes per second through handleIncomingData()
+static void benchStream(BenchReport& report, const char* name, const std::vector<uint8_t>& stream, int passes,
+                        bool inPlace = false) {
+    BenchPlatform platform;
+    platform.inPlace = inPlace;
+    TurboMIDI::TurboMIDI turbo(&platform, TurboMIDI::DeviceRole::SLAVE);
+    uint32_t messages = 0;
+    turbo.onMidiMessage = [&messages](const TurboMIDI::MidiMessage& message) { messages += message.data1; };
+    turbo.onRealtime = [&messages](uint8_t byte) { messages += byte; };
+
+    size_t allocationsBefore = allocationCount;
+    Clock::time_point start = Clock::now();
+    for (int pass = 0; pass < passes; ++pass) {
+        platform.feed(stream);
+        while (!platform.drained()) {
+            turbo.handleIncomingData();
+        }
+    }
+    double ns = elapsedNs(start);
+    size_t allocations = allocationCount - allocationsBefore;
+    sink = sink + messages;
+
+    double bytes = static_cast<double>(stream.size()) * passes;
+    report.add(name, "bytes/s", bytes * 1e9 / ns, allocations / bytes);
+}
+
+static void benchReceive(BenchReport& report) {
+    const size_t streamLength = 64 * 1024;
+
+    // Notes with running status and interleaved clock
+    std::vector<uint8_t> channel;
+    while (channel.size() < streamLength) {
+        channel.push_back(0x90);
+        for (uint8_t note = 0; note < 16; ++note) {
+            channel.push_back(0x30 + note);
+            channel.push_back(note % 2 ? 0x00 : 0x64);
+        }
+        channel.push_back(0xF8);
+    }
+    benchStream(report, "receive_channel_messages", channel, 64);
+
+    // Foreign SysEx dumps (not Elektron frames) run through the assembler
+    std::vector<uint8_t> sysex;
+    while (sysex.size() < streamLength) {
+        sysex.push_back(0xF0);
+        sysex.push_back(0x43);
+        for (uint8_t i = 0; i < 24; ++i) sysex.push_back(i);
+        sysex.push_back(0xF7);
+    }
+    benchStream(report, "receive_sysex", sysex, 64);
+    
+    // Multi-kilobyte dumps, scanned in bulk for the next status byte
+    std::vector<uint8_t> dump;
+    while (dump.size() < streamLength) {
+        dump.push_back(0xF0);
+        dump.push_back(0x43);
+        for (size_t i = 0; i < 4096; ++i) dump.push_back(static_cast<uint8_t>(i & 0x7F));
+        dump.push_back(0xF7);
+    }
+    benchStream(report, "receive_sysex_dump", dump, 64);
+    benchStream(report, "receive_sysex_dump_in_place", dump, 64, true);
+
+    // Active sensing only, the idle-link case
+    std::vector<uint8_t> idle(streamLength, TurboMIDI::ACTIVE_SENSING);
+    benchStream(report, "receive_active_sensing", idle, 64);
+}
+
+// Frame encoding: nanoseconds per frame
+template <typename Encode>
+static void benchEncode(BenchReport& report, const char* name, int iterations, Encode encode) {
+    size_t allocationsBefore = allocationCount;
+    Clock::time_point start = Clock::now();
+    uint32_t total = 0;
+    for (int i = 0; i < iterations; ++i) {
+        total += encode(i);
+    }
+    double ns = elapsedNs(start);
+    size_t allocations = allocationCount - allocationsBefore;
+    sink = sink + total;
+    report.add(name, "ns/frame", ns / iterations, static_cast<double>(allocations) / iterations);
+}
+
+// Sum of all frame bytes, so every encoded byte is used
+static uint32_t frameSum(const uint8_t* frame, size_t length) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < length; ++i) sum += frame[i];
+    return sum;
+}
+
+static void benchCommandBuilder(BenchReport& report) {
+    const int iterations = 1000000;
+    TurboMIDI::SpeedConfig config;
+    config.addSpeed(TurboMIDI::SpeedMultiplier::SPEED_4X, true);
+    config.addSpeed(TurboMIDI::SpeedMultiplier::SPEED_8X, false);
+    // Read through a volatile pointer so the encoding cannot be hoisted out of the loop
+    const TurboMIDI::SpeedConfig* volatile configRef = &config;
+
+    benchEncode(report, "encode_speed_answer", iterations, [&configRef](int) {
+        uint8_t frame[TurboMIDI::SPEED_ANSWER_LENGTH];
+        return frameSum(frame, TurboMIDI::CommandBuilder::encodeSpeedAnswer(frame, *configRef));
+    });
+    benchEncode(report, "encode_speed_neg", iterations, [](int i) {
+        uint8_t frame[TurboMIDI::SPEED_NEG_LENGTH];
+        return frameSum(frame, TurboMIDI::CommandBuilder::encodeSpeedNeg(
+            frame, static_cast<TurboMIDI::SpeedMultiplier>(i & 0x0F), TurboMIDI::SpeedMultiplier::SPEED_4X));
+    });
+    benchEncode(report, "build_speed_answer_vector", iterations, [&configRef](int) {
+        std::vector<uint8_t> frame = TurboMIDI::CommandBuilder::buildSpeedAnswer(*configRef);
+        return frameSum(frame.data(), frame.size());
+    });
+    benchEncode(report, "build_speed_neg_vector", iterations, [](int i) {
+        std::vector<uint8_t> frame = TurboMIDI::CommandBuilder::buildSpeedNeg(
+            static_cast<TurboMIDI::SpeedMultiplier>(i & 0x0F), TurboMIDI::SpeedMultiplier::SPEED_4X);
+        return frameSum(frame.data(), frame.size());
+    });
+}
+
+// End-to-end negotiation between two TurboMIDI instances on a loopback link
+static void benchNegotiation(BenchReport& report, const char* name, bool certified, int iterations) {
+    uint32_t clock = 0;
+    BenchPlatform masterPlatform;
+    BenchPlatform slavePlatform;
+    masterPlatform.peer = &slavePlatform;
+    slavePlatform.peer = &masterPlatform;
+    masterPlatform.clock = &clock;
+    slavePlatform.clock = &clock;
+
+    TurboMIDI::TurboMIDI master(&masterPlatform, TurboMIDI::DeviceRole::MASTER);
+    TurboMIDI::TurboMIDI slave(&slavePlatform, TurboMIDI::DeviceRole::SLAVE);
+    master.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_4X, certified);
+    slave.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_4X, certified);
+    slave.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_5X, certified);
+    masterPlatform.onDelay = [&slave]() { slave.handleIncomingData(); };
+
+    int succeeded = 0;
+    uint32_t virtualMs = 0;
+    double wallNs = 0;
+    size_t allocations = 0;
+    for (int i = 0; i < iterations; ++i) {
+        // Let the link settle at 1x between runs
+        clock += 1000;
+        master.handleIncomingData();
+        slave.handleIncomingData();
+
+        uint32_t startMs = clock;
+        size_t allocationsBefore = allocationCount;
+        Clock::time_point start = Clock::now();
+        if (master.negotiateSpeed(TurboMIDI::SpeedMultiplier::SPEED_4X)) ++succeeded;
+        wallNs += elapsedNs(start);
+        allocations += allocationCount - allocationsBefore;
+        virtualMs += clock - startMs;
+    }
+
+    std::string prefix = name;
+    report.add(prefix + "_virtual_latency", "ms", static_cast<double>(virtualMs) / iterations,
+               static_cast<double>(allocations) / iterations);
+    report.add(prefix + "_wall_time", "ns", wallNs / iterations,
+               static_cast<double>(allocations) / iterations);
+    report.add(prefix + "_success_rate", "ratio", static_cast<double>(succeeded) / iterations, 0.0);
+}
+
+// 100 KB SysEx dump at 20x on a simulated wire: CPU time per simulated dump
+static void benchSimulatedDump(BenchReport& report, int iterations) {
+    std::vector<uint8_t> dump(100 * 1024, 0x11);
+    dump.front() = TurboMIDI::SYSEX_START;
+    dump.back() = TurboMIDI::SYSEX_END;
+    
+    double wallNs = 0;
+    uint64_t virtualNs = 0;
+    size_t allocations = 0;
+    for (int i = 0; i < iterations; ++i) {
+        TurboMIDI::SimulatedLink link;
+        TurboMIDI::TurboMIDI sender(&link.a(), TurboMIDI::DeviceRole::MASTER);
+        TurboMIDI::TurboMIDI receiver(&link.b(), TurboMIDI::DeviceRole::SLAVE);
+        sender.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_20X, true);
+        receiver.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_20X, true);
+        size_t received = 0;
+        bool complete = false;
+        receiver.onSysExChunk = [&received](const uint8_t*, size_t length) { received += length; };
+        receiver.onSysExEnd = [&complete](bool ok) { complete = ok; };
+        link.a().service = [&sender]() { sender.handleIncomingData(); };
+        link.b().service = [&receiver]() { receiver.handleIncomingData(); };
+        sender.negotiateSpeed(TurboMIDI::SpeedMultiplier::SPEED_20X);
+        received = 0;      // The negotiation frames were SysEx too
+        complete = false;
+        
+        uint64_t startVirtual = link.nowNanos();
+        size_t allocationsBefore = allocationCount;
+        Clock::time_point start = Clock::now();
+        sender.beginSysExSend(dump.data(), dump.size());
+        link.runUntil([&complete]() { return complete; }, 10000000);
+        wallNs += elapsedNs(start);
+        allocations += allocationCount - allocationsBefore;
+        virtualNs += link.nowNanos() - startVirtual;
+        sink = sink + static_cast<uint32_t>(received);
+    }
+    
+    report.add("sim_dump_100k_20x_wall_time", "ns", wallNs / iterations,
+               static_cast<double>(allocations) / iterations);
+    report.add("sim_dump_100k_20x_virtual_time", "ms", virtualNs / 1e6 / iterations, 0.0);
+}
+
+// Hot-plug bring-up: a tested 8x negotiation on a clean simulated wire
+static void benchSimulatedBringUp(BenchReport& report, uint32_t breathingMs, const char* name) {
+    TurboMIDI::SimulatedLink link;
+    TurboMIDI::TurboMIDI master(&link.a(), TurboMIDI::DeviceRole::MASTER);
+    TurboMIDI::TurboMIDI slave(&link.b(), TurboMIDI::DeviceRole::SLAVE);
+    master.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_8X, false);
+    slave.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_8X, false);
+    slave.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_10X, false);
+    master.setBreathingTime(breathingMs);
+    link.b().service = [&slave]() { slave.handleIncomingData(); };
+    bool ok = master.negotiateSpeed(TurboMIDI::SpeedMultiplier::SPEED_8X);
+    
+    const TurboMIDI::NegotiationTiming& timing = master.getNegotiationTiming();
+    std::string prefix = name;
+    report.add(prefix + "_virtual_time", "ms", ok ? timing.total / 1000.0 : 0.0, 0.0);
+    report.add(prefix + "_test_round_trips", "ms", (timing.result + timing.result2) / 1000.0, 0.0);
+}
+
+// Tested 8x negotiations on a wire with bit errors
+static void benchNoisySoak(BenchReport& report, double bitErrorRate, const char* name, int iterations) {
+    int succeeded = 0;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        TurboMIDI::SimLinkConfig config;
+        config.bitErrorRate = bitErrorRate;
+        config.seed = static_cast<uint32_t>(i + 1);
+        TurboMIDI::SimulatedLink link(config);
+        TurboMIDI::TurboMIDI master(&link.a(), TurboMIDI::DeviceRole::MASTER);
+        TurboMIDI::TurboMIDI slave(&link.b(), TurboMIDI::DeviceRole::SLAVE);
+        master.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_8X, false);
+        slave.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_8X, false);
+        slave.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_10X, false);
+        link.b().service = [&slave]() { slave.handleIncomingData(); };
+        if (master.negotiateSpeed(TurboMIDI::SpeedMultiplier::SPEED_8X)) ++succeeded;
+    }
+    double wallNs = elapsedNs(start);
+    
+    std::string prefix = name;
+    report.add(prefix + "_success_rate", "ratio", static_cast<double>(succeeded) / iterations, 0.0);
+    report.add(prefix + "_wall_time", "ns", wallNs / iterations, 0.0);
+}
+
+// Replay of a recorded slave trace (20x negotiation and a 100 KB dump)
+static void benchTraceReplay(BenchReport& report, int passes) {
+    static TurboMIDI::SpscRing<262144> ring;
+    TurboMIDI::TraceRecorder recorder(ring);
+    {
+        TurboMIDI::SimulatedLink link;
+        TurboMIDI::TurboMIDI sender(&link.a(), TurboMIDI::DeviceRole::MASTER);
+        TurboMIDI::TurboMIDI receiver(&link.b(), TurboMIDI::DeviceRole::SLAVE);
+        sender.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_20X, true);
+        receiver.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_20X, true);
+        receiver.attachTraceRecorder(&recorder);
+        link.a().service = [&sender]() { sender.handleIncomingData(); };
+        link.b().service = [&receiver]() { receiver.handleIncomingData(); };
+        sender.negotiateSpeed(TurboMIDI::SpeedMultiplier::SPEED_20X);
+        
+        std::vector<uint8_t> dump(100 * 1024, 0x11);
+        dump.front() = TurboMIDI::SYSEX_START;
+        dump.back() = TurboMIDI::SYSEX_END;
+        // The sender hands the dump over before the wire has carried it; wait for the receiver
+        bool received = false;
+        receiver.onSysExEnd = [&received](bool) { received = true; };
+        sender.beginSysExSend(dump.data(), dump.size());
+        link.runUntil([&received]() { return received; }, 10000000);
+        link.advance(1000);
+    }
+    std::vector<uint8_t> trace(ring.size());
+    ring.read(trace.data(), trace.size());
+    
+    double wallNs = 0;
+    size_t allocations = 0;
+    uint32_t rxBytes = 0;
+    bool matches = true;
+    for (int pass = 0; pass < passes; ++pass) {
+        TurboMIDI::ReplayPlatform platform;
+        TurboMIDI::TurboMIDI replay(&platform, TurboMIDI::DeviceRole::SLAVE);
+        replay.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_20X, true);
+        size_t allocationsBefore = allocationCount;
+        Clock::time_point start = Clock::now();
+        TurboMIDI::TraceReplayResult result =
+            TurboMIDI::replayTrace(replay, platform, TurboMIDI::TraceReader(trace.data(), trace.size()));
+        wallNs += elapsedNs(start);
+        allocations += allocationCount - allocationsBefore;
+        rxBytes = result.rxBytes;
+        matches = matches && result.txMatches();
+    }
+    
+    double bytes = static_cast<double>(rxBytes) * passes;
+    report.add("trace_replay_slave_20x", "bytes/s", bytes * 1e9 / wallNs, allocations / bytes);
+    report.add("trace_replay_slave_20x_tx_match", "ratio", matches ? 1.0 : 0.0, 0.0);
+    report.add("trace_size_per_rx_byte", "ratio", static_cast<double>(trace.size()) / rxBytes, 0.0);
+}
+
+int main(int argc, char** argv) {
+    BenchReport report;
+
+    benchReceive(report);
+    benchCommandBuilder(report);
+    benchNegotiation(report, "negotiate_certified_4x", true, 1000);
+    benchNegotiation(report, "negotiate_tested_4x", false, 1000);
+    benchSimulatedDump(report, 10);
+    benchSimulatedBringUp(report, 10, "sim_bring_up_8x");
+    benchSimulatedBringUp(report, 1, "sim_bring_up_8x_short_breathing");
+    benchNoisySoak(report, 1e-4, "sim_soak_ber_1e-4", 500);
+    benchNoisySoak(report, 1e-3, "sim_soak_ber_1e-3", 500);
+    benchTraceReplay(report, 20);
+
+    FILE* out = stdout;
+    if (argc > 1) {
+        out = std::fopen(argv[1], "w");
+        if (!out) {
+            std::fprintf(stderr, "Cannot open %s\n", argv[1]);
+            return 1;
+        }
+    }
+    report.write(out);
+    if (out != stdout) std::fclose(out);
+
+    return 0;
+}
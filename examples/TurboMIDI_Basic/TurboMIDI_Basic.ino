@@ -67,6 +67,7 @@ void loop() {
     // Send MIDI Note On (middle C)
     uint8_t noteOn[] = {0x90, 60, 127};
     turboMidi.sendMidiData(noteOn, 3);
+    turboMidi.flush();  // Send now instead of on the next update()
     
     delay(100);
     
@@ -73,6 +73,19 @@ void setup() {
     digitalWrite(LED_YELLOW, LOW);
   });
   
+  // Example: Echo received notes with velocity reduced by half.
+  // update() parses the stream (including running status), so there is
+  // no need to read the serial port a second time.
+  turboMidi.onMidiMessage([](const MidiMessage& msg) {
+    lastMidiActivity = millis();
+    digitalWrite(LED_YELLOW, HIGH);
+    
+    if (msg.type() == 0x90) {
+      uint8_t noteOn[] = {msg.status, msg.data1, static_cast<uint8_t>(msg.data2 / 2)};
+      turboMidi.sendMidiData(noteOn, 3);
+    }
+  });
+  
   // Green LED on to show ready
   digitalWrite(LED_GREEN, HIGH);
 }
@@ -81,44 +94,10 @@ void loop() {
   // Process TurboMIDI protocol
   turboMidi.update();
   
-  // Process any incoming MIDI data
-  if (turboMidi.available() > 0) {
-    lastMidiActivity = millis();
-    digitalWrite(LED_YELLOW, HIGH);
-  }
-  
   // Turn off activity LED after a short time
   if (millis() - lastMidiActivity > 50) {
     digitalWrite(LED_YELLOW, LOW);
   }
-  
-  // Example: Echo received MIDI data with modification
-  static uint8_t midiBuffer[3];
-  static uint8_t bufferIndex = 0;
-  
-  while (turboMidi.available() > 0) {
-    // This is a simplified MIDI echo - real implementation
-    // would need proper MIDI parsing
-    uint8_t byte = Serial.read();
-    
-    // Simple MIDI message detection (very basic)
-    if (byte & 0x80) {
-      // Status byte
-      bufferIndex = 0;
-      midiBuffer[bufferIndex++] = byte;
-    } else if (bufferIndex > 0 && bufferIndex < 3) {
-      // Data byte
-      midiBuffer[bufferIndex++] = byte;
-      
-      // Check if we have a complete 3-byte message
-      if (bufferIndex == 3 && (midiBuffer[0] & 0xF0) == 0x90) {
-        // Note on - echo with velocity reduced by half
-        midiBuffer[2] = midiBuffer[2] / 2;
-        turboMidi.sendMidiData(midiBuffer, 3);
-        bufferIndex = 0;
-      }
-    }
-  }
 }
 
 void configureSupportedSpeeds() {
@@ -0,0 +1,99 @@
+/**
+ * @file footprint.cpp
+ * @brief Code and RAM size of the TurboMIDI build configurations
+ *
+ * Every configuration is linked into its own binary, so `size` reports its
+ * code (text) and the engine object shows up in bss:
+ *
+ *   for c in 1 2 3 4; do
+ *     g++ -std=c++11 -Os -DTURBOMIDI_MINIMAL=1 -DFOOTPRINT_CONFIG=$c footprint.cpp -o footprint_$c
+ *     size footprint_$c && ./footprint_$c
+ *   done
+ *
+ * For the real target use avr-g++ -std=c++11 -Os -mmcu=atmega328p and
+ * avr-size; data + bss is the RAM the library takes.
+ *
+ * FOOTPRINT_CONFIG:
+ *   1  TurboMIDISlave<StaticCallbacks<...>>  slave only, inlined callbacks
+ *   2  TurboMIDIMaster<StaticCallbacks<...>> master only, inlined callbacks
+ *   3  BasicTurboMIDI<RuntimeRole, PointerCallbacks> master and slave
+ *   4  TurboMIDI                             master and slave, Callback members
+ */
+
+#include "TurboMidi.hpp"
+
+#if TURBOMIDI_MINIMAL && (defined(_GLIBCXX_VECTOR) || defined(_GLIBCXX_FUNCTIONAL) || \
+                          defined(_LIBCPP_VECTOR) || defined(_LIBCPP_FUNCTIONAL))
+#error "TURBOMIDI_MINIMAL must not pull in <vector> or <functional>"
+#endif
+
+#if !defined(__AVR__)
+#include <stdio.h>
+#endif
+
+#ifndef FOOTPRINT_CONFIG
+#define FOOTPRINT_CONFIG 1
+#endif
+
+using namespace TurboMIDI;
+
+// UART stand-in; volatile accesses keep the calls from being optimized away
+class NullPlatform : public IPlatform {
+public:
+    volatile uint8_t line = 0;
+    volatile uint32_t clock = 0;
+
+    void sendMidiData(const uint8_t* data, size_t length) override {
+        for (size_t i = 0; i < length; ++i) line = data[i];
+    }
+
+    size_t receiveMidiData(uint8_t* buffer, size_t maxLength) override {
+        if (maxLength == 0 || line == 0) return 0;
+        buffer[0] = line;
+        return 1;
+    }
+
+    uint32_t getMillis() override { return clock; }
+    void setBaudRate(uint32_t baudRate) override { line = static_cast<uint8_t>(baudRate); }
+    void delayMs(uint32_t ms) override { clock = clock + ms; }
+};
+
+struct Handler : NoCallbacks {
+    static volatile uint8_t last;
+    static void onMidiMessage(const MidiMessage& message) { last = message.status; }
+    static void onSpeedChanged(SpeedMultiplier speed) { last = static_cast<uint8_t>(speed); }
+};
+volatile uint8_t Handler::last = 0;
+
+#if FOOTPRINT_CONFIG == 1
+typedef TurboMIDISlave<StaticCallbacks<Handler> > Engine;
+static const char* const CONFIG_NAME = "slave, static callbacks";
+#elif FOOTPRINT_CONFIG == 2
+typedef TurboMIDIMaster<StaticCallbacks<Handler> > Engine;
+static const char* const CONFIG_NAME = "master, static callbacks";
+#elif FOOTPRINT_CONFIG == 3
+typedef BasicTurboMIDI<RuntimeRole, PointerCallbacks> Engine;
+static const char* const CONFIG_NAME = "runtime role, pointer callbacks";
+#else
+typedef TurboMIDI::TurboMIDI Engine;
+static const char* const CONFIG_NAME = "TurboMIDI";
+#endif
+
+static NullPlatform platform;
+static Engine engine(&platform, DeviceRole::ANY);
+
+int main() {
+    engine.setSupportedSpeed(SpeedMultiplier::SPEED_4X, true);
+#if FOOTPRINT_CONFIG != 1
+    engine.beginNegotiation(SpeedMultiplier::SPEED_4X);
+#endif
+    for (int i = 0; i < 3; ++i) engine.handleIncomingData();
+
+#if !defined(__AVR__)
+    printf("%-34s minimal=%d engine=%u bytes platform=%u bytes\n", CONFIG_NAME, TURBOMIDI_MINIMAL,
+           static_cast<unsigned>(sizeof(Engine)), static_cast<unsigned>(sizeof(NullPlatform)));
+#else
+    (void)CONFIG_NAME;
+#endif
+    return 0;
+}
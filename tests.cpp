@@ -10,7 +10,22 @@
 #include <cstring>
 #include <queue>
 #include <algorithm>
+
+#define TURBOMIDI_ENABLE_STATS 1
 #include "TurboMidi.hpp"
+#include "TurboMidiHub.hpp"
+#include "TurboMidiSim.hpp"
+#include "TurboMidiTrace.hpp"
+#if TURBOMIDI_HAS_THREADS
+#include "TurboMidiThreaded.hpp"
+#endif
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <stdlib.h>
+#include "TurboMidiPosix.hpp"
+#define TURBOMIDI_TEST_POSIX 1
+#endif
 
 // Test framework
 class TestFramework {
@@ -150,6 +165,73 @@ void testCommandBuilders(TestFramework& test) {
     test.endTest();
 }
 
+void testFrameEncoders(TestFramework& test) {
+    static_assert(TurboMIDI::SPEED_REQ_FRAME.size() == 8, "SPEED_REQ frame should be 8 bytes");
+    static_assert(TurboMIDI::SPEED_TEST_FRAME.size() == TurboMIDI::MAX_COMMAND_LENGTH,
+                  "SPEED_TEST should be the longest frame");
+    
+    test.startTest("Frame Encoders - Fixed frames match builders");
+    test.verify(std::vector<uint8_t>(TurboMIDI::SPEED_ACK_FRAME.begin(), TurboMIDI::SPEED_ACK_FRAME.end()) ==
+                std::vector<uint8_t>({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x13, 0xF7}),
+                "SPEED_ACK frame incorrect");
+    test.verify(TurboMIDI::CommandBuilder::buildSpeedResult() ==
+                std::vector<uint8_t>(TurboMIDI::SPEED_RESULT_FRAME.begin(), TurboMIDI::SPEED_RESULT_FRAME.end()),
+                "SPEED_RESULT builder should match the fixed frame");
+    test.endTest();
+    
+    test.startTest("Frame Encoders - Caller buffers");
+    uint8_t buffer[TurboMIDI::MAX_COMMAND_LENGTH];
+    TurboMIDI::SpeedConfig config;
+    config.mask1 = 0x7F;
+    config.cert2 = 0x04;
+    size_t length = TurboMIDI::CommandBuilder::encodeSpeedAnswer(buffer, config);
+    test.verify(length == TurboMIDI::SPEED_ANSWER_LENGTH, "SPEED_ANSWER length incorrect");
+    test.verify(std::vector<uint8_t>(buffer, buffer + length) ==
+                std::vector<uint8_t>({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x11, 0x7F, 0x00, 0x00, 0x04, 0xF7}),
+                "Encoded SPEED_ANSWER incorrect");
+    length = TurboMIDI::CommandBuilder::encodeSpeedPush(buffer, TurboMIDI::SpeedMultiplier::SPEED_20X);
+    test.verify(std::vector<uint8_t>(buffer, buffer + length) ==
+                std::vector<uint8_t>({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x20, 0x0B, 0xF7}),
+                "Encoded SPEED_PUSH incorrect");
+    test.endTest();
+}
+
+// UART divisors are usable in constant expressions
+static_assert(TurboMIDI::uartDivisor(16000000, TurboMIDI::speedBaudRate(TurboMIDI::SpeedMultiplier::SPEED_1X)) == 32,
+              "16 MHz AVR runs MIDI with divisor 32");
+static_assert(TurboMIDI::uartDivisor(16000000, 250000, 8) == 8, "U2X halves the oversampling");
+
+void testSpeedTable(TestFramework& test) {
+    test.startTest("Speed Table - Baud rates, multipliers and mask bits");
+    for (uint8_t value = 1; value < TurboMIDI::SPEED_TABLE_SIZE; ++value) {
+        TurboMIDI::SpeedMultiplier speed = static_cast<TurboMIDI::SpeedMultiplier>(value);
+        const TurboMIDI::SpeedDescriptor& descriptor = TurboMIDI::speedDescriptor(speed);
+        test.verify(descriptor.baudRate * descriptor.denominator == TurboMIDI::MIDI_BAUD_RATE * descriptor.numerator,
+                    "Baud rate should be 31250 times the multiplier");
+        
+        // Every speed but 1x owns exactly one mask bit, and no two speeds share one
+        TurboMIDI::SpeedConfig config;
+        config.addSpeed(speed, true);
+        uint8_t bits = static_cast<uint8_t>(config.mask1 | config.mask2);
+        test.verify(value == 1 ? bits == 0 : (bits != 0 && (bits & (bits - 1)) == 0), "One mask bit per speed");
+        for (uint8_t other = 2; other < TurboMIDI::SPEED_TABLE_SIZE; ++other) {
+            test.verify(config.hasSpeed(static_cast<TurboMIDI::SpeedMultiplier>(other)) == (other == value),
+                        "Speeds should not share mask bits");
+        }
+    }
+    test.verify(TurboMIDI::speedMultiplierRounded(TurboMIDI::SpeedMultiplier::SPEED_6_6X) == 7, "6.6x rounds to 7");
+    test.verify(TurboMIDI::speedBaudRate(static_cast<TurboMIDI::SpeedMultiplier>(0x7F)) == 31250,
+                "Unknown speeds should fall back to 1x");
+    test.endTest();
+    
+    test.startTest("Speed Table - UART divisor and error");
+    test.verify(TurboMIDI::uartBaudErrorPercent(16000000, 250000) == 0.0, "8x is exact on 16 MHz");
+    double error = TurboMIDI::uartBaudErrorPercent(16000000, 103125);
+    test.verify(error < -3.0 && error > -3.1, "3.3x on 16 MHz is about 3% slow");
+    test.verify(TurboMIDI::uartBaudErrorPercent(1000, 625000) == -100.0, "Unreachable rates report -100%");
+    test.endTest();
+}
+
 void testSpeedConfig(TestFramework& test) {
     test.startTest("SpeedConfig - Add and check speeds");
     TurboMIDI::SpeedConfig config;
@@ -217,6 +299,123 @@ void testMasterSlaveNegotiation(TestFramework& test) {
     test.endTest();
 }
 
+void testMasterNegotiationResponses(TestFramework& test) {
+    test.startTest("Master Negotiation - Responses in a single batch");
+    
+    MockPlatform platform;
+    TurboMIDI::TurboMIDI master(&platform, TurboMIDI::DeviceRole::MASTER);
+    master.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_2X, true);
+    
+    // Slave answers with certified 2x and acknowledges; both frames arrive together
+    // with channel traffic in between
+    platform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x11, 0x01, 0x00, 0x01, 0x00, 0xF7});
+    platform.injectMessage({0x90, 0x3C, 0x7F, 0xF8});
+    platform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x13, 0xF7});
+    
+    test.verify(master.negotiateSpeed(TurboMIDI::SpeedMultiplier::SPEED_2X),
+                "Negotiation should succeed");
+    test.verify(platform.findMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x12, 0x02, 0x02, 0xF7}),
+                "Master should send SPEED_NEG without test for a certified speed");
+    test.verify(master.getCurrentSpeed() == TurboMIDI::SpeedMultiplier::SPEED_2X, "Speed should be 2x");
+    test.verify(platform.currentBaudRate == 62500, "Baud rate should be 62500");
+    
+    test.endTest();
+}
+
+void testAsyncNegotiation(TestFramework& test) {
+    test.startTest("Async Negotiation - Tested speed");
+    
+    MockPlatform platform;
+    TurboMIDI::TurboMIDI master(&platform, TurboMIDI::DeviceRole::MASTER);
+    master.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_4X, false);
+    master.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_5X, false);
+    
+    int completions = 0;
+    bool completedOk = false;
+    master.onNegotiationComplete = [&](bool success, TurboMIDI::SpeedMultiplier) {
+        completions++;
+        completedOk = success;
+    };
+    
+    test.verify(master.beginNegotiation(TurboMIDI::SpeedMultiplier::SPEED_4X), "Negotiation should start");
+    test.verify(master.getNegotiationStatus() == TurboMIDI::NegotiationStatus::IN_PROGRESS,
+                "Negotiation should be in progress");
+    test.verify(!master.beginNegotiation(TurboMIDI::SpeedMultiplier::SPEED_4X),
+                "Second negotiation should be rejected while one is running");
+    test.verify(platform.findMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x10, 0xF7}),
+                "Master should send SPEED_REQ");
+    
+    // Slave supports 4x and 5x, neither certified
+    platform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x11, 0x0C, 0x00, 0x00, 0x00, 0xF7});
+    master.handleIncomingData();
+    test.verify(platform.findMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x12, 0x05, 0x04, 0xF7}),
+                "Master should negotiate 4x with a 5x test");
+    
+    platform.clearBuffers();
+    platform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x13, 0xF7});
+    master.handleIncomingData();
+    test.verify(platform.txBuffer.size() == 16, "Master should send 16 breathing bytes");
+    test.verify(platform.currentBaudRate == 31250, "Master should stay at 1x while breathing");
+    
+    platform.currentTime += 10;
+    master.handleIncomingData();
+    test.verify(platform.currentBaudRate == 156250, "Master should switch to the 5x test speed");
+    test.verify(platform.findMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x14,
+                                     0x55, 0x55, 0x55, 0x55, 0x00, 0x00, 0x00, 0x00, 0xF7}),
+                "Master should send SPEED_TEST");
+    
+    platform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x15,
+                           0x55, 0x55, 0x55, 0x55, 0x00, 0x00, 0x00, 0x00, 0xF7});
+    master.handleIncomingData();
+    test.verify(platform.findMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x16, 0xF7}),
+                "Master should send SPEED_TEST2");
+    test.verify(completions == 0, "Negotiation should not be complete yet");
+    
+    platform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x17, 0xF7});
+    master.handleIncomingData();
+    test.verify(master.getNegotiationStatus() == TurboMIDI::NegotiationStatus::SUCCEEDED,
+                "Negotiation should succeed");
+    test.verify(completions == 1 && completedOk, "Completion callback should report success once");
+    test.verify(platform.currentBaudRate == 125000, "Master should end at 4x");
+    
+    test.endTest();
+    
+    test.startTest("Async Negotiation - Timeout");
+    MockPlatform silentPlatform;
+    TurboMIDI::TurboMIDI lonelyMaster(&silentPlatform, TurboMIDI::DeviceRole::MASTER);
+    lonelyMaster.beginNegotiation(TurboMIDI::SpeedMultiplier::SPEED_2X);
+    silentPlatform.currentTime += 29;
+    lonelyMaster.handleIncomingData();
+    test.verify(lonelyMaster.getNegotiationStatus() == TurboMIDI::NegotiationStatus::IN_PROGRESS,
+                "Negotiation should still wait before the timeout");
+    silentPlatform.currentTime += 1;
+    lonelyMaster.handleIncomingData();
+    test.verify(lonelyMaster.getNegotiationStatus() == TurboMIDI::NegotiationStatus::FAILED,
+                "Negotiation should fail after the timeout");
+    
+    TurboMIDI::TurboMIDI slave(&silentPlatform, TurboMIDI::DeviceRole::SLAVE);
+    test.verify(!slave.beginNegotiation(TurboMIDI::SpeedMultiplier::SPEED_2X), "Slave cannot negotiate");
+    test.endTest();
+    
+    test.startTest("Async Negotiation - Short breathing time");
+    MockPlatform fastPlatform;
+    TurboMIDI::TurboMIDI fastMaster(&fastPlatform, TurboMIDI::DeviceRole::MASTER);
+    fastMaster.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_4X, false);
+    fastMaster.setBreathingTime(2);
+    fastMaster.beginNegotiation(TurboMIDI::SpeedMultiplier::SPEED_4X);
+    fastPlatform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x11, 0x0C, 0x00, 0x00, 0x00, 0xF7});
+    fastMaster.handleIncomingData();
+    fastPlatform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x13, 0xF7});
+    fastMaster.handleIncomingData();
+    fastPlatform.currentTime += 1;
+    fastMaster.handleIncomingData();
+    test.verify(fastPlatform.currentBaudRate == 31250, "Master should still be breathing");
+    fastPlatform.currentTime += 1;
+    fastMaster.handleIncomingData();
+    test.verify(fastPlatform.currentBaudRate == 156250, "Master should switch after the configured breathing time");
+    test.endTest();
+}
+
 void testActiveSensing(TestFramework& test) {
     test.startTest("Active Sensing");
     
@@ -349,6 +548,510 @@ void testInvalidMessages(TestFramework& test) {
     test.endTest();
 }
 
+void testLinkStats(TestFramework& test) {
+    typedef TurboMIDI::FrameRejectReason Reason;
+    
+    test.startTest("Link Stats - Frame rejection reasons");
+    MockPlatform platform;
+    TurboMIDI::TurboMIDI slave(&platform, TurboMIDI::DeviceRole::SLAVE);
+    platform.injectMessage({0xF0, 0x00, 0x20, 0x3D, 0x00, 0x00, 0x20, 0x02, 0xF7});  // Foreign
+    platform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0xF7});                          // Too short
+    platform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x20, 0xF7});        // Truncated push
+    platform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x16, 0xF7});        // TEST2 without TEST
+    platform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x7E, 0xF7});        // Unknown
+    std::vector<uint8_t> oversized(64, 0x01);
+    oversized.front() = 0xF0;
+    oversized.back() = 0xF7;
+    platform.injectMessage(oversized);
+    slave.handleIncomingData();
+    
+    const TurboMIDI::LinkStats& stats = slave.getStats();
+    test.verify(stats.bytesIn == 9 + 5 + 8 + 8 + 8 + 64, "All received bytes should be counted");
+    test.verify(stats.framesParsed == 5, "Complete frames should be counted");
+    test.verify(stats.rejected(Reason::FOREIGN) == 1, "Foreign frame should be counted");
+    test.verify(stats.rejected(Reason::TOO_SHORT) == 1, "Short frame should be counted");
+    test.verify(stats.rejected(Reason::TRUNCATED) == 1, "Truncated push should be counted");
+    test.verify(stats.rejected(Reason::UNEXPECTED) == 1, "Out-of-order TEST2 should be counted");
+    test.verify(stats.rejected(Reason::UNKNOWN_COMMAND) == 1, "Unknown command should be counted");
+    test.verify(stats.rejected(Reason::OVERSIZED) == 1, "Oversized frame should be counted");
+    
+    slave.resetStats();
+    test.verify(slave.getStats().bytesIn == 0 && slave.getStats().framesParsed == 0, "Reset should clear counters");
+    test.endTest();
+    
+    test.startTest("Link Stats - Negotiations and timeouts");
+    MockPlatform masterPlatform;
+    TurboMIDI::TurboMIDI master(&masterPlatform, TurboMIDI::DeviceRole::MASTER);
+    master.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_4X, true);
+    
+    // Answer arrives 3 ms after the request, then the slave acknowledges
+    master.beginNegotiation(TurboMIDI::SpeedMultiplier::SPEED_4X);
+    masterPlatform.currentTime += 3;
+    masterPlatform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x11, 0x04, 0x00, 0x04, 0x00, 0xF7});
+    masterPlatform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x13, 0xF7});
+    master.handleIncomingData();
+    master.handleIncomingData();
+    
+    // A second attempt without an answer fails
+    test.verify(!master.negotiateSpeed(TurboMIDI::SpeedMultiplier::SPEED_4X), "Silent link should fail");
+    
+    const TurboMIDI::LinkStats& masterStats = master.getStats();
+    size_t index = TurboMIDI::LinkStats::speedIndex(TurboMIDI::SpeedMultiplier::SPEED_4X);
+    test.verify(masterStats.negotiationAttempts[index] == 2, "Both attempts should be counted");
+    test.verify(masterStats.negotiationSuccesses[index] == 1, "One success should be counted");
+    test.verify(masterStats.negotiationFailures[index] == 1, "One failure should be counted");
+    test.verify(masterStats.negotiationRtt[2] == 1, "3 ms round trip belongs in the [2, 4) ms bucket");
+    test.verify(masterStats.bytesOut == 8 + 10 + 8, "REQ, NEG and the second REQ should be counted");
+    
+    // Silence at 4x falls back to 1x
+    masterPlatform.currentTime += 400;
+    master.handleIncomingData();
+    test.verify(master.getCurrentSpeed() == TurboMIDI::SpeedMultiplier::SPEED_1X, "Should fall back to 1x");
+    test.verify(masterStats.activeSenseTimeouts == 1, "Fallback should be counted");
+    test.endTest();
+}
+
+// Two connected mock ports sharing a clock; bytes sent above maxBaudRate are lost
+class LoopbackPlatform : public MockPlatform {
+public:
+    LoopbackPlatform* peer = nullptr;
+    uint32_t* clock = nullptr;
+    uint32_t maxBaudRate = 1000000;
+    std::function<void()> onDelay;
+    
+    void sendMidiData(const uint8_t* data, size_t length) override {
+        MockPlatform::sendMidiData(data, length);
+        if (!peer || currentBaudRate > maxBaudRate) return;
+        for (size_t i = 0; i < length; ++i) peer->rxBuffer.push(data[i]);
+    }
+    
+    uint32_t getMillis() override { return *clock; }
+    
+    void delayMs(uint32_t ms) override {
+        *clock += ms;
+        if (onDelay) onDelay();
+    }
+};
+
+void testBestSpeedNegotiation(TestFramework& test) {
+    uint32_t clock = 0;
+    LoopbackPlatform masterPlatform;
+    LoopbackPlatform slavePlatform;
+    masterPlatform.peer = &slavePlatform;
+    slavePlatform.peer = &masterPlatform;
+    masterPlatform.clock = &clock;
+    slavePlatform.clock = &clock;
+    
+    TurboMIDI::TurboMIDI master(&masterPlatform, TurboMIDI::DeviceRole::MASTER);
+    TurboMIDI::TurboMIDI slave(&slavePlatform, TurboMIDI::DeviceRole::SLAVE);
+    masterPlatform.onDelay = [&slave]() { slave.handleIncomingData(); };
+    
+    const TurboMIDI::SpeedMultiplier speeds[] = {
+        TurboMIDI::SpeedMultiplier::SPEED_2X, TurboMIDI::SpeedMultiplier::SPEED_4X,
+        TurboMIDI::SpeedMultiplier::SPEED_5X, TurboMIDI::SpeedMultiplier::SPEED_8X,
+        TurboMIDI::SpeedMultiplier::SPEED_10X, TurboMIDI::SpeedMultiplier::SPEED_16X,
+        TurboMIDI::SpeedMultiplier::SPEED_20X
+    };
+    for (TurboMIDI::SpeedMultiplier speed : speeds) {
+        master.setSupportedSpeed(speed, true);
+        // The slave certifies 2x and 4x only
+        slave.setSupportedSpeed(speed, static_cast<uint8_t>(speed) <= static_cast<uint8_t>(TurboMIDI::SpeedMultiplier::SPEED_4X));
+    }
+    
+    test.startTest("Best Speed - Certified speed without test");
+    masterPlatform.maxBaudRate = 156250;  // Cable cannot carry the 5x test at 6.6x rate
+    int requests = 0;
+    slave.onSpeedRequest = [&requests]() { ++requests; };
+    test.verify(master.negotiateBestSpeed(), "Best-speed negotiation should succeed");
+    test.verify(master.getCurrentSpeed() == TurboMIDI::SpeedMultiplier::SPEED_4X, "Should settle at certified 4x");
+    test.verify(slave.getCurrentSpeed() == TurboMIDI::SpeedMultiplier::SPEED_4X, "Slave should follow to 4x");
+    test.verify(requests == 1, "Only one SPEED_REQ should be sent");
+    test.endTest();
+    
+    test.startTest("Best Speed - Binary search of uncertified speeds");
+    // Let both sides time out back to 1x, then widen the link
+    clock += 1000;
+    master.handleIncomingData();
+    slave.handleIncomingData();
+    masterPlatform.maxBaudRate = 320000;  // Tests up to 8x (run at the 10x rate, 312500) pass
+    slavePlatform.maxBaudRate = 320000;
+    requests = 0;
+    test.verify(master.negotiateBestSpeed(), "Best-speed negotiation should succeed");
+    test.verify(master.getCurrentSpeed() == TurboMIDI::SpeedMultiplier::SPEED_8X, "Should find 8x");
+    test.verify(slave.getCurrentSpeed() == TurboMIDI::SpeedMultiplier::SPEED_8X, "Slave should end at 8x");
+    test.verify(requests == 1, "Search should reuse the single SPEED_ANSWER");
+    test.endTest();
+    
+    test.startTest("Best Speed - Peer with only 1x");
+    MockPlatform plainPlatform;
+    TurboMIDI::TurboMIDI plainMaster(&plainPlatform, TurboMIDI::DeviceRole::MASTER);
+    plainMaster.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_4X, true);
+    plainPlatform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x11, 0x00, 0x00, 0x00, 0x00, 0xF7});
+    test.verify(!plainMaster.negotiateBestSpeed(), "No common fast speed should report failure");
+    test.verify(plainMaster.getCurrentSpeed() == TurboMIDI::SpeedMultiplier::SPEED_1X, "Should stay at 1x");
+    test.verify(plainPlatform.txBuffer.size() == 8, "Only SPEED_REQ should be sent");
+    test.endTest();
+}
+
+// In-memory persistence for PeerCache tests
+class MemoryPeerCacheStore : public TurboMIDI::IPeerCacheStore {
+public:
+    std::vector<uint8_t> data;
+    int saves = 0;
+    
+    bool load(uint8_t* out, size_t length) override {
+        if (data.size() != length) return false;
+        std::copy(data.begin(), data.end(), out);
+        return true;
+    }
+    
+    void save(const uint8_t* in, size_t length) override {
+        data.assign(in, in + length);
+        ++saves;
+    }
+};
+
+static size_t countCommands(const std::vector<uint8_t>& tx, uint8_t command) {
+    size_t count = 0;
+    for (size_t i = 0; i + 6 < tx.size(); ++i) {
+        if (tx[i] == 0xF0 && tx[i + 1] == 0x00 && tx[i + 2] == 0x20 && tx[i + 3] == 0x3C && tx[i + 6] == command) ++count;
+    }
+    return count;
+}
+
+void testPeerCache(TestFramework& test) {
+    typedef TurboMIDI::SpeedMultiplier Speed;
+    
+    test.startTest("Peer Cache - LRU replacement and persistence");
+    MemoryPeerCacheStore store;
+    TurboMIDI::PeerCache cache;
+    cache.setStore(&store);
+    TurboMIDI::SpeedConfig peers[TurboMIDI::PeerCache::CAPACITY + 1];
+    for (size_t i = 0; i < TurboMIDI::PeerCache::CAPACITY + 1; ++i) {
+        peers[i].mask1 = static_cast<uint8_t>(i + 1);
+    }
+    for (size_t i = 0; i < TurboMIDI::PeerCache::CAPACITY; ++i) {
+        cache.store(peers[i], Speed::SPEED_4X, i % 2 == 0);
+    }
+    test.verify(cache.size() == TurboMIDI::PeerCache::CAPACITY, "Cache should be full");
+    test.verify(cache.lookup(peers[0]) != nullptr, "First peer should be cached");
+    cache.store(peers[TurboMIDI::PeerCache::CAPACITY], Speed::SPEED_8X, false);
+    test.verify(cache.lookup(peers[0]) != nullptr, "Recently used peer should survive");
+    test.verify(cache.lookup(peers[1]) == nullptr, "Least recently used peer should be replaced");
+    test.verify(store.data.size() == TurboMIDI::PeerCache::STORAGE_BYTES, "Store should hold the cache image");
+    
+    TurboMIDI::PeerCache restored;
+    restored.setStore(&store);
+    const TurboMIDI::PeerCache::Entry* entry = restored.lookup(peers[TurboMIDI::PeerCache::CAPACITY]);
+    test.verify(entry && entry->speed == Speed::SPEED_8X && !entry->tested, "Entries should survive a reload");
+    test.verify(restored.lookup(peers[2]) && restored.lookup(peers[2])->tested, "Tested flag should survive a reload");
+    
+    store.data[0] ^= 0xFF;
+    TurboMIDI::PeerCache corrupt;
+    corrupt.setStore(&store);
+    test.verify(corrupt.size() == 0, "Corrupt image should be ignored");
+    test.endTest();
+    
+    test.startTest("Peer Cache - Fast reconnect skips the search");
+    uint32_t clock = 0;
+    LoopbackPlatform masterPlatform;
+    LoopbackPlatform slavePlatform;
+    masterPlatform.peer = &slavePlatform;
+    slavePlatform.peer = &masterPlatform;
+    masterPlatform.clock = &clock;
+    slavePlatform.clock = &clock;
+    masterPlatform.maxBaudRate = 320000;
+    slavePlatform.maxBaudRate = 320000;
+    
+    TurboMIDI::TurboMIDI master(&masterPlatform, TurboMIDI::DeviceRole::MASTER);
+    TurboMIDI::TurboMIDI slave(&slavePlatform, TurboMIDI::DeviceRole::SLAVE);
+    masterPlatform.onDelay = [&slave]() { slave.handleIncomingData(); };
+    const Speed speeds[] = {Speed::SPEED_4X, Speed::SPEED_5X, Speed::SPEED_8X, Speed::SPEED_10X, Speed::SPEED_16X};
+    for (Speed speed : speeds) {
+        master.setSupportedSpeed(speed, true);
+        slave.setSupportedSpeed(speed, false);
+    }
+    TurboMIDI::PeerCache linkCache;
+    master.attachPeerCache(&linkCache);
+    
+    test.verify(master.negotiateBestSpeed(), "First negotiation should succeed");
+    test.verify(master.getCurrentSpeed() == Speed::SPEED_8X, "Search should find 8x");
+    size_t searchNegs = countCommands(masterPlatform.txBuffer, 0x12);
+    test.verify(linkCache.size() == 1, "Result should be cached");
+    
+    // Replug: both sides time out to 1x, then reconnect
+    clock += 1000;
+    master.handleIncomingData();
+    slave.handleIncomingData();
+    masterPlatform.clearBuffers();
+    test.verify(master.negotiateBestSpeed(), "Reconnect should succeed");
+    test.verify(master.getCurrentSpeed() == Speed::SPEED_8X, "Reconnect should go straight to 8x");
+    test.verify(countCommands(masterPlatform.txBuffer, 0x12) == 1, "Reconnect should need a single SPEED_NEG");
+    test.verify(searchNegs > 1, "The first negotiation should have searched");
+    
+    // A worse cable invalidates the entry and falls back to the search
+    clock += 1000;
+    master.handleIncomingData();
+    slave.handleIncomingData();
+    masterPlatform.maxBaudRate = 200000;
+    slavePlatform.maxBaudRate = 200000;
+    test.verify(master.negotiateBestSpeed(), "Negotiation should still succeed");
+    test.verify(master.getCurrentSpeed() == Speed::SPEED_4X, "Search should find 4x (tested at 5x)");
+    TurboMIDI::SpeedConfig slaveConfig;
+    for (Speed speed : speeds) slaveConfig.addSpeed(speed, false);
+    const TurboMIDI::PeerCache::Entry* updated = linkCache.lookup(slaveConfig);
+    test.verify(updated && updated->speed == Speed::SPEED_4X && updated->tested, "Cache should hold the new result");
+    test.endTest();
+}
+
+// Run the master for `ms` milliseconds with the peer sending active sensing;
+// answers the first SPEED_REQ seen with the given certified speeds and an ACK
+static bool runAdaptiveLink(MockPlatform& platform, TurboMIDI::TurboMIDI& master, uint32_t ms,
+                            uint8_t answerMask = 0, bool peerAlive = true) {
+    const std::vector<uint8_t> request = {0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x10, 0xF7};
+    bool answered = false;
+    for (uint32_t t = 0; t < ms; t += 10) {
+        if (answerMask && !answered && platform.findMessage(request)) {
+            platform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x11, answerMask, 0x00, answerMask, 0x00, 0xF7});
+            platform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x13, 0xF7});
+            answered = true;
+        }
+        if (peerAlive) platform.injectMessage({TurboMIDI::ACTIVE_SENSING});
+        master.handleIncomingData();
+        platform.currentTime += 10;
+    }
+    return answered;
+}
+
+void testAdaptiveSpeed(TestFramework& test) {
+    const uint8_t remoteSpeeds = 0x2C;  // 4x, 5x and 8x, all certified
+    
+    MockPlatform platform;
+    TurboMIDI::TurboMIDI master(&platform, TurboMIDI::DeviceRole::MASTER);
+    master.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_4X, true);
+    master.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_5X, true);
+    master.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_8X, true);
+    
+    TurboMIDI::AdaptiveSpeedConfig config;
+    config.errorThreshold = 3;
+    config.probeIntervalMs = 2000;
+    test.verify(master.enableAdaptiveSpeed(TurboMIDI::SpeedMultiplier::SPEED_8X, config),
+                "Master should accept adaptive mode");
+    
+    test.startTest("Adaptive Speed - Step down on errors");
+    master.beginNegotiation(TurboMIDI::SpeedMultiplier::SPEED_8X);
+    runAdaptiveLink(platform, master, 20, remoteSpeeds);
+    test.verify(master.getCurrentSpeed() == TurboMIDI::SpeedMultiplier::SPEED_8X, "Should start at 8x");
+    
+    platform.clearBuffers();
+    master.reportLinkError();
+    master.reportLinkError();
+    test.verify(master.getCurrentSpeed() == TurboMIDI::SpeedMultiplier::SPEED_8X, "Below threshold keeps 8x");
+    master.reportLinkError();
+    test.verify(master.getCurrentSpeed() == TurboMIDI::SpeedMultiplier::SPEED_5X, "Threshold should step down to 5x");
+    test.verify(platform.findMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x20, 0x05, 0xF7}),
+                "Peer should be told through SPEED_PUSH");
+    
+    // Errors spread over several windows do not accumulate
+    for (int i = 0; i < 4; ++i) {
+        master.reportLinkError();
+        platform.currentTime += 600;
+    }
+    test.verify(master.getCurrentSpeed() == TurboMIDI::SpeedMultiplier::SPEED_5X, "Sparse errors should not step down");
+    test.endTest();
+    
+    test.startTest("Adaptive Speed - Probe upwards when clean");
+    platform.clearBuffers();
+    runAdaptiveLink(platform, master, 1000);
+    test.verify(master.getNegotiationStatus() != TurboMIDI::NegotiationStatus::IN_PROGRESS,
+                "Should not probe before the interval");
+    test.verify(runAdaptiveLink(platform, master, 1500, remoteSpeeds), "Should probe after the interval");
+    test.verify(master.getCurrentSpeed() == TurboMIDI::SpeedMultiplier::SPEED_8X, "Probe should reach 8x");
+    test.endTest();
+    
+    test.startTest("Adaptive Speed - Recover one step lower after timeout");
+    platform.clearBuffers();
+    runAdaptiveLink(platform, master, 350, 0, false);
+    test.verify(master.getCurrentSpeed() == TurboMIDI::SpeedMultiplier::SPEED_1X, "Silence should fall back to 1x");
+    test.verify(runAdaptiveLink(platform, master, 500, remoteSpeeds), "Should renegotiate after the recovery delay");
+    test.verify(master.getCurrentSpeed() == TurboMIDI::SpeedMultiplier::SPEED_5X, "Should recover at 5x, not 8x");
+    test.endTest();
+}
+
+// Handler for the StaticCallbacks test; only the hooks it hides are called
+struct CountingHandler : TurboMIDI::NoCallbacks {
+    static int requests;
+    static TurboMIDI::SpeedMultiplier lastSpeed;
+    static void onSpeedRequest() { ++requests; }
+    static void onSpeedChanged(TurboMIDI::SpeedMultiplier speed) { lastSpeed = speed; }
+};
+int CountingHandler::requests = 0;
+TurboMIDI::SpeedMultiplier CountingHandler::lastSpeed = TurboMIDI::SpeedMultiplier::SPEED_1X;
+
+static_assert(TurboMIDI::FixedRole<TurboMIDI::DeviceRole::SLAVE>::role() == TurboMIDI::DeviceRole::SLAVE,
+              "Fixed roles are compile-time constants");
+
+void testCompileTimeRoles(TestFramework& test) {
+    test.startTest("Compile-time Roles - Slave with static callbacks");
+    MockPlatform slavePlatform;
+    TurboMIDI::TurboMIDISlave<TurboMIDI::StaticCallbacks<CountingHandler>> slave(&slavePlatform);
+    slave.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_4X, true);
+    test.verify(slave.getRole() == TurboMIDI::DeviceRole::SLAVE, "Role should be fixed to slave");
+    test.verify(!slave.beginNegotiation(TurboMIDI::SpeedMultiplier::SPEED_4X), "Slave cannot negotiate");
+    
+    slavePlatform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x10, 0xF7});
+    slavePlatform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x12, 0x04, 0x04, 0xF7});
+    slave.handleIncomingData();
+    test.verify(CountingHandler::requests == 1, "Static speed request hook should run");
+    test.verify(slavePlatform.findMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x11, 0x04, 0x00, 0x04, 0x00, 0xF7}),
+                "Slave should answer with its speeds");
+    test.verify(CountingHandler::lastSpeed == TurboMIDI::SpeedMultiplier::SPEED_4X, "Static speed hook should run");
+    test.endTest();
+    
+    test.startTest("Compile-time Roles - Master with function pointers");
+    struct Outcome {
+        bool done = false;
+        bool success = false;
+    } outcome;
+    MockPlatform masterPlatform;
+    TurboMIDI::TurboMIDIMaster<> master(&masterPlatform);
+    master.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_4X, true);
+    master.callbackContext = &outcome;
+    master.onNegotiationComplete = [](void* context, bool success, TurboMIDI::SpeedMultiplier) {
+        static_cast<Outcome*>(context)->done = true;
+        static_cast<Outcome*>(context)->success = success;
+    };
+    
+    // A master ignores requests addressed to slaves
+    masterPlatform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x10, 0xF7});
+    master.handleIncomingData();
+    test.verify(masterPlatform.txBuffer.empty(), "Master should not answer SPEED_REQ");
+    
+    test.verify(master.beginNegotiation(TurboMIDI::SpeedMultiplier::SPEED_4X), "Master should negotiate");
+    masterPlatform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x11, 0x04, 0x00, 0x04, 0x00, 0xF7});
+    masterPlatform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x13, 0xF7});
+    master.handleIncomingData();
+    master.handleIncomingData();
+    test.verify(outcome.done && outcome.success, "Pointer callback should receive the outcome");
+    test.verify(master.getCurrentSpeed() == TurboMIDI::SpeedMultiplier::SPEED_4X, "Master should run at 4x");
+    test.endTest();
+}
+
+// Mock platform with a microsecond clock
+class MicrosPlatform : public MockPlatform {
+public:
+    uint32_t micros = 0;
+    uint32_t getMicros() override { return micros; }
+};
+
+// Platform with a small TX queue that empties when the test says so
+class SmallQueuePlatform : public MicrosPlatform {
+public:
+    size_t room = 64;
+    bool overfilled = false;
+    
+    void sendMidiData(const uint8_t* data, size_t length) override {
+        overfilled = overfilled || length > room;
+        room -= std::min(room, length);
+        MicrosPlatform::sendMidiData(data, length);
+    }
+    size_t txSpace() override { return room; }
+};
+
+void testTxScheduler(TestFramework& test) {
+    test.startTest("TX Scheduler - Ordering");
+    TurboMIDI::TxScheduler<4> queue;
+    const uint8_t a[] = {0x90, 0x3C, 0x64};
+    const uint8_t b[] = {0x80, 0x3C, 0x00};
+    const uint8_t clock[] = {0xF8};
+    test.verify(queue.push(300, clock, 1), "Push should succeed");
+    test.verify(queue.push(100, b, 3), "Push should succeed");
+    test.verify(queue.push(200, clock, 1), "Push should succeed");
+    test.verify(queue.push(100, a, 3), "Push should succeed");
+    test.verify(!queue.push(400, clock, 1), "Full queue should reject");
+    test.verify(queue.droppedMessages() == 1, "Rejected message should be counted");
+    
+    test.verify(queue.top()->dueMicros == 100 && queue.top()->data[0] == 0x80, "Earliest first");
+    queue.pop();
+    test.verify(queue.top()->dueMicros == 100 && queue.top()->data[0] == 0x90, "Equal times keep insertion order");
+    queue.pop();
+    test.verify(queue.top()->dueMicros == 200, "Then 200");
+    queue.pop();
+    test.verify(queue.top()->dueMicros == 300, "Then 300");
+    queue.pop();
+    test.verify(queue.empty() && queue.top() == nullptr, "Queue should be empty");
+    
+    // Due times across the 32-bit wrap
+    queue.push(0x00000010, b, 3);
+    queue.push(0xFFFFFFF0, a, 3);
+    test.verify(queue.top()->data[0] == 0x90, "Wrapped time should order after 0xFFFFFFF0");
+    test.endTest();
+    
+    test.startTest("TX Scheduler - Release at byte time");
+    MicrosPlatform platform;
+    TurboMIDI::TurboMIDI turbo(&platform, TurboMIDI::DeviceRole::SLAVE);
+    TurboMIDI::TxScheduler<8> scheduler;
+    test.verify(!turbo.scheduleMessage(1000, clock, 1), "No scheduler attached");
+    turbo.attachTxScheduler(&scheduler);
+    
+    // 1x: one byte takes 320us, so a clock due at 1000us is sent at 680us
+    test.verify(turbo.getByteTimeMicros() == 320, "1x byte time");
+    test.verify(turbo.scheduleMessage(1000, clock, 1), "Schedule should succeed");
+    uint32_t releaseAt = 0;
+    test.verify(turbo.nextTxReleaseMicros(releaseAt) && releaseAt == 680, "Release time should include byte time");
+    platform.micros = 679;
+    turbo.handleIncomingData();
+    test.verify(platform.txBuffer.empty(), "Nothing before the release time");
+    platform.micros = 680;
+    turbo.handleIncomingData();
+    test.verify(platform.txBuffer.size() == 1 && platform.txBuffer[0] == 0xF8, "Clock released on time");
+    
+    // 4x after a push: 80us per byte
+    platform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x12, 0x04, 0x04, 0xF7});
+    turbo.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_4X, true);
+    platform.micros = 10000;
+    turbo.handleIncomingData();
+    test.verify(turbo.getByteTimeMicros() == 80, "4x byte time");
+    platform.clearBuffers();
+    platform.micros = 20000;
+    turbo.scheduleMessage(20500, a, 3);
+    turbo.serviceTxScheduler();
+    platform.micros = 20259;
+    turbo.serviceTxScheduler();
+    test.verify(platform.txBuffer.empty(), "Held until 3 byte times before due");
+    platform.micros = 20260;
+    turbo.serviceTxScheduler();
+    test.verify(platform.txBuffer.size() == 3, "Note released 240us early");
+    
+    // Bytes still in flight move the next release earlier
+    platform.clearBuffers();
+    turbo.scheduleMessage(21000, b, 3);
+    test.verify(platform.txBuffer.empty(), "Not due yet");
+    test.verify(turbo.nextTxReleaseMicros(releaseAt) && releaseAt == 21000 - 240 - 240, "Backlog should be included");
+    test.endTest();
+    
+    test.startTest("TX Scheduler - Held during speed test");
+    MicrosPlatform slavePlatform;
+    TurboMIDI::TurboMIDI slave(&slavePlatform, TurboMIDI::DeviceRole::SLAVE);
+    slave.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_8X, false);
+    slave.attachTxScheduler(&scheduler);
+    scheduler.clear();
+    slavePlatform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x12, 0x08, 0x07, 0xF7});
+    slave.handleIncomingData();
+    slavePlatform.clearBuffers();
+    slavePlatform.micros = 5000;
+    slave.scheduleMessage(0, clock, 1);
+    slave.handleIncomingData();
+    test.verify(slavePlatform.txBuffer.empty(), "Scheduled data must not disturb the speed test");
+    
+    // A corrupted test pattern ends the test
+    slavePlatform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x14,
+                                 0x55, 0x55, 0x00, 0x55, 0x00, 0x00, 0x00, 0x00, 0xF7});
+    slave.handleIncomingData();
+    test.verify(slavePlatform.findMessage({0xF8}), "Held message released after the test");
+    test.endTest();
+}
+
 void testSlaveSpeedTest(TestFramework& test) {
     test.startTest("Slave Speed Test Sequence");
     
@@ -371,18 +1074,19 @@ void testSlaveSpeedTest(TestFramework& test) {
     platform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x12, 0x07, 0x04, 0xF7});
     slave.handleIncomingData();
     
-    // Should send ACK
+    // Should send ACK, then listen at the test speed (8x)
     test.verify(platform.findMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x13, 0xF7}),
                 "Slave should send ACK");
+    test.verify(platform.currentBaudRate == 250000, "Should switch to test speed 8x after ACK");
     
-    // Receive SPEED_TEST
+    // Receive SPEED_TEST at 8x
     platform.clearBuffers();
     platform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x14, 
                            0x55, 0x55, 0x55, 0x55, 0x00, 0x00, 0x00, 0x00, 0xF7});
     slave.handleIncomingData();
     
-    // Should switch to test speed (8x) and send result
-    test.verify(platform.currentBaudRate == 250000, "Should switch to test speed 8x");
+    // Should answer at the test speed
+    test.verify(platform.currentBaudRate == 250000, "Should stay at test speed 8x");
     test.verify(platform.findMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x15, 
                                      0x55, 0x55, 0x55, 0x55, 0x00, 0x00, 0x00, 0x00, 0xF7}),
                 "Slave should send SPEED_RESULT");
@@ -402,6 +1106,1237 @@ void testSlaveSpeedTest(TestFramework& test) {
     test.endTest();
 }
 
+void testBulkReceive(TestFramework& test) {
+    test.startTest("Bulk Receive - Status byte scan");
+    uint8_t buffer[80];
+    bool correct = true;
+    for (size_t length = 0; length <= 64 && correct; ++length) {
+        for (size_t offset = 0; offset < 8; ++offset) {
+            std::fill(buffer, buffer + sizeof(buffer), 0x55);
+            // No status byte, then one at every position
+            correct = correct && TurboMIDI::detail::findStatusByte(buffer + offset, length) == length;
+            for (size_t pos = 0; pos < length; ++pos) {
+                buffer[offset + pos] = static_cast<uint8_t>(0x80 | pos);
+                correct = correct && TurboMIDI::detail::findStatusByte(buffer + offset, length) == pos;
+                buffer[offset + pos] = 0x7F;
+            }
+        }
+    }
+    test.verify(correct, "Scan should find the first byte with bit 7 set at any offset and length");
+    test.endTest();
+    
+    test.startTest("Bulk Receive - Same result as byte-wise processing");
+    std::vector<uint8_t> stream;
+    // Foreign SysEx with interleaved realtime, an oversized frame, notes with running status
+    stream.insert(stream.end(), {0xF0, 0x43, 0x10, 0x20, 0xF8, 0x30, 0x40, 0xF7});
+    stream.push_back(0xF0);
+    for (int i = 0; i < 100; ++i) stream.push_back(static_cast<uint8_t>(i & 0x7F));
+    stream.insert(stream.end(), {0xF7, 0x90, 0x3C, 0x64, 0x3E, 0x64, 0xFE, 0x40, 0x00, 0xC0, 0x05});
+    // Elektron SPEED_REQ split by a clock byte, then a frame aborted by a status byte
+    stream.insert(stream.end(), {0xF0, 0x00, 0x20, 0x3C, 0xF8, 0x00, 0x00, 0x10, 0xF7});
+    stream.insert(stream.end(), {0xF0, 0x00, 0x20, 0x80, 0x3C, 0x00, 0xF2, 0x10, 0x20});
+    
+    struct Capture {
+        std::vector<uint8_t> events;
+        void attach(TurboMIDI::TurboMIDI& turbo) {
+            turbo.onMidiMessage = [this](const TurboMIDI::MidiMessage& message) {
+                events.insert(events.end(), {message.status, message.data1, message.data2});
+            };
+            turbo.onRealtime = [this](uint8_t byte) { events.push_back(byte); };
+        }
+    };
+    
+    MockPlatform bulkPlatform;
+    MockPlatform bytePlatform;
+    TurboMIDI::TurboMIDI bulk(&bulkPlatform, TurboMIDI::DeviceRole::SLAVE);
+    TurboMIDI::TurboMIDI bytewise(&bytePlatform, TurboMIDI::DeviceRole::SLAVE);
+    Capture bulkEvents;
+    Capture byteEvents;
+    bulkEvents.attach(bulk);
+    byteEvents.attach(bytewise);
+    
+    bulkPlatform.injectMessage(stream);
+    bulk.handleIncomingData();
+    for (uint8_t byte : stream) {
+        bytePlatform.injectMessage({byte});
+        bytewise.handleIncomingData();
+    }
+    
+    test.verify(!bulkEvents.events.empty() && bulkEvents.events == byteEvents.events, "Same messages and realtime bytes");
+    test.verify(!bulkPlatform.txBuffer.empty() && bulkPlatform.txBuffer == bytePlatform.txBuffer,
+                "Same SPEED_ANSWER sent");
+    test.verify(bulk.getStats().bytesIn == stream.size(), "Every byte should be counted");
+    test.verify(bulk.getStats().rejected(TurboMIDI::FrameRejectReason::OVERSIZED) == 1 &&
+                bytewise.getStats().rejected(TurboMIDI::FrameRejectReason::OVERSIZED) == 1,
+                "Oversized frame should be rejected once");
+    test.endTest();
+}
+
+void testStreamingSysEx(TestFramework& test) {
+    test.startTest("Streaming SysEx - Chunked receive");
+    MockPlatform platform;
+    TurboMIDI::TurboMIDI turbo(&platform, TurboMIDI::DeviceRole::SLAVE);
+    std::vector<uint8_t> received;
+    int begins = 0;
+    int chunks = 0;
+    std::vector<bool> ends;
+    std::vector<uint8_t> realtime;
+    turbo.onSysExBegin = [&]() { ++begins; };
+    turbo.onSysExChunk = [&](const uint8_t* data, size_t length) {
+        ++chunks;
+        received.insert(received.end(), data, data + length);
+    };
+    turbo.onSysExEnd = [&](bool complete) { ends.push_back(complete); };
+    turbo.onRealtime = [&](uint8_t byte) { realtime.push_back(byte); };
+    
+    // 1000-byte dump far beyond TURBOMIDI_MAX_FRAME_LENGTH, with a clock in the middle
+    std::vector<uint8_t> payload;
+    for (int i = 0; i < 1000; ++i) payload.push_back(static_cast<uint8_t>((i * 7) & 0x7F));
+    std::vector<uint8_t> dump = {0xF0};
+    dump.insert(dump.end(), payload.begin(), payload.begin() + 500);
+    dump.push_back(0xF8);
+    dump.insert(dump.end(), payload.begin() + 500, payload.end());
+    dump.push_back(0xF7);
+    platform.injectMessage(dump);
+    while (!platform.rxBuffer.empty()) turbo.handleIncomingData();
+    
+    test.verify(begins == 1 && ends.size() == 1 && ends[0], "One complete message");
+    test.verify(received == payload, "Chunks should carry the payload without the realtime byte");
+    test.verify(chunks <= 6, "Whole runs of the receive buffer should be delivered at once");
+    test.verify(realtime.size() == 1 && realtime[0] == 0xF8, "Clock should still be reported");
+    
+    // A status byte aborts the message and is processed normally
+    ends.clear();
+    int notes = 0;
+    turbo.onMidiMessage = [&](const TurboMIDI::MidiMessage&) { ++notes; };
+    platform.injectMessage({0xF0, 0x43, 0x01, 0x90, 0x3C, 0x64});
+    turbo.handleIncomingData();
+    test.verify(begins == 2 && ends.size() == 1 && !ends[0], "Interrupted message should end incomplete");
+    test.verify(notes == 1, "Note after the aborted message should be parsed");
+    
+    // Foreign messages that start like a TurboMIDI header are delivered from SYSEX_START on
+    received.clear();
+    ends.clear();
+    platform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x01, 0x7F, 0xF7, 0xF0, 0x00, 0x20, 0xF7});
+    turbo.handleIncomingData();
+    test.verify(begins == 4 && ends.size() == 2 && ends[0] && ends[1], "Both messages should be reported");
+    test.verify(received == std::vector<uint8_t>({0x00, 0x20, 0x3C, 0x01, 0x7F, 0x00, 0x20}),
+                "Held header bytes should come first");
+    
+    // A TurboMIDI frame stays with the engine
+    platform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x10, 0xF7});
+    turbo.handleIncomingData();
+    test.verify(begins == 4 && ends.size() == 2, "SPEED_REQ should not be streamed");
+    test.endTest();
+    
+    test.startTest("Streaming SysEx - Paced chunked send");
+    MicrosPlatform sender;
+    TurboMIDI::TurboMIDI master(&sender, TurboMIDI::DeviceRole::MASTER);
+    TurboMIDI::SysExSendConfig config;
+    config.chunkSize = 100;
+    config.chunkGapMicros = 500;
+    config.maxQueuedBytes = 0;      // Paced by the gaps alone
+    test.verify(!master.beginSysExSend(payload.data(), payload.size(), config), "Payload is not a SysEx message");
+    test.verify(master.beginSysExSend(dump.data(), dump.size(), config), "Dump should start");
+    test.verify(sender.txBuffer.size() == 100, "First chunk is sent at once");
+    test.verify(!master.beginNegotiation(TurboMIDI::SpeedMultiplier::SPEED_4X), "No negotiation during a dump");
+    test.verify(!master.beginSysExSend(dump.data(), dump.size(), config), "Only one dump at a time");
+    
+    sender.micros = 499;
+    master.handleIncomingData();
+    test.verify(sender.txBuffer.size() == 100, "Paced: nothing before the gap elapsed");
+    sender.micros = 500;
+    master.handleIncomingData();
+    test.verify(sender.txBuffer.size() == 200, "Second chunk after the gap");
+    while (master.isSysExSending()) {
+        sender.micros += 500;
+        master.serviceTx();
+    }
+    test.verify(sender.txBuffer == dump, "Dump should arrive unchanged");
+    test.verify(master.sysExBytesRemaining() == 0, "Nothing left");
+    test.endTest();
+    
+    test.startTest("Streaming SysEx - Cancel terminates the message");
+    sender.clearBuffers();
+    master.beginSysExSend(dump.data(), dump.size(), config);
+    master.cancelSysExSend();
+    test.verify(!master.isSysExSending(), "Dump should stop");
+    test.verify(sender.txBuffer.size() == 101 && sender.txBuffer.back() == 0xF7, "SYSEX_END should follow the sent part");
+    test.endTest();
+
+    test.startTest("Streaming SysEx - Chunks fit the platform queue");
+    SmallQueuePlatform small;
+    TurboMIDI::TurboMIDI smallSender(&small, TurboMIDI::DeviceRole::MASTER);
+    TurboMIDI::SysExSendConfig gapped;  // 256-byte chunks
+    gapped.chunkGapMicros = 5000;
+    smallSender.beginSysExSend(dump.data(), dump.size(), gapped);
+    test.verify(small.txBuffer.size() == 64, "Only the free room is handed over");
+    small.micros = 100;
+    smallSender.handleIncomingData();
+    test.verify(small.txBuffer.size() == 64, "Nothing while the queue is full");
+    small.room = 200;
+    small.micros = 400;
+    smallSender.handleIncomingData();
+    test.verify(small.txBuffer.size() == 256, "The rest of the chunk follows without the gap");
+    small.room = 500;
+    small.micros = 5000;
+    smallSender.handleIncomingData();
+    test.verify(small.txBuffer.size() == 256, "The gap follows a whole chunk");
+    while (smallSender.isSysExSending()) {
+        small.room = 64;
+        small.micros += 5000;
+        smallSender.serviceTx();
+    }
+    test.verify(!small.overfilled, "No write should exceed the free room");
+    test.verify(small.txBuffer == dump, "Dump should arrive unchanged");
+    test.endTest();
+    
+    test.startTest("Streaming SysEx - Long chunks keep the line time");
+    MicrosPlatform longPlatform;
+    TurboMIDI::TurboMIDI longSender(&longPlatform, TurboMIDI::DeviceRole::MASTER);
+    TurboMIDI::TxScheduler<4> scheduler;
+    longSender.attachTxScheduler(&scheduler);
+    config.chunkSize = 500;         // 500 bytes * 1e7 overflows 32 bits
+    config.chunkGapMicros = 1000000;
+    longSender.beginSysExSend(dump.data(), dump.size(), config);
+    test.verify(longPlatform.txBuffer.size() == 500, "First chunk is sent at once");
+    test.verify(TurboMIDI::wireTimeMicros(TurboMIDI::SpeedMultiplier::SPEED_1X, 500) == 160000, "500 bytes at 1x");
+
+    // The clock waits behind the 160ms chunk still on the wire
+    const uint8_t clock[] = {0xF8};
+    longSender.scheduleMessage(200000, clock, 1);
+    uint32_t releaseAt = 0;
+    test.verify(longSender.nextTxReleaseMicros(releaseAt) && releaseAt == 200000 - 320 - 160000,
+                "Release time should cover the whole chunk");
+    test.endTest();
+}
+
+// Negotiate `target` over a simulated link; the slave is serviced while the master waits
+static bool simulateNegotiation(TurboMIDI::SimulatedLink& link, TurboMIDI::TurboMIDI& master,
+                                TurboMIDI::TurboMIDI& slave, TurboMIDI::SpeedMultiplier target) {
+    link.a().service = [&master]() { master.handleIncomingData(); };
+    link.b().service = [&slave]() { slave.handleIncomingData(); };
+    return master.negotiateSpeed(target);
+}
+
+void testSimulatedLink(TestFramework& test) {
+    typedef TurboMIDI::SpeedMultiplier Speed;
+    
+    test.startTest("Simulated Link - Tested negotiation with byte timing");
+    TurboMIDI::SimulatedLink link;
+    TurboMIDI::TurboMIDI master(&link.a(), TurboMIDI::DeviceRole::MASTER);
+    TurboMIDI::TurboMIDI slave(&link.b(), TurboMIDI::DeviceRole::SLAVE);
+    master.setSupportedSpeed(Speed::SPEED_8X, false);
+    slave.setSupportedSpeed(Speed::SPEED_8X, false);
+    slave.setSupportedSpeed(Speed::SPEED_10X, false);
+    test.verify(simulateNegotiation(link, master, slave, Speed::SPEED_8X), "Negotiation should succeed");
+    test.verify(master.getCurrentSpeed() == Speed::SPEED_8X && slave.getCurrentSpeed() == Speed::SPEED_8X,
+                "Both sides should run at 8x");
+    test.verify(link.a().baudRate() == 250000 && link.b().baudRate() == 250000, "Both UARTs at 250000");
+    test.verify(link.b().counters().garbled >= 16, "Breathing bytes reach the slave at the wrong rate");
+    test.verify(link.a().counters().garbled == 0, "Nothing the master needs is lost");
+    
+    // Master goes silent: the slave falls back after the 300ms timeout, in virtual time
+    link.a().service = nullptr;
+    uint32_t silentSince = link.nowMicros();
+    test.verify(link.runUntil([&slave]() { return slave.getCurrentSpeed() == Speed::SPEED_1X; }, 1000000),
+                "Slave should fall back to 1x");
+    uint32_t fallbackMs = (link.nowMicros() - silentSince) / 1000;
+    test.verify(fallbackMs >= 300 && fallbackMs <= 302, "Fallback should happen right after 300ms");
+    test.endTest();
+    
+    test.startTest("Simulated Link - 100 KB dump at 20x");
+    TurboMIDI::SimulatedLink fastLink;
+    TurboMIDI::TurboMIDI sender(&fastLink.a(), TurboMIDI::DeviceRole::MASTER);
+    TurboMIDI::TurboMIDI receiver(&fastLink.b(), TurboMIDI::DeviceRole::SLAVE);
+    sender.setSupportedSpeed(Speed::SPEED_20X, true);
+    receiver.setSupportedSpeed(Speed::SPEED_20X, true);
+    test.verify(simulateNegotiation(fastLink, sender, receiver, Speed::SPEED_20X), "Certified 20x should succeed");
+    
+    std::vector<uint8_t> dump = {0xF0, 0x00, 0x20, 0x3C};
+    for (uint32_t i = 0; dump.size() < 100 * 1024 - 1; ++i) dump.push_back(static_cast<uint8_t>((i * 31) & 0x7F));
+    dump.push_back(0xF7);
+    std::vector<uint8_t> received;
+    bool complete = false;
+    receiver.onSysExChunk = [&received](const uint8_t* data, size_t length) {
+        received.insert(received.end(), data, data + length);
+    };
+    receiver.onSysExEnd = [&complete](bool ok) { complete = ok; };
+    
+    uint32_t start = fastLink.nowMicros();
+    test.verify(sender.beginSysExSend(dump.data(), dump.size()), "Dump should start");
+    test.verify(fastLink.runUntil([&complete]() { return complete; }, 5000000), "Dump should arrive");
+    uint32_t elapsedMs = (fastLink.nowMicros() - start) / 1000;
+    test.verify(received.size() == dump.size() - 2 && std::equal(received.begin(), received.end(), dump.begin() + 1),
+                "Dump should arrive intact");
+    // 102400 bytes at 16us per byte
+    test.verify(elapsedMs >= 1638 && elapsedMs <= 1660, "Transfer should take the wire time of 20x");
+    test.endTest();
+    
+    test.startTest("Simulated Link - Baud switch window");
+    TurboMIDI::SimLinkConfig slowSwitch;
+    slowSwitch.switchWindowMicros = 15000;  // Longer than the 10ms breathing time
+    TurboMIDI::SimulatedLink slowLink(slowSwitch);
+    TurboMIDI::TurboMIDI slowMaster(&slowLink.a(), TurboMIDI::DeviceRole::MASTER);
+    TurboMIDI::TurboMIDI slowSlave(&slowLink.b(), TurboMIDI::DeviceRole::SLAVE);
+    slowMaster.setSupportedSpeed(Speed::SPEED_4X, false);
+    slowSlave.setSupportedSpeed(Speed::SPEED_4X, false);
+    slowSlave.setSupportedSpeed(Speed::SPEED_5X, false);
+    test.verify(!simulateNegotiation(slowLink, slowMaster, slowSlave, Speed::SPEED_4X),
+                "Test frame inside the switch window should be lost");
+    test.verify(slowMaster.getCurrentSpeed() == Speed::SPEED_1X, "Master should revert to 1x");
+    slowLink.runUntil([&slowSlave]() { return slowSlave.getCurrentSpeed() == Speed::SPEED_1X; }, 1000000);
+    slowLink.config().switchWindowMicros = 500;
+    slowLink.advance(1000);
+    test.verify(simulateNegotiation(slowLink, slowMaster, slowSlave, Speed::SPEED_4X),
+                "A short switch window fits in the breathing time");
+    test.endTest();
+    
+    test.startTest("Simulated Link - Bit errors are deterministic");
+    uint32_t corrupted[2] = {0, 0};
+    bool outcome[2] = {false, false};
+    for (int run = 0; run < 2; ++run) {
+        TurboMIDI::SimLinkConfig noisy;
+        noisy.bitErrorRate = 0.05;
+        noisy.seed = 1234;
+        TurboMIDI::SimulatedLink noisyLink(noisy);
+        TurboMIDI::TurboMIDI noisyMaster(&noisyLink.a(), TurboMIDI::DeviceRole::MASTER);
+        TurboMIDI::TurboMIDI noisySlave(&noisyLink.b(), TurboMIDI::DeviceRole::SLAVE);
+        noisyMaster.setSupportedSpeed(Speed::SPEED_4X, false);
+        noisySlave.setSupportedSpeed(Speed::SPEED_4X, false);
+        noisySlave.setSupportedSpeed(Speed::SPEED_5X, false);
+        outcome[run] = simulateNegotiation(noisyLink, noisyMaster, noisySlave, Speed::SPEED_4X);
+        noisyLink.runUntil([]() { return false; }, 500000);
+        corrupted[run] = noisyLink.a().counters().corrupted + noisyLink.b().counters().corrupted;
+        test.verify(noisyMaster.getCurrentSpeed() == Speed::SPEED_1X && noisySlave.getCurrentSpeed() == Speed::SPEED_1X,
+                    "A noisy link should end at 1x on both sides");
+    }
+    test.verify(!outcome[0] && corrupted[0] > 0, "Negotiation should fail on a 5% bit error rate");
+    test.verify(outcome[0] == outcome[1] && corrupted[0] == corrupted[1], "Same seed, same run");
+    test.endTest();
+}
+
+// Platform exposing its receive buffer through peekMidiData()/consumeMidiData()
+class PeekPlatform : public MockPlatform {
+public:
+    std::vector<uint8_t> driverBuffer;
+    size_t readPos = 0;
+    size_t regionLimit = 64;   // Split the buffer like a wrapping ring would
+    size_t copies = 0;
+    
+    size_t peekMidiData(const uint8_t*& data) override {
+        data = driverBuffer.data() + readPos;
+        return std::min(regionLimit, driverBuffer.size() - readPos);
+    }
+    
+    void consumeMidiData(size_t count) override { readPos += count; }
+    
+    size_t receiveMidiData(uint8_t* buffer, size_t maxLength) override {
+        ++copies;
+        return MockPlatform::receiveMidiData(buffer, maxLength);
+    }
+};
+
+void testZeroCopyReceive(TestFramework& test) {
+    test.startTest("Zero-copy Receive - Parse in the driver buffer");
+    PeekPlatform platform;
+    TurboMIDI::TurboMIDI turbo(&platform, TurboMIDI::DeviceRole::SLAVE);
+    bool inPlace = true;
+    size_t chunkBytes = 0;
+    turbo.onSysExChunk = [&](const uint8_t* data, size_t length) {
+        const uint8_t* begin = platform.driverBuffer.data();
+        inPlace = inPlace && data >= begin && data + length <= begin + platform.driverBuffer.size();
+        chunkBytes += length;
+    };
+    int notes = 0;
+    turbo.onMidiMessage = [&notes](const TurboMIDI::MidiMessage&) { ++notes; };
+    
+    platform.driverBuffer = {0x90, 0x3C, 0x64, 0xF0, 0x43};
+    for (int i = 0; i < 200; ++i) platform.driverBuffer.push_back(static_cast<uint8_t>(i & 0x7F));
+    platform.driverBuffer.push_back(0xF7);
+    // SPEED_REQ straddling a region boundary
+    platform.driverBuffer.insert(platform.driverBuffer.end(), {0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x10, 0xF7});
+    turbo.handleIncomingData();
+    
+    test.verify(platform.readPos == platform.driverBuffer.size(), "Every region should be consumed");
+    test.verify(platform.copies == 0, "receiveMidiData should not be used");
+    // The SPEED_REQ is handled by the engine and not streamed
+    test.verify(inPlace && chunkBytes == 201, "SysEx chunks should point into the driver buffer");
+    test.verify(notes == 1, "Note should be parsed");
+    test.verify(platform.findMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x11}), "Frame across regions should be answered");
+    test.endTest();
+    
+    test.startTest("Zero-copy Receive - Fallback to receiveMidiData");
+    platform.injectMessage({0x80, 0x3C, 0x00});
+    turbo.handleIncomingData();
+    test.verify(platform.copies == 1 && notes == 2, "Empty peek should fall back to receiveMidiData");
+    test.endTest();
+}
+
+// Platform counting clock reads
+class CountingClockPlatform : public MockPlatform {
+public:
+    int reads = 0;
+    
+    uint32_t getMillis() override {
+        ++reads;
+        return currentTime;
+    }
+};
+
+void testDeadlineTimers(TestFramework& test) {
+    test.startTest("Deadline Timers - Active sensing and link timeout");
+    CountingClockPlatform platform;
+    TurboMIDI::TurboMIDI turbo(&platform, TurboMIDI::DeviceRole::SLAVE);
+    turbo.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_4X, true);
+    uint32_t deadline = 0;
+    
+    platform.currentTime = 1000;
+    turbo.handleIncomingData();
+    test.verify(!turbo.nextDeadlineMs(deadline), "Nothing should be pending at 1x");
+    
+    platform.injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x20, 0x04, 0xF7});
+    platform.reads = 0;
+    turbo.handleIncomingData();
+    test.verify(platform.reads == 1, "The clock should be read once per poll");
+    test.verify(platform.findMessage({0xFE}), "Active sensing should start right after the switch");
+    test.verify(turbo.nextDeadlineMs(deadline) && deadline == 1251, "Next active sense is due after 250ms");
+    
+    platform.clearBuffers();
+    platform.currentTime = 1250;
+    turbo.handleIncomingData();
+    test.verify(platform.txBuffer.empty(), "Active sensing should not be sent early");
+    platform.currentTime = 1251;
+    turbo.handleIncomingData();
+    test.verify(platform.txBuffer.size() == 1, "Active sensing should be sent when due");
+    test.verify(turbo.nextDeadlineMs(deadline) && deadline == 1301, "Link timeout is due 300ms after the last byte");
+    
+    platform.currentTime = 1280;
+    platform.injectMessage({0xFE});
+    turbo.handleIncomingData();
+    test.verify(turbo.nextDeadlineMs(deadline) && deadline == 1502, "Received bytes should push the link timeout back");
+    
+    platform.currentTime = 1581;
+    turbo.handleIncomingData();
+    test.verify(turbo.getCurrentSpeed() == TurboMIDI::SpeedMultiplier::SPEED_1X, "Link timeout should revert to 1x");
+    test.verify(!turbo.nextDeadlineMs(deadline), "Timers should stop at 1x");
+    test.endTest();
+    
+    test.startTest("Deadline Timers - Negotiation phases");
+    CountingClockPlatform masterPlatform;
+    TurboMIDI::TurboMIDI master(&masterPlatform, TurboMIDI::DeviceRole::MASTER);
+    masterPlatform.currentTime = 500;
+    master.beginNegotiation(TurboMIDI::SpeedMultiplier::SPEED_2X, 20);
+    test.verify(master.nextDeadlineMs(deadline) && deadline == 520, "Answer timeout should be the next deadline");
+    masterPlatform.currentTime = 519;
+    master.handleIncomingData();
+    test.verify(master.getNegotiationStatus() == TurboMIDI::NegotiationStatus::IN_PROGRESS, "Not timed out yet");
+    masterPlatform.currentTime = 520;
+    master.handleIncomingData();
+    test.verify(master.getNegotiationStatus() == TurboMIDI::NegotiationStatus::FAILED, "Timed out at the deadline");
+    test.verify(!master.nextDeadlineMs(deadline), "No deadline after the negotiation");
+    test.endTest();
+}
+
+void testPipelinedSpeedTest(TestFramework& test) {
+    typedef TurboMIDI::SpeedMultiplier Speed;
+    const std::vector<uint8_t> answer = {0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x11, 0x0C, 0x00, 0x00, 0x00, 0xF7};
+    const std::vector<uint8_t> ack = {0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x13, 0xF7};
+    const std::vector<uint8_t> resultHeader = {0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x15};
+    const std::vector<uint8_t> test2 = {0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x16, 0xF7};
+    const std::vector<uint8_t> result2 = {0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x17, 0xF7};
+    
+    test.startTest("Pipelined Speed Test - TEST2 on the RESULT header");
+    MockPlatform platform;
+    TurboMIDI::TurboMIDI master(&platform, TurboMIDI::DeviceRole::MASTER);
+    master.setSupportedSpeed(Speed::SPEED_4X, false);
+    master.beginNegotiation(Speed::SPEED_4X);
+    platform.currentTime += 2;
+    platform.injectMessage(answer);
+    master.handleIncomingData();
+    platform.currentTime += 3;
+    platform.injectMessage(ack);
+    master.handleIncomingData();
+    platform.currentTime += 10;
+    master.handleIncomingData();
+    
+    platform.clearBuffers();
+    platform.currentTime += 1;
+    platform.injectMessage(resultHeader);
+    master.handleIncomingData();
+    test.verify(platform.findMessage(test2), "TEST2 should go out before RESULT is complete");
+    platform.injectMessage({0x55, 0x55, 0x55, 0x55, 0x00, 0x00, 0x00, 0x00, 0xF7});
+    platform.currentTime += 1;
+    platform.injectMessage(result2);
+    master.handleIncomingData();
+    test.verify(master.getNegotiationStatus() == TurboMIDI::NegotiationStatus::SUCCEEDED, "Negotiation should succeed");
+    test.verify(platform.currentBaudRate == 125000, "Master should end at 4x");
+    
+    const TurboMIDI::NegotiationTiming& timing = master.getNegotiationTiming();
+    test.verify(timing.answer == 2000 && timing.ack == 3000 && timing.breathing == 10000, "Handshake phases should be timed");
+    test.verify(timing.result == 1000 && timing.result2 == 1000, "Test phases should be timed");
+    test.verify(timing.total == 17000, "Total should cover every phase");
+    test.endTest();
+    
+    test.startTest("Pipelined Speed Test - Damaged RESULT still fails");
+    MockPlatform badPlatform;
+    TurboMIDI::TurboMIDI badMaster(&badPlatform, TurboMIDI::DeviceRole::MASTER);
+    badMaster.setSupportedSpeed(Speed::SPEED_4X, false);
+    badMaster.beginNegotiation(Speed::SPEED_4X);
+    badPlatform.injectMessage(answer);
+    badMaster.handleIncomingData();
+    badPlatform.injectMessage(ack);
+    badMaster.handleIncomingData();
+    badPlatform.currentTime += 10;
+    badMaster.handleIncomingData();
+    badPlatform.injectMessage(resultHeader);
+    badPlatform.injectMessage({0x55, 0x51, 0x55, 0x55, 0x00, 0x00, 0x00, 0x00, 0xF7});
+    badPlatform.injectMessage(result2);
+    badMaster.handleIncomingData();
+    test.verify(badMaster.getNegotiationStatus() == TurboMIDI::NegotiationStatus::FAILED,
+                "A damaged echo should fail as soon as RESULT2 arrives");
+    test.verify(badPlatform.currentBaudRate == 31250, "Master should revert to 1x");
+    test.endTest();
+    
+    test.startTest("Pipelined Speed Test - Simulated bring-up");
+    TurboMIDI::SimulatedLink link;
+    TurboMIDI::TurboMIDI simMaster(&link.a(), TurboMIDI::DeviceRole::MASTER);
+    TurboMIDI::TurboMIDI simSlave(&link.b(), TurboMIDI::DeviceRole::SLAVE);
+    simMaster.setSupportedSpeed(Speed::SPEED_8X, false);
+    simSlave.setSupportedSpeed(Speed::SPEED_8X, false);
+    simSlave.setSupportedSpeed(Speed::SPEED_10X, false);
+    simMaster.setBreathingTime(1);
+    test.verify(simulateNegotiation(link, simMaster, simSlave, Speed::SPEED_8X), "Negotiation should succeed");
+    const TurboMIDI::NegotiationTiming& simTiming = simMaster.getNegotiationTiming();
+    // 54 bytes at 1x (handshake and breathing) take 17.3ms on the wire, the test frames 1.3ms at 8x
+    test.verify(simTiming.total < 20000, "Bring-up should take little more than the wire time");
+    test.verify(simTiming.result2 < 1000, "TEST2 round trip should not wait for 1ms polls");
+    test.endTest();
+}
+
+// Worst delay of clock bytes sent every `interval` during a 16 KB dump at 2x
+static uint32_t clockLatencyDuringDump(bool realtimePriority, uint16_t maxQueuedBytes, bool& dumpIntact) {
+    TurboMIDI::SimLinkConfig config;
+    config.stepMicros = 10;
+    config.realtimePriority = realtimePriority;
+    TurboMIDI::SimulatedLink link(config);
+    TurboMIDI::TurboMIDI master(&link.a(), TurboMIDI::DeviceRole::MASTER);
+    TurboMIDI::TurboMIDI slave(&link.b(), TurboMIDI::DeviceRole::SLAVE);
+    master.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_2X, true);
+    slave.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_2X, true);
+    simulateNegotiation(link, master, slave, TurboMIDI::SpeedMultiplier::SPEED_2X);
+    
+    std::vector<uint8_t> dump(16 * 1024, 0x22);
+    dump.front() = TurboMIDI::SYSEX_START;
+    dump.back() = TurboMIDI::SYSEX_END;
+    size_t received = 0;
+    bool complete = false;
+    std::vector<uint32_t> sentAt, arrivedAt;
+    slave.onSysExChunk = [&received](const uint8_t*, size_t length) { received += length; };
+    slave.onSysExEnd = [&complete](bool ok) { complete = ok; };
+    slave.onRealtime = [&](uint8_t byte) {
+        if (byte == 0xF8) arrivedAt.push_back(link.nowMicros());
+    };
+    
+    const uint32_t interval = 20833;  // 24 ppqn at 120 bpm
+    uint32_t nextClock = link.nowMicros() + 1000;
+    link.a().service = [&]() {
+        master.handleIncomingData();
+        if (!complete && static_cast<int32_t>(link.nowMicros() - nextClock) >= 0) {
+            sentAt.push_back(link.nowMicros());
+            master.sendRealtime(0xF8);
+            nextClock += interval;
+        }
+    };
+    TurboMIDI::SysExSendConfig pacing;
+    pacing.maxQueuedBytes = maxQueuedBytes;
+    master.beginSysExSend(dump.data(), dump.size(), pacing);
+    link.runUntil([&complete]() { return complete; }, 10000000);
+    link.runUntil([&]() { return arrivedAt.size() >= sentAt.size(); }, 1000000);
+    
+    dumpIntact = complete && received == dump.size() - 2 && slave.getCurrentSpeed() == TurboMIDI::SpeedMultiplier::SPEED_2X;
+    uint32_t worst = 0;
+    for (size_t i = 0; i < sentAt.size() && i < arrivedAt.size(); ++i) {
+        worst = std::max(worst, arrivedAt[i] - sentAt[i]);
+    }
+    if (sentAt.size() < 20 || arrivedAt.size() != sentAt.size()) dumpIntact = false;
+    return worst;
+}
+
+void testPriorityLanes(TestFramework& test) {
+    typedef TurboMIDI::SpeedMultiplier Speed;
+    
+    test.startTest("Priority Lanes - Clock latency during a dump");
+    bool intact = false;
+    const uint32_t byteMicros = TurboMIDI::wireTimeMicros(Speed::SPEED_2X, 1);
+    uint32_t overtaking = clockLatencyDuringDump(true, 0, intact);
+    test.verify(intact, "Dump and clocks should arrive without a link timeout");
+    test.verify(overtaking <= 2 * byteMicros + 20, "Clocks should overtake the queued dump at a byte boundary");
+    uint32_t unbounded = clockLatencyDuringDump(false, 0, intact);
+    test.verify(intact, "Dump and clocks should arrive on a FIFO-only platform");
+    test.verify(unbounded > 100 * byteMicros, "Without priority or a limit clocks wait behind the dump");
+    uint32_t boundedLane = clockLatencyDuringDump(false, 16, intact);
+    test.verify(intact && boundedLane <= 17 * byteMicros + 20, "A 16 byte lane bounds clocks to 16 queued bytes");
+    uint32_t oneByte = clockLatencyDuringDump(false, 1, intact);
+    test.verify(intact && oneByte <= 2 * byteMicros + 20, "A one byte lane delays clocks by about one byte time");
+    test.endTest();
+    
+    test.startTest("Priority Lanes - Full throughput by default");
+    test.verify(TurboMIDI::SysExSendConfig().maxQueuedBytes == 0, "The bulk bound should be opt-in");
+    // Polled once a millisecond, a dump still fills the 20x line
+    TurboMIDI::SimLinkConfig slowPoll;
+    slowPoll.stepMicros = 1000;
+    TurboMIDI::SimulatedLink dumpLink(slowPoll);
+    TurboMIDI::TurboMIDI sender(&dumpLink.a(), TurboMIDI::DeviceRole::MASTER);
+    TurboMIDI::TurboMIDI receiver(&dumpLink.b(), TurboMIDI::DeviceRole::SLAVE);
+    sender.setSupportedSpeed(Speed::SPEED_20X, true);
+    receiver.setSupportedSpeed(Speed::SPEED_20X, true);
+    test.verify(simulateNegotiation(dumpLink, sender, receiver, Speed::SPEED_20X), "Certified 20x should succeed");
+    std::vector<uint8_t> dump(16 * 1024, 0x22);
+    dump.front() = TurboMIDI::SYSEX_START;
+    dump.back() = TurboMIDI::SYSEX_END;
+    bool complete = false;
+    receiver.onSysExEnd = [&complete](bool ok) { complete = ok; };
+    uint32_t start = dumpLink.nowMicros();
+    sender.beginSysExSend(dump.data(), dump.size());
+    test.verify(dumpLink.runUntil([&complete]() { return complete; }, 5000000), "Dump should arrive");
+    // 16384 bytes at 16us per byte; 16 bytes per poll would take over a second
+    test.verify(dumpLink.nowMicros() - start <= 16384 * 16 + 2000, "The dump should take the wire time of 20x");
+    test.endTest();
+    
+    test.startTest("Priority Lanes - Realtime held during a speed test");
+    TurboMIDI::SimulatedLink link;
+    TurboMIDI::TurboMIDI master(&link.a(), TurboMIDI::DeviceRole::MASTER);
+    TurboMIDI::TurboMIDI slave(&link.b(), TurboMIDI::DeviceRole::SLAVE);
+    master.setSupportedSpeed(Speed::SPEED_8X, false);
+    slave.setSupportedSpeed(Speed::SPEED_8X, false);
+    link.a().service = [&master]() { master.handleIncomingData(); };
+    link.b().service = [&slave]() { slave.handleIncomingData(); };
+    std::vector<std::pair<uint8_t, Speed>> realtime;
+    slave.onRealtime = [&](uint8_t byte) { realtime.push_back(std::make_pair(byte, slave.getCurrentSpeed())); };
+    
+    test.verify(!master.sendRealtime(0x90), "Only realtime bytes use the lane");
+    master.beginNegotiation(Speed::SPEED_8X);
+    link.runUntil([&slave]() { return slave.getCurrentSpeed() == Speed::SPEED_8X; }, 100000);
+    test.verify(master.sendRealtime(0xFA), "Start should be held during the speed test");
+    link.runUntil([&master]() { return master.getNegotiationStatus() != TurboMIDI::NegotiationStatus::IN_PROGRESS; },
+                  100000);
+    link.advance(1000);
+    test.verify(master.getNegotiationStatus() == TurboMIDI::NegotiationStatus::SUCCEEDED, "Speed test should pass");
+    test.verify(realtime.size() == 1 && realtime[0].first == 0xFA &&
+                realtime[0].second == Speed::SPEED_8X, "Held start should follow the test at 8x");
+    test.endTest();
+}
+
+// Best-speed search over 2x-10x on a cable that flips bits at the 8x rate and above
+static TurboMIDI::SpeedMultiplier bestSpeedOnMarginalCable(bool linkTest, TurboMIDI::LinkQuality& quality) {
+    typedef TurboMIDI::SpeedMultiplier Speed;
+    TurboMIDI::SimLinkConfig config;
+    config.bitErrorRate = 2e-4;
+    config.bitErrorMinBaudRate = TurboMIDI::speedBaudRate(Speed::SPEED_8X);
+    config.seed = 4;
+    TurboMIDI::SimulatedLink link(config);
+    TurboMIDI::TurboMIDI master(&link.a(), TurboMIDI::DeviceRole::MASTER);
+    TurboMIDI::TurboMIDI slave(&link.b(), TurboMIDI::DeviceRole::SLAVE);
+    const Speed speeds[] = {Speed::SPEED_2X, Speed::SPEED_3_3X, Speed::SPEED_4X, Speed::SPEED_5X,
+                            Speed::SPEED_6_6X, Speed::SPEED_8X, Speed::SPEED_10X};
+    for (Speed speed : speeds) {
+        master.setSupportedSpeed(speed, false);
+        slave.setSupportedSpeed(speed, false);
+    }
+    if (linkTest) {
+        master.enableLinkTest();
+        slave.enableLinkTest();
+    }
+    link.a().service = [&master]() { master.handleIncomingData(); };
+    link.b().service = [&slave]() { slave.handleIncomingData(); };
+    bool ok = master.negotiateBestSpeed();
+    quality = master.getLinkQuality();
+    return ok && slave.getCurrentSpeed() == master.getCurrentSpeed() ? master.getCurrentSpeed() : Speed::SPEED_1X;
+}
+
+void testLinkTest(TestFramework& test) {
+    typedef TurboMIDI::SpeedMultiplier Speed;
+    
+    test.startTest("Link Test - PRBS checker");
+    TurboMIDI::PrbsGenerator prbs(5);
+    std::vector<uint8_t> payload(200);
+    for (uint8_t& byte : payload) byte = prbs.next();
+    test.verify(std::all_of(payload.begin(), payload.end(), [](uint8_t byte) { return byte < 0x80; }),
+                "Payload should be data bytes only");
+    TurboMIDI::LinkTestChecker checker;
+    checker.begin(200, 5);
+    checker.check(payload.data(), payload.size());
+    const TurboMIDI::LinkTestCounts& clean = checker.finish();
+    test.verify(clean.bytes == 200 && clean.byteErrors == 0 && clean.bitErrors == 0, "Intact payload should pass");
+    
+    std::vector<uint8_t> damaged = payload;
+    damaged[100] ^= 0x05;                      // Two flipped bits
+    damaged[150] |= 0x80;                      // Became a status byte
+    damaged.erase(damaged.begin() + 50);       // Dropped
+    damaged.resize(190);                       // Cut off by a false SYSEX_END
+    checker.begin(200, 5);
+    checker.check(damaged.data(), damaged.size());
+    const TurboMIDI::LinkTestCounts& counts = checker.finish();
+    test.verify(counts.lostBytes == 10 && counts.byteErrors == 12 && counts.bitErrors == 3,
+                "Damaged, dropped and missing bytes should be told apart");
+    test.endTest();
+    
+    test.startTest("Link Test - Clean link at the test speed");
+    TurboMIDI::SimulatedLink link;
+    TurboMIDI::TurboMIDI master(&link.a(), TurboMIDI::DeviceRole::MASTER);
+    TurboMIDI::TurboMIDI slave(&link.b(), TurboMIDI::DeviceRole::SLAVE);
+    master.setSupportedSpeed(Speed::SPEED_8X, false);
+    slave.setSupportedSpeed(Speed::SPEED_8X, false);
+    master.enableLinkTest();
+    slave.enableLinkTest();
+    // Protocol frames, PRBS payloads included, are not application SysEx
+    int streamed = 0;
+    master.onSysExBegin = [&]() { ++streamed; };
+    master.onSysExChunk = [&](const uint8_t*, size_t) { ++streamed; };
+    master.onSysExEnd = [&](bool) { ++streamed; };
+    slave.onSysExBegin = master.onSysExBegin;
+    slave.onSysExChunk = master.onSysExChunk;
+    slave.onSysExEnd = master.onSysExEnd;
+    test.verify(simulateNegotiation(link, master, slave, Speed::SPEED_8X), "Negotiation should succeed");
+    test.verify(streamed == 0, "The negotiation should not reach the streaming callbacks");
+    test.verify(slave.getCurrentSpeed() == Speed::SPEED_8X, "Slave should follow to 8x");
+    const TurboMIDI::LinkQuality& quality = master.getLinkQuality();
+    test.verify(quality.completed && quality.passed && quality.speed == Speed::SPEED_10X,
+                "The link test should pass at the 10x test speed");
+    test.verify(quality.sent.bytes == 1024 && quality.received.bytes == 1024 && quality.byteErrors() == 0 &&
+                quality.bitErrorRate() == 0.0, "1 KB each way should arrive intact");
+    // 10x carries 31250 bytes per second
+    uint32_t throughput = quality.throughputBytesPerSecond();
+    test.verify(throughput > 28000 && throughput <= 31250, "Throughput should come close to the 10x byte rate");
+    test.verify(master.getNegotiationTiming().linkTest >= quality.exchangeMicros - 1000,
+                "The exchange should be timed as its own phase");
+    test.endTest();
+    
+    test.startTest("Link Test - Stock peers");
+    TurboMIDI::SimulatedLink stockLink;
+    TurboMIDI::TurboMIDI extendedMaster(&stockLink.a(), TurboMIDI::DeviceRole::MASTER);
+    TurboMIDI::TurboMIDI stockSlave(&stockLink.b(), TurboMIDI::DeviceRole::SLAVE);
+    extendedMaster.setSupportedSpeed(Speed::SPEED_4X, false);
+    stockSlave.setSupportedSpeed(Speed::SPEED_4X, false);
+    extendedMaster.enableLinkTest();
+    test.verify(simulateNegotiation(stockLink, extendedMaster, stockSlave, Speed::SPEED_4X),
+                "A slave without the extension should pass the plain test");
+    test.verify(!extendedMaster.getLinkQuality().completed && extendedMaster.getNegotiationTiming().linkTest == 0,
+                "No link test should be sent to it");
+    
+    uint8_t answer[TurboMIDI::SPEED_ANSWER_EXT_LENGTH];
+    TurboMIDI::SpeedConfig speeds;
+    test.verify(TurboMIDI::CommandBuilder::encodeSpeedAnswer(answer, speeds) == TurboMIDI::SPEED_ANSWER_LENGTH,
+                "The stock answer keeps four payload bytes");
+    test.verify(TurboMIDI::CommandBuilder::encodeSpeedAnswer(answer, speeds, TurboMIDI::LINK_TEST_CAPABILITY) ==
+                TurboMIDI::SPEED_ANSWER_EXT_LENGTH && answer[11] == TurboMIDI::LINK_TEST_CAPABILITY,
+                "The capability byte follows the masks");
+    test.endTest();
+    
+    test.startTest("Link Test - Marginal cable");
+    TurboMIDI::LinkQuality last;
+    Speed plain = bestSpeedOnMarginalCable(false, last);
+    test.verify(static_cast<uint8_t>(plain) >= static_cast<uint8_t>(Speed::SPEED_8X),
+                "The 8-byte speed test alone should accept 8x");
+    Speed qualified = bestSpeedOnMarginalCable(true, last);
+    test.verify(qualified == Speed::SPEED_5X, "The extended test should keep the link below the noisy rates");
+    // 2048 bytes at a bit error rate of 2e-4 each way see about three errors
+    test.verify(last.completed && !last.passed && last.speed == Speed::SPEED_8X && last.bitErrors() > 0 &&
+                last.bitErrorRate() < 1e-3, "The last test, at the 8x rate, should measure the noise");
+    test.endTest();
+}
+
+void testTraceReplay(TestFramework& test) {
+    typedef TurboMIDI::SpeedMultiplier Speed;
+    
+    test.startTest("Trace - Record and replay both sides of a link");
+    TurboMIDI::SimulatedLink link;
+    TurboMIDI::TurboMIDI master(&link.a(), TurboMIDI::DeviceRole::MASTER);
+    TurboMIDI::TurboMIDI slave(&link.b(), TurboMIDI::DeviceRole::SLAVE);
+    master.setSupportedSpeed(Speed::SPEED_8X, false);
+    slave.setSupportedSpeed(Speed::SPEED_8X, false);
+    
+    static TurboMIDI::SpscRing<65536> masterRing, slaveRing;
+    TurboMIDI::TraceRecorder masterTrace(masterRing), slaveTrace(slaveRing);
+    master.attachTraceRecorder(&masterTrace);
+    slave.attachTraceRecorder(&slaveTrace);
+    
+    // Tested negotiation, traffic, then a silent master and the slave's timeout
+    test.verify(simulateNegotiation(link, master, slave, Speed::SPEED_8X), "Negotiation should succeed");
+    std::vector<uint8_t> dump = {0xF0, 0x7D};
+    while (dump.size() < 2047) dump.push_back(static_cast<uint8_t>(dump.size() & 0x7F));
+    dump.push_back(0xF7);
+    master.beginSysExSend(dump.data(), dump.size());
+    link.runUntil([&master]() { return !master.isSysExSending(); }, 1000000);
+    link.advance(2000);
+    link.a().service = nullptr;
+    link.runUntil([&slave]() { return slave.getCurrentSpeed() == Speed::SPEED_1X; }, 1000000);
+    test.verify(masterTrace.droppedRecords() == 0 && slaveTrace.droppedRecords() == 0, "Rings should hold the traces");
+    
+    std::vector<uint8_t> slaveBytes(slaveRing.size());
+    slaveRing.read(slaveBytes.data(), slaveBytes.size());
+    std::vector<uint8_t> masterBytes(masterRing.size());
+    masterRing.read(masterBytes.data(), masterBytes.size());
+    
+    TurboMIDI::ReplayPlatform slavePlatform;
+    TurboMIDI::TurboMIDI slaveReplay(&slavePlatform, TurboMIDI::DeviceRole::SLAVE);
+    slaveReplay.setSupportedSpeed(Speed::SPEED_8X, false);
+    bool sawFallback = false;
+    slaveReplay.onSpeedChanged = [&sawFallback](Speed speed) { sawFallback = speed == Speed::SPEED_1X; };
+    TurboMIDI::TraceReader slaveReader(slaveBytes.data(), slaveBytes.size());
+    TurboMIDI::TraceReplayResult slaveResult = TurboMIDI::replayTrace(slaveReplay, slavePlatform, slaveReader);
+    test.verify(!slaveReader.hasHeader() && slaveReader.trailingBytes() == 0, "Bare record stream should parse whole");
+    test.verify(slaveResult.rxBytes >= dump.size() && slaveResult.baudChanges >= 3, "Slave trace should hold traffic and switches");
+    test.verify(slaveResult.recordedTxBytes > 0 && slaveResult.txMatches(), "Replayed slave should answer identically");
+    test.verify(sawFallback && slaveResult.spanMicros > 300000, "Link timeout should fire again during replay");
+    
+    TurboMIDI::ReplayPlatform masterPlatform;
+    TurboMIDI::TurboMIDI masterReplay(&masterPlatform, TurboMIDI::DeviceRole::MASTER);
+    masterReplay.setSupportedSpeed(Speed::SPEED_8X, false);
+    TurboMIDI::TraceReplayResult masterResult =
+        TurboMIDI::replayTrace(masterReplay, masterPlatform, TurboMIDI::TraceReader(masterBytes.data(), masterBytes.size()));
+    test.verify(masterResult.calls == 1 && masterResult.stateChanges >= 5, "Master trace should hold the negotiation");
+    test.verify(masterResult.dataTxBytes == dump.size(), "Dump should be recorded as application data");
+    test.verify(masterReplay.getCurrentSpeed() == Speed::SPEED_8X && masterResult.txMatches(),
+                "Recorded negotiation should be issued and run again");
+    test.endTest();
+    
+    test.startTest("Trace - Delta timestamps");
+    TurboMIDI::SpscRing<256> deltaRing;
+    TurboMIDI::TraceRecorder deltaTrace(deltaRing);
+    const uint8_t chunk[40] = {0x90, 0x3C, 0x7F};
+    const uint32_t times[] = {1000, 1100, 21100, 0xFFFFFFF0u, 0x10};
+    for (uint32_t micros : times) deltaTrace.record(TurboMIDI::TraceRecordType::RX, micros, chunk, 3);
+    // Headers of 3 to 7 bytes: deltas 1000 and 20000 take 2 and 3 bytes, the wrap 5
+    test.verify(deltaRing.size() == 7 + 6 + 8 + 10 + 6, "Headers should shrink with the delta");
+    std::vector<uint8_t> deltaBytes(deltaRing.size());
+    deltaRing.read(deltaBytes.data(), deltaBytes.size());
+    TurboMIDI::TraceReader deltaReader(deltaBytes.data(), deltaBytes.size());
+    TurboMIDI::TraceRecord record;
+    size_t matched = 0;
+    while (deltaReader.next(record) && record.micros == times[matched] && record.length == 3) ++matched;
+    test.verify(matched == 5 && deltaReader.trailingBytes() == 0, "Absolute times should be rebuilt");
+    
+    TurboMIDI::SpscRing<16> smallRing;
+    TurboMIDI::TraceRecorder smallTrace(smallRing);
+    smallTrace.record(TurboMIDI::TraceRecordType::RX, 10, chunk, 3);
+    smallTrace.record(TurboMIDI::TraceRecordType::RX, 20, chunk, sizeof(chunk));
+    smallTrace.record(TurboMIDI::TraceRecordType::TX, 30, chunk, 3);
+    std::vector<uint8_t> smallBytes(smallRing.size());
+    smallRing.read(smallBytes.data(), smallBytes.size());
+    TurboMIDI::TraceReader smallReader(smallBytes.data(), smallBytes.size());
+    test.verify(smallTrace.droppedRecords() == 1 && smallReader.next(record) && record.micros == 10 &&
+                smallReader.next(record) && record.micros == 30 && record.type == TurboMIDI::TraceRecordType::TX,
+                "A dropped record should not shift later timestamps");
+    test.endTest();
+    
+#if TURBOMIDI_HAS_TRACE_FILES
+    test.startTest("Trace - File round trip");
+    char path[] = "/tmp/turbomidi-trace-XXXXXX";
+    int fd = mkstemp(path);
+    test.verify(fd >= 0, "Should create a temporary file");
+    close(fd);
+    
+    TurboMIDI::TraceFileWriter writer;
+    test.verify(writer.open(path, slave), "Should open the trace file");
+    slaveRing.write(slaveBytes.data(), slaveBytes.size());
+    test.verify(writer.drain(slaveRing) == slaveBytes.size() && slaveRing.empty(), "Ring should drain to the file");
+    writer.close();
+    
+    TurboMIDI::TraceFile file;
+    test.verify(file.open(path), "Should map the trace file");
+    TurboMIDI::TraceReader reader = file.reader();
+    test.verify(reader.hasHeader() && reader.header().role == TurboMIDI::DeviceRole::SLAVE &&
+                reader.header().speeds.hasSpeed(Speed::SPEED_8X), "Header should describe the recording engine");
+    
+    TurboMIDI::ReplayPlatform filePlatform;
+    TurboMIDI::TurboMIDI fileReplay(&filePlatform, reader.header().role);
+    TurboMIDI::configureFromTrace(fileReplay, reader.header());
+    TurboMIDI::TraceReplayResult fileResult = TurboMIDI::replayTrace(fileReplay, filePlatform, reader);
+    test.verify(fileResult.records == slaveResult.records && fileResult.txMatches(), "Mapped trace should replay the same");
+    file.close();
+    unlink(path);
+    test.endTest();
+#endif
+}
+
+void testSysExAssembler(TestFramework& test) {
+    typedef TurboMIDI::SysExAssembler<16> Assembler;
+    
+    test.startTest("SysEx Assembler - Ignores non-SysEx traffic");
+    Assembler assembler;
+    const uint8_t channelTraffic[] = {0x90, 0x3C, 0x7F, 0xB0, 0x07, 0x64, 0xF8, 0xFE};
+    for (uint8_t byte : channelTraffic) {
+        test.verify(assembler.push(byte) == Assembler::Result::NONE, "Non-SysEx byte should be ignored");
+    }
+    test.verify(!assembler.hasFrame() && assembler.size() == 0, "No frame should be assembled");
+    test.endTest();
+    
+    test.startTest("SysEx Assembler - Realtime bytes inside a frame");
+    const uint8_t frame[] = {0xF0, 0x00, 0x20, 0xF8, 0x3C, 0x00, 0xFE, 0x00, 0x13, 0xF7};
+    Assembler::Result result = Assembler::Result::NONE;
+    for (uint8_t byte : frame) {
+        result = assembler.push(byte);
+    }
+    test.verify(result == Assembler::Result::COMPLETE, "Frame should complete on SYSEX_END");
+    std::vector<uint8_t> expected = {0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x13, 0xF7};
+    test.verify(std::vector<uint8_t>(assembler.data(), assembler.data() + assembler.size()) == expected,
+                "Realtime bytes should not be part of the frame");
+    test.endTest();
+    
+    test.startTest("SysEx Assembler - Overflow");
+    assembler.push(0xF0);
+    bool overflowed = false;
+    for (int i = 0; i < 32; ++i) {
+        if (assembler.push(0x01) == Assembler::Result::OVERFLOWED) overflowed = true;
+    }
+    test.verify(overflowed, "Oversized frame should report overflow");
+    test.verify(assembler.push(0xF7) == Assembler::Result::NONE, "Oversized frame should not complete");
+    test.verify(assembler.overflowCount() == 1, "Overflow should be counted once per frame");
+    for (uint8_t byte : expected) {
+        result = assembler.push(byte);
+    }
+    test.verify(result == Assembler::Result::COMPLETE, "Assembler should recover after overflow");
+    test.endTest();
+    
+    test.startTest("SysEx Assembler - Status byte aborts frame");
+    assembler.push(0xF0);
+    assembler.push(0x00);
+    assembler.push(0x90);
+    test.verify(assembler.push(0xF7) == Assembler::Result::NONE, "Aborted frame should not complete");
+    test.verify(!assembler.hasFrame(), "Aborted frame should not be available");
+    test.endTest();
+}
+
+void testMidiParser(TestFramework& test) {
+    test.startTest("MIDI Parser - Running status");
+    TurboMIDI::MidiParser parser;
+    std::vector<TurboMIDI::MidiMessage> messages;
+    const uint8_t stream[] = {0x90, 0x3C, 0x7F, 0x3E, 0x60, 0xC1, 0x05, 0x06, 0xF8, 0xB0, 0x07, 0xF8, 0x64};
+    int realtimeCount = 0;
+    for (uint8_t byte : stream) {
+        TurboMIDI::MidiParser::Event event = parser.parse(byte);
+        if (event == TurboMIDI::MidiParser::Event::MESSAGE) messages.push_back(parser.message());
+        if (event == TurboMIDI::MidiParser::Event::REALTIME) realtimeCount++;
+    }
+    test.verify(messages.size() == 5, "Should decode five messages");
+    test.verify(messages[1].status == 0x90 && messages[1].data1 == 0x3E && messages[1].data2 == 0x60,
+                "Running status note on should be decoded");
+    test.verify(messages[3].status == 0xC1 && messages[3].data1 == 0x06 && messages[3].length == 2,
+                "Running status program change should be decoded");
+    test.verify(messages[4].type() == 0xB0 && messages[4].data2 == 0x64,
+                "Realtime byte inside a message should not break it");
+    test.verify(realtimeCount == 2, "Realtime bytes should be reported");
+    test.endTest();
+    
+    test.startTest("MIDI Parser - SysEx and system common");
+    messages.clear();
+    realtimeCount = 0;
+    const uint8_t sysexStream[] = {0x90, 0x3C, 0x7F, 0xF0, 0x01, 0xF8, 0x02, 0xF7, 0x3C, 0x00, 0xF2, 0x10, 0x20, 0x30};
+    for (uint8_t byte : sysexStream) {
+        TurboMIDI::MidiParser::Event event = parser.parse(byte);
+        if (event == TurboMIDI::MidiParser::Event::MESSAGE) messages.push_back(parser.message());
+        if (event == TurboMIDI::MidiParser::Event::REALTIME) realtimeCount++;
+    }
+    test.verify(messages.size() == 2, "SysEx data and orphaned data bytes should be ignored");
+    test.verify(messages[1].status == 0xF2 && messages[1].data1 == 0x10 && messages[1].data2 == 0x20,
+                "Song position pointer should be decoded");
+    test.verify(realtimeCount == 1, "Clock inside SysEx should be reported");
+    test.endTest();
+    
+    test.startTest("MIDI Parser - Dispatch alongside protocol");
+    MockPlatform platform;
+    TurboMIDI::TurboMIDI turbo(&platform, TurboMIDI::DeviceRole::SLAVE);
+    turbo.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_2X, true);
+    std::vector<uint8_t> received;
+    turbo.onMidiMessage = [&](const TurboMIDI::MidiMessage& msg) {
+        received.push_back(msg.status);
+        received.push_back(msg.data1);
+    };
+    turbo.onRealtime = [&](uint8_t byte) { received.push_back(byte); };
+    platform.injectMessage({0x90, 0x3C, 0x7F, 0xF0, 0x00, 0x20, 0xF8, 0x3C, 0x00, 0x00, 0x20, 0x02, 0xF7,
+                            0x3E, 0x7F, 0xFE});
+    turbo.handleIncomingData();
+    test.verify(turbo.getCurrentSpeed() == TurboMIDI::SpeedMultiplier::SPEED_2X,
+                "SPEED_PUSH with interleaved clock should be handled");
+    std::vector<uint8_t> expected = {0x90, 0x3C, 0xF8};
+    test.verify(received == expected, "Note and clock should be delivered, running status ends at SysEx");
+    test.endTest();
+}
+
+void testSpscRing(TestFramework& test) {
+    test.startTest("SPSC Ring - Wrap-around and high-water mark");
+    TurboMIDI::SpscRing<16> ring;
+    test.verify(ring.capacity() == 16 && ring.empty(), "Ring should start empty");
+    
+    uint8_t data[12];
+    for (uint8_t i = 0; i < 12; ++i) data[i] = i;
+    test.verify(ring.write(data, 12) == 12, "All bytes should fit");
+    
+    uint8_t out[16];
+    test.verify(ring.read(out, 8) == 8 && out[7] == 7, "Should read the first eight bytes");
+    test.verify(ring.write(data, 12) == 12, "Write should wrap around");
+    test.verify(ring.size() == 16, "Ring should be full");
+    test.verify(!ring.push(0x42), "Push into a full ring should fail");
+    test.verify(ring.droppedBytes() == 1, "Dropped byte should be counted");
+    test.verify(ring.highWaterMark() == 16, "High-water mark should reach capacity");
+    // Overruns are counted past the range of the byte-sized indices used on AVR
+    uint8_t burst[300] = {};
+    test.verify(ring.write(burst, sizeof(burst)) == 0, "Nothing fits into a full ring");
+    test.verify(ring.droppedBytes() == 301, "Long overrun should not wrap the counter");
+    
+    const uint8_t* region;
+    size_t length = ring.peek(region);
+    test.verify(length == 8 && region[0] == 8, "First region should end at the storage boundary");
+    ring.consume(length);
+    test.verify(ring.read(out, 16) == 8 && out[0] == 4 && out[7] == 11, "Remaining bytes should be in order");
+    test.verify(ring.empty(), "Ring should be empty");
+    test.endTest();
+    
+    test.startTest("SPSC Ring - TurboMIDI drains attached ring");
+    MockPlatform platform;
+    TurboMIDI::TurboMIDI slave(&platform, TurboMIDI::DeviceRole::SLAVE);
+    slave.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_4X, true);
+    
+    TurboMIDI::SpscRing<8> rxRing;
+    slave.attachReceiveRing(&rxRing);
+    
+    // Feed a SPEED_PUSH in pieces, as an ISR would
+    const uint8_t push[] = {0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x20, 0x04, 0xF7};
+    rxRing.write(push, 6);
+    slave.handleIncomingData();
+    rxRing.write(push + 6, 3);
+    slave.handleIncomingData();
+    test.verify(slave.getCurrentSpeed() == TurboMIDI::SpeedMultiplier::SPEED_4X,
+                "Frame split across ring batches should be handled");
+    test.verify(rxRing.empty(), "Ring should be drained");
+    test.endTest();
+}
+
+#if defined(TURBOMIDI_TEST_POSIX)
+void testPosixPlatform(TestFramework& test) {
+    test.startTest("POSIX Platform - Exact baud rates over a pty");
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    test.verify(master >= 0 && grantpt(master) == 0 && unlockpt(master) == 0, "Should create a pty");
+    
+    TurboMIDI::PosixPlatform platform;
+    test.verify(platform.open(ptsname(master)), "Should open the pty in raw mode");
+    test.verify(platform.getBaudRate() == 31250, "Should start at 31250");
+    platform.setBaudRate(103125);
+    test.verify(platform.lastError() == 0 && platform.getBaudRate() == 103125, "Should set 103125 exactly");
+    platform.setBaudRate(415625);
+    test.verify(platform.lastError() == 0 && platform.getBaudRate() == 415625, "Should set 415625 exactly");
+    test.endTest();
+    
+    test.startTest("POSIX Platform - Non-blocking I/O and readiness");
+    uint8_t buffer[64];
+    test.verify(platform.receiveMidiData(buffer, sizeof(buffer)) == 0, "Read without data should not block");
+    test.verify(!platform.waitReadable(0), "Nothing should be readable yet");
+    
+    const uint8_t push[] = {0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x20, 0x02, 0xF7};
+    test.verify(write(master, push, sizeof(push)) == static_cast<ssize_t>(sizeof(push)), "Should write to pty");
+    test.verify(platform.waitReadable(1000), "Data should become readable");
+    
+    TurboMIDI::TurboMIDI slave(&platform, TurboMIDI::DeviceRole::SLAVE);
+    slave.setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_2X, true);
+    slave.handleIncomingData();
+    test.verify(slave.getCurrentSpeed() == TurboMIDI::SpeedMultiplier::SPEED_2X, "Slave should follow SPEED_PUSH");
+    test.verify(platform.getBaudRate() == 62500, "Port should run at 2x");
+    
+    const uint8_t noteOn[] = {0x90, 0x3C, 0x7F};
+    platform.sendMidiData(noteOn, sizeof(noteOn));
+    struct pollfd pfd = {master, POLLIN, 0};
+    test.verify(poll(&pfd, 1, 1000) == 1 && read(master, buffer, sizeof(buffer)) == 3 && buffer[0] == 0x90,
+                "Sent data should arrive on the other side");
+    
+    platform.close();
+    close(master);
+    test.endTest();
+}
+#endif
+
+void testHub(TestFramework& test) {
+    test.startTest("Hub - Parallel negotiation with per-port speeds");
+    MockPlatform ports[3];
+    TurboMIDI::TurboMIDIHub<4> hub;
+    for (MockPlatform& platform : ports) {
+        test.verify(hub.addPort(&platform) >= 0, "Port should be added");
+        hub.port(hub.portCount() - 1).setSupportedSpeed(TurboMIDI::SpeedMultiplier::SPEED_4X, true);
+    }
+    
+    // Ports 0 and 1 answer with certified 4x and acknowledge; port 2 stays silent
+    for (int i = 0; i < 2; ++i) {
+        ports[i].injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x11, 0x04, 0x00, 0x04, 0x00, 0xF7});
+        ports[i].injectMessage({0xF0, 0x00, 0x20, 0x3C, 0x00, 0x00, 0x13, 0xF7});
+    }
+    TurboMIDI::TurboMIDIHub<4>::PortMask ok = hub.negotiateAll(TurboMIDI::SpeedMultiplier::SPEED_4X);
+    test.verify(ok == 0x3, "Ports 0 and 1 should negotiate 4x");
+    test.verify(hub.getSpeed(0) == TurboMIDI::SpeedMultiplier::SPEED_4X &&
+                hub.getSpeed(1) == TurboMIDI::SpeedMultiplier::SPEED_4X, "Negotiated ports should run at 4x");
+    test.verify(hub.getSpeed(2) == TurboMIDI::SpeedMultiplier::SPEED_1X, "Silent port should stay at 1x");
+    test.verify(ports[0].currentTime < 40 && ports[2].currentTime < 40, "Ports should be negotiated in parallel");
+    test.endTest();
+    
+    test.startTest("Hub - Routing between ports");
+    for (MockPlatform& platform : ports) platform.clearBuffers();
+    hub.connect(0, 1);
+    hub.connect(0, 2);
+    ports[0].injectMessage({0x90, 0x3C, 0x7F, 0x40, 0x00, 0xF8});
+    hub.update();
+    std::vector<uint8_t> expected = {0x90, 0x3C, 0x7F, 0x90, 0x40, 0x00, 0xF8};
+    test.verify(ports[1].txBuffer == expected && ports[2].txBuffer == expected,
+                "Notes and clock should reach both destinations");
+    test.verify(ports[0].txBuffer.empty(), "Nothing should be echoed to the source");
+    test.endTest();
+    
+    test.startTest("Hub - Routing to a negotiating port");
+    test.verify(hub.port(2).beginNegotiation(TurboMIDI::SpeedMultiplier::SPEED_4X), "Port 2 should start negotiating");
+    for (MockPlatform& platform : ports) platform.clearBuffers();
+    ports[0].injectMessage({0xF8, 0x90, 0x3C, 0x7F, 0xF8});
+    hub.update();
+    test.verify(ports[2].txBuffer == std::vector<uint8_t>({0xF8, 0xF8}), "Only clock should reach a negotiating port");
+    test.verify(ports[1].txBuffer == std::vector<uint8_t>({0xF8, 0x90, 0x3C, 0x7F, 0xF8}),
+                "Other destinations should not wait");
+    hub.port(2).cancelNegotiation();
+    ports[2].clearBuffers();
+    hub.update();
+    test.verify(ports[2].txBuffer == std::vector<uint8_t>({0x90, 0x3C, 0x7F}), "Held note should follow the negotiation");
+    test.verify(hub.droppedRouteMessages() == 0, "No messages should be dropped");
+    test.endTest();
+    
+#if TURBOMIDI_HAS_THREADS
+    test.startTest("Hub - Worker threads");
+    for (MockPlatform& platform : ports) platform.clearBuffers();
+    hub.disconnect(0, 2);
+    hub.connect(1, 0);
+    ports[0].injectMessage({0xB0, 0x07, 0x64});
+    ports[1].injectMessage({0xC0, 0x05});
+    hub.startWorkers(2, 0);
+    test.verify(hub.workersRunning(), "Workers should be running");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    hub.stopWorkers();
+    test.verify(ports[1].txBuffer == std::vector<uint8_t>({0xB0, 0x07, 0x64}), "CC should cross shards");
+    test.verify(ports[0].txBuffer == std::vector<uint8_t>({0xC0, 0x05}), "Program change should cross shards");
+    test.verify(ports[2].txBuffer.empty(), "Disconnected port should receive nothing");
+    test.verify(hub.droppedRouteMessages() == 0, "No messages should be dropped");
+    test.endTest();
+#endif
+}
+
+#if TURBOMIDI_HAS_THREADS
+// One end of a lock-free in-memory cable; each direction has one sending and one receiving thread
+class PipePlatform : public TurboMIDI::IPlatform {
+public:
+    PipePlatform* peer = nullptr;
+    std::atomic<uint32_t> baudRate{31250};
+    
+    void sendMidiData(const uint8_t* data, size_t length) override {
+        while (length > 0) {
+            size_t count = peer->rx_.write(data, length);
+            data += count;
+            length -= count;
+            if (length > 0) std::this_thread::yield();
+        }
+    }
+    
+    size_t receiveMidiData(uint8_t* buffer, size_t maxLength) override {
+        return rx_.read(buffer, maxLength);
+    }
+    
+    uint32_t getMillis() override { return getMicros() / 1000; }
+    uint32_t getMicros() override {
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+    void setBaudRate(uint32_t rate) override { baudRate = rate; }
+    void delayMs(uint32_t ms) override { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+    
+private:
+    TurboMIDI::SpscRing<4096> rx_;
+};
+
+void testThreadedFacade(TestFramework& test) {
+    using TurboMIDI::LinkEvent;
+    using TurboMIDI::LinkEventType;
+    using TurboMIDI::SpeedMultiplier;
+    
+    test.startTest("Threaded Facade - Negotiation and traffic across threads");
+    PipePlatform masterPort, slavePort;
+    masterPort.peer = &slavePort;
+    slavePort.peer = &masterPort;
+    
+    TurboMIDI::ThreadedTurboMIDI master(&masterPort, TurboMIDI::DeviceRole::MASTER);
+    TurboMIDI::ThreadedTurboMIDI slave(&slavePort, TurboMIDI::DeviceRole::SLAVE);
+    master.link().setSupportedSpeed(SpeedMultiplier::SPEED_4X, true);
+    slave.link().setSupportedSpeed(SpeedMultiplier::SPEED_4X, true);
+    slave.link().setSupportedSpeed(SpeedMultiplier::SPEED_2X, true);
+    master.start(50);
+    slave.start(50);
+    
+    // The note is posted while the negotiation runs and must follow it at 4x
+    test.verify(master.requestNegotiation(SpeedMultiplier::SPEED_4X), "Negotiation request should be queued");
+    const uint8_t noteOn[] = {0x90, 0x3C, 0x7F};
+    test.verify(master.send(noteOn, sizeof(noteOn)), "Send should be queued");
+    
+    bool completed = false, succeeded = false;
+    bool slaveSwitched = false, noteAfterSwitch = false;
+    LinkEvent event;
+    auto giveUp = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while ((!completed || !noteAfterSwitch) && std::chrono::steady_clock::now() < giveUp) {
+        while (master.pollEvent(event)) {
+            if (event.type == LinkEventType::NEGOTIATION_COMPLETE) {
+                completed = true;
+                succeeded = event.success && event.speed == SpeedMultiplier::SPEED_4X;
+            }
+        }
+        while (slave.pollEvent(event)) {
+            if (event.type == LinkEventType::SPEED_CHANGED && event.speed == SpeedMultiplier::SPEED_4X) {
+                slaveSwitched = true;
+            } else if (event.type == LinkEventType::MIDI_MESSAGE && event.message.status == 0x90 &&
+                       event.message.data1 == 0x3C) {
+                noteAfterSwitch = slaveSwitched;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    
+    test.verify(completed && succeeded, "Master should report a 4x negotiation");
+    test.verify(master.getSpeed() == SpeedMultiplier::SPEED_4X && slave.getSpeed() == SpeedMultiplier::SPEED_4X,
+                "Both sides should publish 4x");
+    test.verify(master.getNegotiationStatus() == TurboMIDI::NegotiationStatus::SUCCEEDED,
+                "Status should be visible from the application thread");
+    test.verify(noteAfterSwitch, "Held note should arrive after the slave switched");
+    test.endTest();
+    
+    test.startTest("Threaded Facade - SysEx events and push");
+    const uint8_t dump[] = {0xF0, 0x7D, 0x01, 0x02, 0x03, 0xF7};
+    master.send(dump, sizeof(dump));
+    test.verify(master.pushSpeed(SpeedMultiplier::SPEED_2X), "Push should be queued");
+    
+    size_t sysExBytes = 0;
+    bool sysExEnded = false, pushed = false;
+    giveUp = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while ((!sysExEnded || !pushed) && std::chrono::steady_clock::now() < giveUp) {
+        while (slave.pollEvent(event)) {
+            if (event.type == LinkEventType::SYSEX_DATA) sysExBytes += event.length;
+            if (event.type == LinkEventType::SYSEX_DONE) sysExEnded = event.success;
+            if (event.type == LinkEventType::SPEED_CHANGED && event.speed == SpeedMultiplier::SPEED_2X) pushed = true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    master.stop();
+    slave.stop();
+    
+    test.verify(sysExEnded && sysExBytes >= 4, "SysEx should arrive as data and end events");
+    test.verify(pushed && slavePort.baudRate == 62500, "Slave should follow the pushed speed");
+    test.verify(master.droppedEvents() == 0 && slave.droppedEvents() == 0 && master.droppedCommands() == 0,
+                "Nothing should be dropped");
+    test.verify(!master.running() && !slave.running(), "Threads should be joined");
+    test.endTest();
+}
+#endif
+
 // Main test runner
 int main() {
     TestFramework test;
@@ -411,13 +2346,42 @@ int main() {
     
     // Run all tests
     testCommandBuilders(test);
+    testFrameEncoders(test);
+    testSpeedTable(test);
     testSpeedConfig(test);
     testMasterSlaveNegotiation(test);
+    testMasterNegotiationResponses(test);
+    testAsyncNegotiation(test);
     testActiveSensing(test);
     testTimeouts(test);
     testSpeedPush(test);
     testInvalidMessages(test);
+    testLinkStats(test);
+    testAdaptiveSpeed(test);
+    testBestSpeedNegotiation(test);
+    testPeerCache(test);
     testSlaveSpeedTest(test);
+    testCompileTimeRoles(test);
+    testTxScheduler(test);
+    testBulkReceive(test);
+    testStreamingSysEx(test);
+    testSimulatedLink(test);
+    testZeroCopyReceive(test);
+    testDeadlineTimers(test);
+    testPipelinedSpeedTest(test);
+    testTraceReplay(test);
+    testPriorityLanes(test);
+    testLinkTest(test);
+    testSysExAssembler(test);
+    testMidiParser(test);
+    testSpscRing(test);
+    testHub(test);
+#if TURBOMIDI_HAS_THREADS
+    testThreadedFacade(test);
+#endif
+#if defined(TURBOMIDI_TEST_POSIX)
+    testPosixPlatform(test);
+#endif
     
     // Print summary
     test.printSummary();